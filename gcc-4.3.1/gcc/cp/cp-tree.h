@@ -4401,6 +4401,11 @@ extern tree locate_dtor				(tree, void *);
 /* In optimize.c */
 extern bool maybe_clone_body			(tree);
 
+/* in parser.c */
+extern void parse_deferred_inline_bodies	(tree);
+extern void parse_deferred_inline_bodies_for_class (tree);
+extern bool parse_needed_inline_bodies		(void);
+
 /* in pt.c */
 extern void check_template_shadow		(tree);
 extern tree get_innermost_template_args		(tree, int);
@@ -4472,6 +4477,7 @@ extern tree template_for_substitution		(tree);
 extern tree build_non_dependent_expr		(tree);
 extern tree build_non_dependent_args		(tree);
 extern bool reregister_specialization		(tree, tree, tree);
+extern void merge_specializations		(tree, tree);
 extern tree fold_non_dependent_expr		(tree);
 extern bool explicit_class_specialization_p     (tree);
 extern struct tinst_level *outermost_tinst_level(void);
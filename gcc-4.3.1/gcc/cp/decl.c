@@ -1646,9 +1646,7 @@ duplicate_decls (tree newdecl, tree olddecl, bool newdecl_is_friend)
       old_result = DECL_TEMPLATE_RESULT (olddecl);
       new_result = DECL_TEMPLATE_RESULT (newdecl);
       TREE_TYPE (olddecl) = TREE_TYPE (old_result);
-      DECL_TEMPLATE_SPECIALIZATIONS (olddecl)
-	= chainon (DECL_TEMPLATE_SPECIALIZATIONS (olddecl),
-		   DECL_TEMPLATE_SPECIALIZATIONS (newdecl));
+      merge_specializations (olddecl, newdecl);
 
       DECL_ATTRIBUTES (old_result)
 	= (*targetm.merge_decl_attributes) (old_result, new_result);
@@ -3270,6 +3270,11 @@ cp_write_global_declarations (void)
       /* If there are templates that we've put off instantiating, do
 	 them now.  */
       instantiate_pending_templates (retries);
+
+      /* Parse the deferred inline function bodies that turned out to
+	 be needed.  */
+      if (parse_needed_inline_bodies ())
+	reconsider = true;
       ggc_collect ();
 
       /* Write out virtual tables as required.  Note that writing out
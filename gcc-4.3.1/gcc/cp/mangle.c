@@ -58,6 +58,8 @@ along with GCC; see the file COPYING3.  If not see
 #include "varray.h"
 #include "flags.h"
 #include "target.h"
+#include "params.h"
+#include "pointer-set.h"
 
 /* Debugging support.  */
 
@@ -96,16 +98,48 @@ typedef struct globals GTY(())
      we've seen them.  */
   VEC(tree,gc) *substitutions;
 
+  /* Once there are SUBSTITUTION_MAP_THRESHOLD candidates, maps each
+     candidate decl, and the canonical type of each candidate type, to
+     one more than its index in SUBSTITUTIONS.  */
+  struct pointer_map_t * GTY ((skip)) substitution_map;
+
+  /* True if a candidate type needs structural comparison, so that
+     SUBSTITUTION_MAP cannot find it.  */
+  bool structural_substitutions;
+
   /* The entity that is being mangled.  */
   tree GTY ((skip)) entity;
 
   /* True if the mangling will be different in a future version of the
      ABI.  */
   bool need_abi_warning;
+
+  /* True if the mangling contains the name of an anonymous class,
+     which may yet be named by a typedef.  */
+  bool anonymous_name_p;
 } globals;
 
 static GTY (()) globals G;
 
+/* The number of substitution candidates at which find_substitution
+   stops scanning them and uses a map instead.  */
+#define SUBSTITUTION_MAP_THRESHOLD 16
+
+/* A type mangled on its own, from an empty set of substitutions.  */
+struct mangled_type_entry GTY(())
+{
+  tree type;
+  const char *mangled;
+};
+
+/* The types mangled on their own so far, for mangle_type_string and
+   the special names of mangle_special_for_type.  The typeinfo and
+   vtable names of a class, and the NTBS of its typeinfo, all contain
+   the same mangled type.  Types whose mangling names an anonymous
+   class are not entered.  */
+static GTY ((if_marked ("mangled_type_marked_p"),
+	     param_is (struct mangled_type_entry))) htab_t mangled_types;
+
 /* The obstack on which we build mangled names.  */
 static struct obstack *mangle_obstack;
 
@@ -170,6 +204,7 @@ static inline int is_std_substitution (const tree,
 				       const substitution_identifier_index_t);
 static inline int is_std_substitution_char (const tree,
 					    const substitution_identifier_index_t);
+static void map_substitution (tree, int);
 static int find_substitution (tree);
 static void mangle_call_offset (const tree, const tree);
 
@@ -425,10 +460,50 @@ add_substitution (tree node)
   /* Put the decl onto the varray of substitution candidates.  */
   VEC_safe_push (tree, gc, G.substitutions, node);
 
+  if (G.substitution_map)
+    map_substitution (node, VEC_length (tree, G.substitutions) - 1);
+  else if (VEC_length (tree, G.substitutions) == SUBSTITUTION_MAP_THRESHOLD)
+    {
+      int i;
+      tree candidate;
+
+      G.substitution_map = pointer_map_create ();
+      for (i = 0; VEC_iterate (tree, G.substitutions, i, candidate); i++)
+	map_substitution (candidate, i);
+    }
+
   if (DEBUG_MANGLE)
     dump_substitution_candidates ();
 }
 
+/* Enter the substitution candidate NODE, whose index is I, into
+   G.substitution_map.  */
+
+static void
+map_substitution (tree node, int i)
+{
+  void **slot;
+
+  /* A template prefix is only ever matched by NESTED_TEMPLATE_MATCH,
+     for which find_substitution scans the candidates.  */
+  if (TREE_CODE (node) == TREE_LIST)
+    return;
+
+  if (TYPE_P (node))
+    {
+      if (!USE_CANONICAL_TYPES || TYPE_STRUCTURAL_EQUALITY_P (node))
+	{
+	  G.structural_substitutions = true;
+	  return;
+	}
+      node = TYPE_CANONICAL (node);
+    }
+
+  slot = pointer_map_insert (G.substitution_map, node);
+  if (!*slot)
+    *slot = (void *) (size_t) (i + 1);
+}
+
 /* Helper function for find_substitution.  Returns nonzero if NODE,
    which may be a decl or a CLASS_TYPE, is a template-id with template
    name of substitution_index[INDEX] in the ::std namespace.  */
@@ -631,7 +706,33 @@ find_substitution (tree node)
     }
 
   /* Now check the list of available substitutions for this mangling
-     operation.  */
+     operation.  When same_type_p compares canonical types, types that
+     are the same have the same canonical type, so the map finds the
+     first candidate that matches, as the loop below would.  */
+  if (G.substitution_map
+      && USE_CANONICAL_TYPES
+      && !G.structural_substitutions
+      && TREE_CODE (node) != TREE_LIST
+      && !(type && TYPE_P (type) && TYPE_STRUCTURAL_EQUALITY_P (type)))
+    {
+      void **slot;
+
+      i = size;
+      if (decl
+	  && (slot = pointer_map_contains (G.substitution_map, decl)))
+	i = (int) (size_t) *slot - 1;
+      if (type && TYPE_P (type)
+	  && (slot = pointer_map_contains (G.substitution_map,
+					   TYPE_CANONICAL (type)))
+	  && (int) (size_t) *slot - 1 < i)
+	i = (int) (size_t) *slot - 1;
+
+      if (i == size)
+	return 0;
+      write_substitution (i);
+      return 1;
+    }
+
   for (i = 0; i < size; ++i)
     {
       tree candidate = VEC_index (tree, G.substitutions, i);
@@ -1166,6 +1267,9 @@ write_source_name (tree identifier)
   if (IDENTIFIER_TEMPLATE (identifier))
     identifier = IDENTIFIER_TEMPLATE (identifier);
 
+  if (ANON_AGGRNAME_P (identifier))
+    G.anonymous_name_p = true;
+
   write_unsigned_number (IDENTIFIER_LENGTH (identifier));
   write_identifier (IDENTIFIER_POINTER (identifier));
 }
@@ -2566,6 +2670,7 @@ start_mangling (const tree entity, const bool ident_p)
 {
   G.entity = entity;
   G.need_abi_warning = false;
+  G.anonymous_name_p = false;
   if (!ident_p)
     {
       obstack_free (&name_obstack, name_base);
@@ -2590,6 +2695,12 @@ finish_mangling (const bool warn)
 
   /* Clear all the substitutions.  */
   VEC_truncate (tree, G.substitutions, 0);
+  if (G.substitution_map)
+    {
+      pointer_map_destroy (G.substitution_map);
+      G.substitution_map = NULL;
+    }
+  G.structural_substitutions = false;
 
   /* Null-terminate the string.  */
   write_char ('\0');
@@ -2657,19 +2768,71 @@ mangle_decl (const tree decl)
   SET_DECL_ASSEMBLER_NAME (decl, id);
 }
 
+/* Return the hash of P, a struct mangled_type_entry.  */
+
+static hashval_t
+mangled_type_hash (const void *p)
+{
+  return htab_hash_pointer (((const struct mangled_type_entry *) p)->type);
+}
+
+/* Return nonzero if P1 and P2, struct mangled_type_entrys, are for the
+   same type.  */
+
+static int
+mangled_type_eq (const void *p1, const void *p2)
+{
+  return (((const struct mangled_type_entry *) p1)->type
+	  == ((const struct mangled_type_entry *) p2)->type);
+}
+
+/* Return nonzero if the type of P, a struct mangled_type_entry, is
+   still live.  */
+
+static int
+mangled_type_marked_p (const void *p)
+{
+  return ggc_marked_p (((const struct mangled_type_entry *) p)->type);
+}
+
 /* Generate the mangled representation of TYPE.  */
 
 const char *
 mangle_type_string (const tree type)
 {
+  struct mangled_type_entry key;
+  struct mangled_type_entry **slot;
+  struct mangled_type_entry *e;
   const char *result;
 
+  if (mangled_types == NULL)
+    mangled_types = htab_create_ggc (37, mangled_type_hash, mangled_type_eq,
+				     NULL);
+
+  key.type = type;
+  e = (struct mangled_type_entry *) htab_find (mangled_types, &key);
+  if (e)
+    return e->mangled;
+
   start_mangling (type, /*ident_p=*/false);
   write_type (type);
   result = finish_mangling (/*warn=*/false);
   if (DEBUG_MANGLE)
     fprintf (stderr, "mangle_type_string = '%s'\n\n", result);
-  return result;
+
+  /* An anonymous class takes the name of the first typedef for it,
+     which may come after we are first asked for its name; see
+     grokdeclarator.  */
+  if (G.anonymous_name_p)
+    return result;
+
+  slot = (struct mangled_type_entry **)
+    htab_find_slot (mangled_types, &key, INSERT);
+  e = GGC_NEW (struct mangled_type_entry);
+  e->type = type;
+  e->mangled = ggc_strdup (result);
+  *slot = e;
+  return e->mangled;
 }
 
 /* Create an identifier for the mangled name of a special component
@@ -2680,6 +2843,9 @@ static tree
 mangle_special_for_type (const tree type, const char *code)
 {
   const char *result;
+  /* Nothing before the type can be substituted, so it mangles just as
+     it does on its own.  */
+  const char *mangled_type = mangle_type_string (type);
 
   /* We don't have an actual decl here for the special component, so
      we can't just process the <encoded-name>.  Instead, fake it.  */
@@ -2690,7 +2856,7 @@ mangle_special_for_type (const tree type, const char *code)
   write_string (code);
 
   /* Add the type.  */
-  write_type (type);
+  write_string (mangled_type);
   result = finish_mangling (/*warn=*/false);
 
   if (DEBUG_MANGLE)
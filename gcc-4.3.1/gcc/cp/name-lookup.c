@@ -587,6 +587,12 @@ pushdecl_maybe_friend (tree x, bool is_friend)
   if (x == error_mark_node)
     POP_TIMEVAR_AND_RETURN (TV_NAME_LOOKUP, error_mark_node);
 
+  /* Deferred inline function bodies must not see a namespace-scope
+     declaration that follows them.  */
+  if (DECL_NAME (x) && DECL_NAMESPACE_SCOPE_P (x)
+      && (is_friend || namespace_bindings_p ()))
+    parse_deferred_inline_bodies (DECL_NAME (x));
+
   need_new_binding = 1;
 
   if (DECL_TEMPLATE_PARM_P (x))
@@ -3290,6 +3296,10 @@ pushdecl_namespace_level (tree x, bool is_friend)
   POP_TIMEVAR_AND_RETURN (TV_NAME_LOOKUP, t);
 }
 
+/* Incremented whenever a namespace is added to the using list of a
+   namespace, to invalidate the using_groups of the binding levels.  */
+static GTY(()) unsigned using_directives_generation = 1;
+
 /* Insert USED into the using list of USER. Set INDIRECT_flag if this
    directive is not directly from the source. Also find the common
    ancestor and let our users know about the new namespace */
@@ -3323,6 +3333,7 @@ add_using_namespace (tree user, tree used, bool indirect)
 		 DECL_NAMESPACE_USING (user));
 
   TREE_INDIRECT_USING (DECL_NAMESPACE_USING (user)) = indirect;
+  using_directives_generation++;
 
   /* Add user to the used's users list.  */
   DECL_NAMESPACE_USERS (used)
@@ -3352,6 +3363,8 @@ do_toplevel_using_decl (tree decl, tree scope, tree name)
   if (decl == NULL_TREE)
     return;
 
+  parse_deferred_inline_bodies (name);
+
   binding = binding_for_name (NAMESPACE_LEVEL (current_namespace), name);
 
   oldval = binding->value;
@@ -3393,6 +3406,9 @@ do_using_directive (tree namespace)
     }
   else
     {
+      /* The directive could change the meaning of any name in the
+	 deferred inline function bodies.  */
+      parse_deferred_inline_bodies (NULL_TREE);
       /* direct usage */
       add_using_namespace (current_namespace, namespace, 0);
       if (current_namespace != global_namespace)
@@ -3687,6 +3703,52 @@ remove_hidden_names (tree fns)
   return fns;
 }
 
+/* Return the using-directives of the namespace NS and its enclosing
+   namespaces that unqualified lookup from NS considers.  This is a
+   TREE_LIST with an entry for each enclosing namespace, innermost
+   first, that is the common ancestor of some of the directives; its
+   TREE_PURPOSE is that namespace and its TREE_VALUE lists the
+   directives in the form of DECL_NAMESPACE_USING.  Namespaces without
+   directives are left out.  The list is kept in the binding level of
+   NS until the next using-directive.  */
+
+static tree
+namespace_using_groups (tree ns)
+{
+  struct cp_binding_level *level = NAMESPACE_LEVEL (ns);
+  tree groups = NULL_TREE;
+  tree scope;
+
+  if (level->using_groups_generation == using_directives_generation)
+    return level->using_groups;
+
+  for (scope = ns; ; scope = CP_DECL_CONTEXT (scope))
+    {
+      tree group = NULL_TREE;
+      tree siter;
+      tree t;
+
+      for (siter = ns; ; siter = CP_DECL_CONTEXT (siter))
+	{
+	  for (t = DECL_NAMESPACE_USING (siter); t; t = TREE_CHAIN (t))
+	    if (TREE_VALUE (t) == scope
+		&& !purpose_member (TREE_PURPOSE (t), group))
+	      group = tree_cons (TREE_PURPOSE (t), scope, group);
+	  if (siter == scope)
+	    break;
+	}
+
+      if (group)
+	groups = tree_cons (scope, nreverse (group), groups);
+      if (scope == global_namespace)
+	break;
+    }
+
+  level->using_groups = nreverse (groups);
+  level->using_groups_generation = using_directives_generation;
+  return level->using_groups;
+}
+
 /* Unscoped lookup of a global: iterate over current namespaces,
    considering using-directives.  */
 
@@ -3695,12 +3757,14 @@ unqualified_namespace_lookup (tree name, int flags)
 {
   tree initial = current_decl_namespace ();
   tree scope = initial;
-  tree siter;
+  tree groups;
   struct cp_binding_level *level;
   tree val = NULL_TREE;
 
   timevar_push (TV_NAME_LOOKUP);
 
+  groups = namespace_using_groups (initial);
+
   for (; !val; scope = CP_DECL_CONTEXT (scope))
     {
       struct scope_binding binding = EMPTY_SCOPE_BINDING;
@@ -3721,16 +3785,13 @@ unqualified_namespace_lookup (tree name, int flags)
 
       /* Add all _DECLs seen through global using-directives.  */
       /* XXX local and global using lists should work equally.  */
-      siter = initial;
-      while (1)
+      if (groups && TREE_PURPOSE (groups) == scope)
 	{
-	  if (!lookup_using_namespace (name, &binding,
-				       DECL_NAMESPACE_USING (siter),
+	  if (!lookup_using_namespace (name, &binding, TREE_VALUE (groups),
 				       scope, flags))
 	    /* Give up because of error.  */
 	    POP_TIMEVAR_AND_RETURN (TV_NAME_LOOKUP, error_mark_node);
-	  if (siter == scope) break;
-	  siter = CP_DECL_CONTEXT (siter);
+	  groups = TREE_CHAIN (groups);
 	}
 
       val = binding.value;
@@ -3819,6 +3880,16 @@ qualified_lookup_using_namespace (tree name, tree scope,
   timevar_push (TV_NAME_LOOKUP);
   /* Look through namespace aliases.  */
   scope = ORIGINAL_NAMESPACE (scope);
+  /* Without using-directives, there is nothing to queue.  */
+  if (!DECL_NAMESPACE_USING (scope) && result->value != error_mark_node)
+    {
+      cxx_binding *binding =
+	cxx_scope_find_binding_for_name (NAMESPACE_LEVEL (scope), name);
+      if (binding)
+	ambiguous_decl (result, binding, flags);
+      POP_TIMEVAR_AND_RETURN (TV_NAME_LOOKUP,
+			      result->value != error_mark_node);
+    }
   while (scope && result->value != error_mark_node)
     {
       cxx_binding *binding =
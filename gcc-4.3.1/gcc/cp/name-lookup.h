@@ -197,6 +197,13 @@ struct cp_binding_level GTY(())
        VALUE the common ancestor with this binding_level's namespace.  */
     tree using_directives;
 
+    /* For namespaces only: the using-directives that unqualified
+       lookup from this namespace considers, grouped by common
+       ancestor, and the value of using_directives_generation when
+       they were computed.  See namespace_using_groups.  */
+    tree using_groups;
+    unsigned using_groups_generation;
+
     /* For the binding level corresponding to a class, the entities
        declared in the class or its base classes.  */
     VEC(cp_class_binding,gc) *class_shadowed;
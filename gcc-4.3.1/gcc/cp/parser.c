@@ -37,6 +37,7 @@ along with GCC; see the file COPYING3.  If not see
 #include "target.h"
 #include "cgraph.h"
 #include "c-common.h"
+#include "pointer-set.h"
 
 
 /* The lexer.  */
@@ -1537,6 +1538,27 @@ typedef struct cp_parser GTY(())
   unsigned num_template_parameter_lists;
 } cp_parser;
 
+/* Inline member functions whose bodies have not been parsed because
+   -fdefer-inline-bodies put them off until they are needed, as a
+   TREE_LIST in reverse order of definition.  */
+static GTY(()) tree deferred_inline_bodies;
+
+/* The names that the deferred bodies could look up.  A declaration of
+   one of these names at namespace scope gets the bodies parsed first,
+   so that they see the same declarations as they would have at the
+   end of their classes.  */
+static struct pointer_set_t *deferred_inline_body_names;
+
+/* The types that existed when the last body was deferred have a
+   TYPE_UID below this.  One of them may have been incomplete and
+   reached from a body through a member or a declarator, without its
+   name appearing in the body.  */
+static int deferred_inline_bodies_type_uid;
+
+/* The names of the operator functions for each operator token type,
+   filled in on demand; error_mark_node if there are none.  */
+static GTY(()) tree operator_token_names[CPP_LAST_PUNCTUATOR + 1];
+
 /* Prototypes.  */
 
 /* Constructors and destructors.  */
@@ -1929,6 +1951,12 @@ static void cp_parser_save_default_args
   (cp_parser *, tree);
 static void cp_parser_late_parsing_for_member
   (cp_parser *, tree);
+static bool cp_parser_defer_body_p
+  (tree);
+static void cp_parser_defer_body
+  (tree);
+static void cp_parser_parse_deferred_bodies
+  (cp_parser *, tree);
 static void cp_parser_late_parsing_default_args
   (cp_parser *, tree);
 static tree cp_parser_sizeof_operand
@@ -2977,9 +3005,13 @@ cp_parser_translation_unit (cp_parser* parser)
   /* If there are no tokens left then all went well.  */
   if (cp_lexer_next_token_is (parser->lexer, CPP_EOF))
     {
-      /* Get rid of the token array; we don't need it any more.  */
-      cp_lexer_destroy (parser->lexer);
-      parser->lexer = NULL;
+      /* Get rid of the token array; we don't need it any more, unless
+	 the deferred inline function bodies still point into it.  */
+      if (!deferred_inline_bodies)
+	{
+	  cp_lexer_destroy (parser->lexer);
+	  parser->lexer = NULL;
+	}
 
       /* This file might have been a context that's implicitly extern
 	 "C".  If so, pop the lang context.  (Only relevant for PCH.) */
@@ -14326,8 +14358,11 @@ cp_parser_class_specifier (cp_parser* parser)
 	{
 	  /* Figure out which function we need to process.  */
 	  fn = TREE_VALUE (queue_entry);
-	  /* Parse the function.  */
-	  cp_parser_late_parsing_for_member (parser, fn);
+	  /* Parse the function, or put it off until it is needed.  */
+	  if (cp_parser_defer_body_p (fn))
+	    cp_parser_defer_body (fn);
+	  else
+	    cp_parser_late_parsing_for_member (parser, fn);
 	}
     }
 
@@ -17366,6 +17401,158 @@ cp_parser_late_parsing_for_member (cp_parser* parser, tree member_function)
     = TREE_CHAIN (parser->unparsed_functions_queues);
 }
 
+/* Returns TRUE if the parsing of the body of the inline member
+   function FN, whose class has just been completed, can be put off
+   until FN is needed.  Functions that may be emitted without being
+   used, and those whose bodies depend on more than the names in scope,
+   are always parsed right away.  */
+
+static bool
+cp_parser_defer_body_p (tree fn)
+{
+  return (flag_defer_inline_bodies
+	  /* Checking the syntax means checking all of it.  */
+	  && !flag_syntax_only
+	  /* The saved tokens cannot be written to a PCH.  */
+	  && !pch_file
+	  && !flag_keep_inline_functions
+	  && !processing_template_decl
+	  /* Not in a local class.  */
+	  && !current_function_decl
+	  && current_lang_name == lang_name_cplusplus
+	  && TREE_CODE (fn) == FUNCTION_DECL
+	  && DECL_FUNCTION_MEMBER_P (fn)
+	  && DECL_PENDING_INLINE_P (fn)
+	  && DECL_DECLARED_INLINE_P (fn)
+	  && !DECL_VIRTUAL_P (fn)
+	  /* Nor functions that are emitted whether or not they are used,
+	     as decl_needed_p and the callgraph decide that.  */
+	  && !DECL_PRESERVE_P (fn)
+	  && !DECL_STATIC_CONSTRUCTOR (fn)
+	  && !DECL_STATIC_DESTRUCTOR (fn)
+	  && !lookup_attribute ("externally_visible", DECL_ATTRIBUTES (fn))
+	  && !CLASSTYPE_INTERFACE_KNOWN (DECL_CONTEXT (fn)));
+}
+
+/* Returns the name of the operator functions for the operator token
+   of type TYPE, or NULL_TREE if there are none.  */
+
+static tree
+cp_parser_operator_token_name (enum cpp_ttype type)
+{
+  tree name = operator_token_names[type];
+
+  if (!name)
+    {
+      const char *spelling = cpp_type2name (type);
+
+      /* The operator names were all created by init_operators.  */
+      if (spelling)
+	name = maybe_get_identifier (ACONCAT (("operator", spelling, NULL)));
+      if (!name)
+	name = error_mark_node;
+      operator_token_names[type] = name;
+    }
+
+  return name == error_mark_node ? NULL_TREE : name;
+}
+
+/* Put off parsing the body of the inline member function FN until it
+   is needed, or until a declaration of one of the names it uses would
+   change what it means.  */
+
+static void
+cp_parser_defer_body (tree fn)
+{
+  cp_token_cache *tokens = DECL_PENDING_INLINE_INFO (fn);
+  cp_token *token;
+
+  if (!deferred_inline_body_names)
+    deferred_inline_body_names = pointer_set_create ();
+
+  for (token = tokens->first; token != tokens->last; ++token)
+    {
+      tree name = NULL_TREE;
+
+      if (token->type == CPP_NAME)
+	name = token->u.value;
+      else if (token->type == CPP_KEYWORD
+	       && (token->keyword == RID_NEW || token->keyword == RID_DELETE))
+	{
+	  /* The allocation functions are looked up implicitly.  */
+	  pointer_set_insert (deferred_inline_body_names,
+			      ansi_opname (NEW_EXPR));
+	  pointer_set_insert (deferred_inline_body_names,
+			      ansi_opname (VEC_NEW_EXPR));
+	  pointer_set_insert (deferred_inline_body_names,
+			      ansi_opname (DELETE_EXPR));
+	  pointer_set_insert (deferred_inline_body_names,
+			      ansi_opname (VEC_DELETE_EXPR));
+	}
+      else if (token->type <= CPP_LAST_PUNCTUATOR)
+	name = cp_parser_operator_token_name (token->type);
+
+      if (name)
+	pointer_set_insert (deferred_inline_body_names, name);
+    }
+
+  deferred_inline_bodies = tree_cons (NULL_TREE, fn, deferred_inline_bodies);
+  deferred_inline_bodies_type_uid = next_type_uid_value ();
+}
+
+/* Parse the deferred bodies of the inline functions FNS, a TREE_LIST,
+   in the middle of whatever PARSER is doing.  */
+
+static void
+cp_parser_parse_deferred_bodies (cp_parser *parser, tree fns)
+{
+  cp_parser saved_parser = *parser;
+  location_t saved_loc = input_location;
+  int saved_in_system_header = in_system_header;
+  int saved_input_file_stack_tick = input_file_stack_tick;
+
+  /* Parse the bodies as at the end of their classes, outside of any
+     declaration in progress.  */
+  parser->scope = NULL_TREE;
+  parser->object_scope = NULL_TREE;
+  parser->qualifying_scope = NULL_TREE;
+  parser->context = cp_parser_context_new (NULL);
+  parser->greater_than_is_operator_p = true;
+  parser->default_arg_ok_p = true;
+  parser->integral_constant_expression_p = false;
+  parser->allow_non_integral_constant_expression_p = false;
+  parser->non_integral_constant_expression_p = false;
+  parser->local_variables_forbidden_p = false;
+  parser->in_unbraced_linkage_specification_p = false;
+  parser->in_declarator_p = false;
+  parser->in_template_argument_list_p = false;
+  parser->in_statement = 0;
+  parser->in_switch_statement_p = false;
+  parser->in_type_id_in_expr_p = false;
+  parser->in_function_body = false;
+  parser->type_definition_forbidden_message = NULL;
+  parser->num_classes_being_defined = 0;
+  parser->num_template_parameter_lists = 0;
+
+  push_to_top_level ();
+  push_deferring_access_checks (dk_no_deferred);
+  /* The declaration being parsed has live data on the stack; we must
+     not collect garbage.  */
+  ++function_depth;
+
+  for (; fns; fns = TREE_CHAIN (fns))
+    cp_parser_late_parsing_for_member (parser, TREE_VALUE (fns));
+
+  --function_depth;
+  pop_deferring_access_checks ();
+  pop_from_top_level ();
+
+  *parser = saved_parser;
+  input_location = saved_loc;
+  in_system_header = saved_in_system_header;
+  restore_input_file_stack (saved_input_file_stack_tick);
+}
+
 /* If DECL contains any default args, remember it on the unparsed
    functions queue.  */
 
@@ -20641,7 +20828,87 @@ c_parse_file (void)
   push_deferring_access_checks (flag_access_control
 				? dk_no_deferred : dk_no_check);
   error_occurred = cp_parser_translation_unit (the_parser);
-  the_parser = NULL;
+  /* Keep the parser for the deferred inline function bodies.  */
+  if (!deferred_inline_bodies)
+    the_parser = NULL;
+}
+
+/* A declaration of NAME at namespace scope is about to be made.  Parse
+   the deferred inline function bodies that could refer to it first.
+   If NAME is NULL_TREE, parse all of them.  */
+
+void
+parse_deferred_inline_bodies (tree name)
+{
+  tree fns;
+
+  if (!deferred_inline_bodies)
+    return;
+
+  if (name && TREE_CODE (name) == TEMPLATE_ID_EXPR)
+    name = TREE_OPERAND (name, 0);
+  if (name && TREE_CODE (name) == IDENTIFIER_NODE
+      && !pointer_set_contains (deferred_inline_body_names, name))
+    return;
+
+  fns = nreverse (deferred_inline_bodies);
+  deferred_inline_bodies = NULL_TREE;
+  pointer_set_destroy (deferred_inline_body_names);
+  deferred_inline_body_names = NULL;
+
+  cp_parser_parse_deferred_bodies (the_parser, fns);
+}
+
+/* The class TYPE is about to be defined.  Parse the deferred inline
+   function bodies that could see its definition first: all of them if
+   TYPE was declared before a body was deferred, else those that use
+   its name.  */
+
+void
+parse_deferred_inline_bodies_for_class (tree type)
+{
+  if (!deferred_inline_bodies)
+    return;
+
+  if (TYPE_UID (type) < deferred_inline_bodies_type_uid)
+    parse_deferred_inline_bodies (NULL_TREE);
+  else
+    parse_deferred_inline_bodies (TYPE_IDENTIFIER (type));
+}
+
+/* Parse the deferred inline function bodies of the functions that
+   have been used.  Called at the end of the translation unit.  Returns
+   TRUE if any were parsed.  */
+
+bool
+parse_needed_inline_bodies (void)
+{
+  tree *p = &deferred_inline_bodies;
+  tree needed = NULL_TREE;
+
+  while (*p)
+    {
+      tree fn = TREE_VALUE (*p);
+
+      if (TREE_USED (fn)
+	  || (DECL_ASSEMBLER_NAME_SET_P (fn)
+	      && TREE_SYMBOL_REFERENCED (DECL_ASSEMBLER_NAME (fn))))
+	{
+	  tree next = TREE_CHAIN (*p);
+
+	  TREE_CHAIN (*p) = needed;
+	  needed = *p;
+	  *p = next;
+	}
+      else
+	p = &TREE_CHAIN (*p);
+    }
+
+  if (!needed)
+    return false;
+
+  cp_parser_parse_deferred_bodies (the_parser, needed);
+  return true;
 }
 
 #include "gt-cp-parser.h"
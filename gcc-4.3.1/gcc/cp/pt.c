@@ -45,6 +45,7 @@ along with GCC; see the file COPYING3.  If not see
 #include "timevar.h"
 #include "tree-iterator.h"
 #include "vecprim.h"
+#include "params.h"
 
 /* The type of functions taking a tree, and some additional data, and
    returning an int.  */
@@ -876,6 +877,221 @@ optimize_specialization_lookup_p (tree tmpl)
 	  && !DECL_FRIEND_P (DECL_TEMPLATE_RESULT (tmpl)));
 }
 
+/* An entry in the tables of specializations below.  CELL is the
+   TREE_LIST node for the specialization on the list of
+   specializations or instantiations of TMPL; ARGS is its TREE_PURPOSE,
+   the template arguments, and HASH the hash of TMPL and ARGS.  A key
+   for a lookup has no CELL.  */
+
+struct spec_entry GTY(())
+{
+  tree tmpl;
+  tree args;
+  tree cell;
+  hashval_t hash;
+};
+
+/* Tables that index the DECL_TEMPLATE_SPECIALIZATIONS lists of
+   templates and the DECL_TEMPLATE_INSTANTIATIONS lists of class
+   templates by template and arguments, so that a lookup does not
+   walk the whole list.  The partial specializations of a class
+   template, which are on its DECL_TEMPLATE_SPECIALIZATIONS list, are
+   few and are not indexed.  */
+
+static GTY ((param_is (struct spec_entry))) htab_t decl_specializations;
+static GTY ((param_is (struct spec_entry))) htab_t type_specializations;
+
+/* Combine VAL with a hash of the template argument ARG that is the
+   same for all arguments template_args_equal considers equal.  */
+
+static hashval_t
+iterative_hash_template_arg (tree arg, hashval_t val)
+{
+  enum tree_code code;
+
+  if (arg == NULL_TREE)
+    return val;
+
+  code = TREE_CODE (arg);
+  if (code == TREE_VEC)
+    {
+      int i;
+
+      /* Hash the arguments as comp_template_args compares them.  */
+      arg = expand_template_argument_pack (arg);
+      for (i = 0; i < TREE_VEC_LENGTH (arg); ++i)
+	val = iterative_hash_template_arg (TREE_VEC_ELT (arg, i), val);
+      return val;
+    }
+
+  /* Pack expansions, and types that need structural comparison, only
+     hash their code.  */
+  if (PACK_EXPANSION_P (arg))
+    return iterative_hash_object (code, val);
+
+  if (TYPE_P (arg))
+    {
+      if (USE_CANONICAL_TYPES && !TYPE_STRUCTURAL_EQUALITY_P (arg))
+	return iterative_hash_object (TYPE_UID (TYPE_CANONICAL (arg)), val);
+      return iterative_hash_object (code, val);
+    }
+
+  /* Look through the conversions cp_tree_equal looks through.  */
+  while (code == NOP_EXPR || code == CONVERT_EXPR
+	 || code == NON_LVALUE_EXPR)
+    {
+      arg = TREE_OPERAND (arg, 0);
+      code = TREE_CODE (arg);
+    }
+  val = iterative_hash_object (code, val);
+
+  switch (code)
+    {
+    case INTEGER_CST:
+    case VAR_DECL:
+    case FUNCTION_DECL:
+    case CONST_DECL:
+    case TEMPLATE_DECL:
+      return iterative_hash_expr (arg, val);
+
+    case ADDR_EXPR:
+      return iterative_hash_template_arg (TREE_OPERAND (arg, 0), val);
+
+    case PTRMEM_CST:
+      return iterative_hash_expr (PTRMEM_CST_MEMBER (arg), val);
+
+    default:
+      /* Anything else compares by structure; leave it to
+	 comp_template_args.  */
+      return val;
+    }
+}
+
+/* Return the hash of the specialization of TMPL for ARGS.  */
+
+static hashval_t
+hash_tmpl_and_args (tree tmpl, tree args)
+{
+  return iterative_hash_template_arg (args, htab_hash_pointer (tmpl));
+}
+
+/* Return the hash of P, an entry in the tables of specializations.  */
+
+static hashval_t
+hash_specialization (const void *p)
+{
+  return ((const struct spec_entry *) p)->hash;
+}
+
+/* Return nonzero if the entry P1 of the tables of specializations is
+   for the template and arguments of the key P2.  */
+
+static int
+eq_specializations (const void *p1, const void *p2)
+{
+  const struct spec_entry *e1 = (const struct spec_entry *) p1;
+  const struct spec_entry *e2 = (const struct spec_entry *) p2;
+
+  return (e1->tmpl == e2->tmpl
+	  && comp_template_args (e1->args, e2->args));
+}
+
+/* Return the table that indexes the list of specializations of TMPL
+   that retrieve_specialization searches for CLASS_SPECIALIZATIONS_P,
+   or NULL if that list is not indexed.  */
+
+static htab_t *
+specializations_table (tree tmpl, bool class_specializations_p)
+{
+  if (TREE_CODE (DECL_TEMPLATE_RESULT (tmpl)) == TYPE_DECL
+      && TAGGED_TYPE_P (TREE_TYPE (tmpl)))
+    return class_specializations_p ? NULL : &type_specializations;
+  return &decl_specializations;
+}
+
+/* Return the slot for the specialization of TMPL for ARGS, whose hash
+   is HASH, in *TABLE.  INSERT is as for htab_find_slot.  */
+
+static struct spec_entry **
+find_specialization_slot (htab_t *table, tree tmpl, tree args,
+			  hashval_t hash, enum insert_option insert)
+{
+  struct spec_entry key;
+
+  if (*table == NULL)
+    {
+      if (insert == NO_INSERT)
+	return NULL;
+      *table = htab_create_ggc (37, hash_specialization,
+				eq_specializations, NULL);
+    }
+
+  key.tmpl = tmpl;
+  key.args = args;
+  key.cell = NULL_TREE;
+  return (struct spec_entry **) htab_find_slot_with_hash (*table, &key, hash,
+							   insert);
+}
+
+/* Enter CELL, a node of the list of specializations or instantiations
+   of TMPL, in *TABLE, unless there is already an entry for the same
+   arguments.  */
+
+static void
+record_specialization (htab_t *table, tree tmpl, tree cell)
+{
+  hashval_t hash = hash_tmpl_and_args (tmpl, TREE_PURPOSE (cell));
+  struct spec_entry **slot
+    = find_specialization_slot (table, tmpl, TREE_PURPOSE (cell), hash,
+				INSERT);
+
+  if (*slot == NULL)
+    {
+      struct spec_entry *entry = GGC_NEW (struct spec_entry);
+
+      entry->tmpl = tmpl;
+      entry->args = TREE_PURPOSE (cell);
+      entry->cell = cell;
+      entry->hash = hash;
+      *slot = entry;
+    }
+}
+
+/* Remove CELL, a node of the list of specializations or instantiations
+   of TMPL, from *TABLE.  Return true if it was there.  */
+
+static bool
+forget_specialization (htab_t *table, tree tmpl, tree cell)
+{
+  struct spec_entry **slot
+    = find_specialization_slot (table, tmpl, TREE_PURPOSE (cell),
+				hash_tmpl_and_args (tmpl,
+						    TREE_PURPOSE (cell)),
+				NO_INSERT);
+
+  if (slot == NULL || (*slot)->cell != cell)
+    return false;
+  htab_clear_slot (*table, (void **) slot);
+  return true;
+}
+
+/* Append the specializations of the template FROM to those of the
+   template TO, when FROM turns out to be a redeclaration of TO.  */
+
+void
+merge_specializations (tree to, tree from)
+{
+  tree t;
+
+  for (t = DECL_TEMPLATE_SPECIALIZATIONS (from); t; t = TREE_CHAIN (t))
+    if (forget_specialization (&decl_specializations, from, t))
+      record_specialization (&decl_specializations, to, t);
+
+  DECL_TEMPLATE_SPECIALIZATIONS (to)
+    = chainon (DECL_TEMPLATE_SPECIALIZATIONS (to),
+	       DECL_TEMPLATE_SPECIALIZATIONS (from));
+}
+
 /* Retrieve the specialization (in the sense of [temp.spec] - a
    specialization is either an instantiation or an explicit
    specialization) of TMPL for the given template ARGS.  If there is
@@ -938,16 +1154,25 @@ retrieve_specialization (tree tmpl, tree args,
     {
       tree *sp;
       tree *head;
+      htab_t *table;
 
       /* Class templates store their instantiations on the
 	 DECL_TEMPLATE_INSTANTIATIONS list; other templates use the
-	 DECL_TEMPLATE_SPECIALIZATIONS list.  */
-      if (!class_specializations_p
-	  && TREE_CODE (DECL_TEMPLATE_RESULT (tmpl)) == TYPE_DECL
-	  && TAGGED_TYPE_P (TREE_TYPE (tmpl)))
-	sp = &DECL_TEMPLATE_INSTANTIATIONS (tmpl);
-      else
-	sp = &DECL_TEMPLATE_SPECIALIZATIONS (tmpl);
+	 DECL_TEMPLATE_SPECIALIZATIONS list.  Both are indexed by a
+	 hash table, except for the partial specializations of class
+	 templates.  */
+      table = specializations_table (tmpl, class_specializations_p);
+      if (table)
+	{
+	  struct spec_entry **slot
+	    = find_specialization_slot (table, tmpl, args,
+					hash_tmpl_and_args (tmpl, args),
+					NO_INSERT);
+
+	  return slot ? TREE_VALUE ((*slot)->cell) : NULL_TREE;
+	}
+
+      sp = &DECL_TEMPLATE_SPECIALIZATIONS (tmpl);
       head = sp;
       /* Iterate through the list until we find a matching template.  */
       while (*sp != NULL_TREE)
@@ -1316,8 +1541,12 @@ register_specialization (tree spec, tree tmpl, tree args, bool is_friend)
     DECL_CONTEXT (spec) = FROB_CONTEXT (decl_namespace_context (tmpl));
 
   if (!optimize_specialization_lookup_p (tmpl))
-    DECL_TEMPLATE_SPECIALIZATIONS (tmpl)
-      = tree_cons (args, spec, DECL_TEMPLATE_SPECIALIZATIONS (tmpl));
+    {
+      DECL_TEMPLATE_SPECIALIZATIONS (tmpl)
+	= tree_cons (args, spec, DECL_TEMPLATE_SPECIALIZATIONS (tmpl));
+      record_specialization (&decl_specializations, tmpl,
+			     DECL_TEMPLATE_SPECIALIZATIONS (tmpl));
+    }
 
   return spec;
 }
@@ -1337,7 +1566,10 @@ reregister_specialization (tree spec, tree tmpl, tree new_spec)
     if (TREE_VALUE (*s) == spec)
       {
 	if (!new_spec)
-	  *s = TREE_CHAIN (*s);
+	  {
+	    forget_specialization (&decl_specializations, tmpl, *s);
+	    *s = TREE_CHAIN (*s);
+	  }
 	else
 	  TREE_VALUE (*s) = new_spec;
 	return 1;
@@ -5324,6 +5556,9 @@ comp_template_args (tree oldargs, tree newargs)
 {
   int i;
 
+  if (oldargs == newargs)
+    return 1;
+
   oldargs = expand_template_argument_pack (oldargs);
   newargs = expand_template_argument_pack (newargs);
 
@@ -5886,6 +6121,8 @@ lookup_template_class (tree d1,
       DECL_TEMPLATE_INSTANTIATIONS (template)
 	= tree_cons (arglist, t,
 		     DECL_TEMPLATE_INSTANTIATIONS (template));
+      record_specialization (&type_specializations, template,
+			     DECL_TEMPLATE_INSTANTIATIONS (template));
 
       if (TREE_CODE (t) == ENUMERAL_TYPE
 	  && !is_partial_instantiation)
@@ -6501,9 +6738,7 @@ tsubst_friend_function (tree decl, tree args)
 		  t = most_general_template (old_decl);
 		  if (t != old_decl)
 		    {
-		      DECL_TEMPLATE_SPECIALIZATIONS (t)
-			= chainon (DECL_TEMPLATE_SPECIALIZATIONS (t),
-				   DECL_TEMPLATE_SPECIALIZATIONS (old_decl));
+		      merge_specializations (t, old_decl);
 		      DECL_TEMPLATE_SPECIALIZATIONS (old_decl) = NULL_TREE;
 		    }
 		}
@@ -7639,6 +7874,173 @@ tsubst_template_parms (tree parms, tree args, tsubst_flags_t complain)
   return r;
 }
 
+/* An entry in the cache of substitutions into class template-ids:
+   substituting arguments equal to ARGS into the type T with
+   ENTERING_SCOPE, as tsubst_aggr_type does, gave RESULT.  ARGS is a
+   copy, since argument vectors are sometimes changed in place.  HASH
+   is the hash of T, ENTERING_SCOPE and ARGS.  */
+
+struct tsubst_memo_entry GTY(())
+{
+  tree t;
+  tree args;
+  tree result;
+  int entering_scope;
+  hashval_t hash;
+};
+
+/* The cache of substitutions into class template-ids.  Instantiating
+   a class substitutes the same arguments into the same types again
+   and again; each hit saves substituting into the template arguments
+   of T and looking the instantiation up.  Entries go away when T is
+   collected.  */
+
+static GTY ((if_marked ("tsubst_memo_marked_p"),
+	     param_is (struct tsubst_memo_entry))) htab_t tsubst_memo;
+
+/* Return true if the template arguments ARGS can key the substitution
+   cache: they are all present and all types.  Other arguments are
+   expressions, whose substitution may depend on more than the
+   arguments.  Deduction substitutes into default arguments with a
+   vector that still has NULL entries for the arguments not yet
+   deduced.  */
+
+static bool
+tsubst_memo_args_p (tree args)
+{
+  int i;
+
+  for (i = 0; i < TREE_VEC_LENGTH (args); ++i)
+    {
+      tree arg = TREE_VEC_ELT (args, i);
+
+      if (arg == NULL_TREE)
+	return false;
+      if (TREE_CODE (arg) == TREE_VEC
+	  ? !tsubst_memo_args_p (arg)
+	  : (!TYPE_P (arg) || PACK_EXPANSION_P (arg)
+	     || ARGUMENT_PACK_P (arg)))
+	return false;
+    }
+  return true;
+}
+
+/* Combine VAL with a hash of the identities of the arguments ARGS,
+   which tsubst_memo_args_p accepts.  */
+
+static hashval_t
+tsubst_memo_hash_args (tree args, hashval_t val)
+{
+  int i;
+
+  val = iterative_hash_object (TREE_VEC_LENGTH (args), val);
+  for (i = 0; i < TREE_VEC_LENGTH (args); ++i)
+    {
+      tree arg = TREE_VEC_ELT (args, i);
+
+      if (TREE_CODE (arg) == TREE_VEC)
+	val = tsubst_memo_hash_args (arg, val);
+      else
+	val = iterative_hash_object (arg, val);
+    }
+  return val;
+}
+
+/* Return true if the arguments ARGS1 and ARGS2 are the same nodes.  */
+
+static bool
+tsubst_memo_args_eq (tree args1, tree args2)
+{
+  int i;
+
+  if (TREE_VEC_LENGTH (args1) != TREE_VEC_LENGTH (args2))
+    return false;
+  for (i = 0; i < TREE_VEC_LENGTH (args1); ++i)
+    {
+      tree arg1 = TREE_VEC_ELT (args1, i);
+      tree arg2 = TREE_VEC_ELT (args2, i);
+
+      if (TREE_CODE (arg1) == TREE_VEC && TREE_CODE (arg2) == TREE_VEC
+	  ? !tsubst_memo_args_eq (arg1, arg2)
+	  : arg1 != arg2)
+	return false;
+    }
+  return true;
+}
+
+/* Return a copy of the vector of arguments ARGS and its levels.  */
+
+static tree
+tsubst_memo_copy_args (tree args)
+{
+  tree copy = copy_node (args);
+  int i;
+
+  for (i = 0; i < TREE_VEC_LENGTH (args); ++i)
+    if (TREE_CODE (TREE_VEC_ELT (args, i)) == TREE_VEC)
+      TREE_VEC_ELT (copy, i) = tsubst_memo_copy_args (TREE_VEC_ELT (args, i));
+  return copy;
+}
+
+/* Return the hash of P, an entry of the substitution cache.  */
+
+static hashval_t
+tsubst_memo_hash (const void *p)
+{
+  return ((const struct tsubst_memo_entry *) p)->hash;
+}
+
+/* Return nonzero if the entries P1 and P2 of the substitution cache
+   are for the same substitution.  */
+
+static int
+tsubst_memo_eq (const void *p1, const void *p2)
+{
+  const struct tsubst_memo_entry *e1 = (const struct tsubst_memo_entry *) p1;
+  const struct tsubst_memo_entry *e2 = (const struct tsubst_memo_entry *) p2;
+
+  return (e1->t == e2->t
+	  && e1->entering_scope == e2->entering_scope
+	  && tsubst_memo_args_eq (e1->args, e2->args));
+}
+
+/* Return nonzero if the entry P of the substitution cache is still
+   live.  */
+
+static int
+tsubst_memo_marked_p (const void *p)
+{
+  return ggc_marked_p (((const struct tsubst_memo_entry *) p)->t);
+}
+
+/* Return the slot of the substitution cache for substituting ARGS into
+   T with ENTERING_SCOPE.  INSERT is as for htab_find_slot.  */
+
+static struct tsubst_memo_entry **
+tsubst_memo_slot (tree t, tree args, int entering_scope,
+		  enum insert_option insert)
+{
+  struct tsubst_memo_entry key;
+
+  if (tsubst_memo == NULL)
+    {
+      if (insert == NO_INSERT)
+	return NULL;
+      tsubst_memo = htab_create_ggc (37, tsubst_memo_hash, tsubst_memo_eq,
+				     NULL);
+    }
+
+  key.t = t;
+  key.args = args;
+  key.entering_scope = entering_scope;
+  return (struct tsubst_memo_entry **)
+    htab_find_slot_with_hash (tsubst_memo, &key,
+			      tsubst_memo_hash_args (args,
+						     htab_hash_pointer (t)
+						     + entering_scope),
+			      insert);
+}
+
 /* Substitute the ARGS into the indicated aggregate (or enumeration)
    type T.  If T is not an aggregate or enumeration type, it is
    handled as if by tsubst.  IN_DECL is as for tsubst.  If
@@ -7670,6 +8072,21 @@ tsubst_aggr_type (tree t,
 	  tree context;
 	  tree r;
 	  bool saved_skip_evaluation;
+	  bool memo_p;
+	  struct tsubst_memo_entry **slot;
+
+	  /* The substitution only depends on T and ARGS when we are
+	     not in a template and all the arguments are types.  */
+	  memo_p = (!processing_template_decl
+		    && args != NULL_TREE
+		    && tsubst_memo_args_p (args)
+		    && tsubst_memo_args_p (TYPE_TI_ARGS (t)));
+	  if (memo_p)
+	    {
+	      slot = tsubst_memo_slot (t, args, entering_scope, NO_INSERT);
+	      if (slot)
+		return (*slot)->result;
+	    }
 
 	  /* In "sizeof(X<I>)" we need to evaluate "I".  */
 	  saved_skip_evaluation = skip_evaluation;
@@ -7710,6 +8127,25 @@ tsubst_aggr_type (tree t,
 
 	  skip_evaluation = saved_skip_evaluation;
 
+	  /* ARGS may have been filled in meanwhile, so check it again.  */
+	  if (memo_p && r != error_mark_node && tsubst_memo_args_p (args))
+	    {
+	      slot = tsubst_memo_slot (t, args, entering_scope, INSERT);
+	      if (*slot == NULL)
+		{
+		  struct tsubst_memo_entry *e
+		    = GGC_NEW (struct tsubst_memo_entry);
+
+		  e->t = t;
+		  e->args = tsubst_memo_copy_args (args);
+		  e->result = r;
+		  e->entering_scope = entering_scope;
+		  e->hash = htab_hash_pointer (t) + entering_scope;
+		  e->hash = tsubst_memo_hash_args (args, e->hash);
+		  *slot = e;
+		}
+	    }
+
 	  return r;
 	}
       else
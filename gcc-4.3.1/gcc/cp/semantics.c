@@ -2255,6 +2255,8 @@ begin_class_definition (tree t, tree attributes)
       t = make_aggr_type (TREE_CODE (t));
       pushtag (TYPE_IDENTIFIER (t), t, /*tag_scope=*/ts_current);
     }
+  /* Deferred inline function bodies must not see the definition of T.  */
+  parse_deferred_inline_bodies_for_class (t);
   maybe_process_partial_specialization (t);
   pushclass (t);
   TYPE_BEING_DEFINED (t) = 1;
@@ -727,6 +727,15 @@ copy_node_stat (tree node MEM_STAT_DECL)
   return t;
 }
 
+/* Return the TYPE_UID that the next type created will get.  Every
+   type that exists now has a smaller one.  */
+
+int
+next_type_uid_value (void)
+{
+  return next_type_uid;
+}
+
 /* Return a copy of a chain of nodes, chained through the TREE_CHAIN field.
    For example, this can copy a list made of TREE_LIST nodes.  */
 
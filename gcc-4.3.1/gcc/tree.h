@@ -3891,6 +3891,10 @@ extern tree make_node_stat (enum tree_code MEM_STAT_DECL);
 extern tree copy_node_stat (tree MEM_STAT_DECL);
 #define copy_node(t) copy_node_stat (t MEM_STAT_INFO)
 
+/* Return the TYPE_UID that the next type created will get.  */
+
+extern int next_type_uid_value (void);
+
 /* Make a copy of a chain of TREE_LIST nodes.  */
 
 extern tree copy_list (tree);
@@ -32,8 +32,14 @@ see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
 #define GET_ENVIRONMENT(VALUE, NAME) do { (VALUE) = getenv (NAME); } while (0)
 #endif
 
-#define obstack_chunk_alloc	((void *(*) (long)) xmalloc)
-#define obstack_chunk_free	((void (*) (void *)) free)
+/* Obstack chunks come from libiberty's xobstack.c, which keeps freed
+   chunks for reuse instead of returning them to malloc.  Its cache is
+   not locked; that is safe because GCC's programs are single-threaded.  */
+extern void *xobstack_chunk_alloc (long);
+extern void xobstack_chunk_free (void *);
+
+#define obstack_chunk_alloc	xobstack_chunk_alloc
+#define obstack_chunk_free	xobstack_chunk_free
 #define OBSTACK_CHUNK_SIZE	0
 #define gcc_obstack_init(OBSTACK)			\
   _obstack_begin ((OBSTACK), OBSTACK_CHUNK_SIZE, 0,	\
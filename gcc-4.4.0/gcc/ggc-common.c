@@ -25,6 +25,7 @@ along with GCC; see the file COPYING3.  If not see
 #include "system.h"
 #include "coretypes.h"
 #include "hashtab.h"
+#include "sort.h"
 #include "ggc.h"
 #include "toplev.h"
 #include "params.h"
@@ -65,7 +66,7 @@ static hashval_t saving_htab_hash (const void *);
 static int saving_htab_eq (const void *, const void *);
 static int call_count (void **, void *);
 static int call_alloc (void **, void *);
-static int compare_ptr_data (const void *, const void *);
+static size_t ptr_data_new_addr (const void *, void *);
 static void relocate_ptrs (void *, void *);
 static void write_pch_globals (const struct ggc_root_tab * const *tab,
 			       struct traversal_state *state);
@@ -395,15 +396,13 @@ call_alloc (void **slot, void *state_p)
   return 1;
 }
 
-/* Callback for qsort.  */
+/* Callback for sort_by_key.  */
 
-static int
-compare_ptr_data (const void *p1_p, const void *p2_p)
+static size_t
+ptr_data_new_addr (const void *p_p, void *data ATTRIBUTE_UNUSED)
 {
-  const struct ptr_data *const p1 = *(const struct ptr_data *const *)p1_p;
-  const struct ptr_data *const p2 = *(const struct ptr_data *const *)p2_p;
-  return (((size_t)p1->new_addr > (size_t)p2->new_addr)
-	  - ((size_t)p1->new_addr < (size_t)p2->new_addr));
+  const struct ptr_data *const p = *(const struct ptr_data *const *)p_p;
+  return (size_t)p->new_addr;
 }
 
 /* Callbacks for note_ptr_fn.  */
@@ -514,7 +513,10 @@ gt_pch_save (FILE *f)
   state.ptrs = XNEWVEC (struct ptr_data *, state.count);
   state.ptrs_i = 0;
   htab_traverse (saving_htab, call_alloc, &state);
-  qsort (state.ptrs, state.count, sizeof (*state.ptrs), compare_ptr_data);
+  /* There is one entry per object written, which can be millions;
+     a radix sort on the new addresses is much cheaper than qsort.  */
+  sort_by_key (state.ptrs, state.count, sizeof (*state.ptrs),
+	       ptr_data_new_addr, NULL);
 
   /* Write out all the scalar variables.  */
   for (rt = gt_pch_scalar_rtab; *rt; rt++)
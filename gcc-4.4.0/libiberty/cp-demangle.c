@@ -189,14 +189,43 @@ static void d_init_info (const char *, int, size_t, struct d_info *);
 #endif /* defined (__STDC__) */
 #endif /* ! defined (__GNUC__) */
 
+/* Demangler option asking for bounded stack use, for callers such as
+   profilers and crash handlers that demangle on small thread stacks.
+   With it, the callback interfaces, which must not allocate, reject
+   names whose components and substitutions need more than
+   CP_DEMANGLE_STACK_LIMIT bytes of stack, and the interfaces that
+   return malloc'd strings get them from malloc instead; and printing
+   gives up on names nested deeper than CP_DEMANGLE_PRINT_DEPTH_LIMIT.
+   Without it, any name is demangled, with stack use that grows with
+   the length of the name.  */
+
+#ifndef DMGL_BOUNDED_STACK
+#define DMGL_BOUNDED_STACK (1 << 19)
+#endif
+
+/* The most stack space DMGL_BOUNDED_STACK allows for the components
+   and substitutions of a name.  The demangler needs about 60 bytes per
+   character of the mangled name.  */
+
+#ifndef CP_DEMANGLE_STACK_LIMIT
+#define CP_DEMANGLE_STACK_LIMIT (64 * 1024)
+#endif
+
+/* The deepest nesting of components DMGL_BOUNDED_STACK lets the
+   printer follow, since it recurses once per level.  */
+
+#ifndef CP_DEMANGLE_PRINT_DEPTH_LIMIT
+#define CP_DEMANGLE_PRINT_DEPTH_LIMIT 1024
+#endif
+
 /* We avoid pulling in the ctype tables, to prevent pulling in
    additional unresolved symbols when this code is used in a library.
    FIXME: Is this really a valid reason?  This comes from the original
    V3 demangler code.
 
    As of this writing this file has the following undefined references
-   when compiled with -DIN_GLIBCPP_V3: realloc, free, memcpy, strcpy,
-   strcat, strlen.  */
+   when compiled with -DIN_GLIBCPP_V3: malloc, realloc, free, memcpy,
+   strcpy, strcat, strlen.  */
 
 #define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
 #define IS_UPPER(c) ((c) >= 'A' && (c) <= 'Z')
@@ -302,6 +331,8 @@ struct d_print_info
   /* The current index into any template argument packs we are using
      for printing.  */
   int pack_index;
+  /* The current nesting depth of d_print_comp.  */
+  int depth;
 };
 
 #ifdef CP_DEMANGLE_DEBUG
@@ -445,6 +476,9 @@ static inline char d_last_char (struct d_print_info *);
 static void
 d_print_comp (struct d_print_info *, const struct demangle_component *);
 
+static void
+d_print_comp_1 (struct d_print_info *, const struct demangle_component *);
+
 static void
 d_print_java_identifier (struct d_print_info *, const char *, int);
 
@@ -470,6 +504,8 @@ d_print_expr_op (struct d_print_info *, const struct demangle_component *);
 static void
 d_print_cast (struct d_print_info *, const struct demangle_component *);
 
+static int d_demangle_callback_1 (const char *, int,
+                                  demangle_callbackref, void *, int);
 static int d_demangle_callback (const char *, int,
                                 demangle_callbackref, void *);
 static char *d_demangle (const char *, int, size_t *);
@@ -3067,6 +3103,7 @@ d_print_init (struct d_print_info *dpi, int options,
   dpi->opaque = opaque;
 
   dpi->demangle_failure = 0;
+  dpi->depth = 0;
 }
 
 /* Indicate that an error occurred during printing, and test for error.  */
@@ -3301,11 +3338,31 @@ d_print_subexpr (struct d_print_info *dpi,
     d_append_char (dpi, ')');
 }
 
-/* Subroutine to handle components.  */
+/* Subroutine to handle components.  With DMGL_BOUNDED_STACK, this
+   limits the nesting depth of the components printed, so that the
+   stack used stays bounded.  */
 
 static void
 d_print_comp (struct d_print_info *dpi,
               const struct demangle_component *dc)
+{
+  if ((dpi->options & DMGL_BOUNDED_STACK) != 0
+      && dpi->depth >= CP_DEMANGLE_PRINT_DEPTH_LIMIT)
+    {
+      d_print_error (dpi);
+      return;
+    }
+
+  ++dpi->depth;
+  d_print_comp_1 (dpi, dc);
+  --dpi->depth;
+}
+
+/* Print the component DC for d_print_comp.  */
+
+static void
+d_print_comp_1 (struct d_print_info *dpi,
+                const struct demangle_component *dc)
 {
   if (dc == NULL)
     {
@@ -4475,18 +4532,55 @@ cplus_demangle_init_info (const char *mangled, int options, size_t len,
   di->expansion = 0;
 }
 
+/* Demangle the name set up in DI, whose component and substitution
+   arrays have been allocated, as a type if TYPE is nonzero, and print
+   it with repeated calls of CALLBACK.  OPTIONS is the usual libiberty
+   demangler options.  On success, this returns 1.  On failure, returns
+   0.  */
+
+static int
+d_demangle_and_print (struct d_info *di, int type, int options,
+		      demangle_callbackref callback, void *opaque)
+{
+  struct demangle_component *dc;
+
+  if (type)
+    dc = cplus_demangle_type (di);
+  else
+    dc = cplus_demangle_mangled_name (di, 1);
+
+  /* If DMGL_PARAMS is set, then if we didn't consume the entire
+     mangled string, then we didn't successfully demangle it.  If
+     DMGL_PARAMS is not set, we didn't look at the trailing
+     parameters.  */
+  if (((options & DMGL_PARAMS) != 0) && d_peek_char (di) != '\0')
+    dc = NULL;
+
+#ifdef CP_DEMANGLE_DEBUG
+  d_dump (dc, 0);
+#endif
+
+  return (dc != NULL)
+	 ? cplus_demangle_print_callback (options, dc, callback, opaque)
+	 : 0;
+}
+
 /* Internal implementation for the demangler.  If MANGLED is a g++ v3 ABI
    mangled name, return strings in repeated callback giving the demangled
-   name.  OPTIONS is the usual libiberty demangler options.  On success,
-   this returns 1.  On failure, returns 0.  */
+   name.  OPTIONS is the usual libiberty demangler options.  With
+   DMGL_BOUNDED_STACK in OPTIONS, names too long to demangle within
+   CP_DEMANGLE_STACK_LIMIT get their components from malloc if USE_HEAP
+   is nonzero, and are rejected otherwise.  On success, this returns 1.
+   On failure, returns 0 for a bad or rejected name, or -1 for a memory
+   allocation failure.  */
 
 static int
-d_demangle_callback (const char *mangled, int options,
-                     demangle_callbackref callback, void *opaque)
+d_demangle_callback_1 (const char *mangled, int options,
+                       demangle_callbackref callback, void *opaque,
+                       int use_heap)
 {
   int type;
   struct d_info di;
-  struct demangle_component *dc;
   int status;
 
   if (mangled[0] == '_' && mangled[1] == 'Z')
@@ -4515,42 +4609,57 @@ d_demangle_callback (const char *mangled, int options,
 
   cplus_demangle_init_info (mangled, options, strlen (mangled), &di);
 
-  {
+  if ((options & DMGL_BOUNDED_STACK) == 0
+      || (di.num_comps * sizeof (*di.comps) + di.num_subs * sizeof (*di.subs)
+	  <= CP_DEMANGLE_STACK_LIMIT))
+    {
 #ifdef CP_DYNAMIC_ARRAYS
-    __extension__ struct demangle_component comps[di.num_comps];
-    __extension__ struct demangle_component *subs[di.num_subs];
+      __extension__ struct demangle_component comps[di.num_comps];
+      __extension__ struct demangle_component *subs[di.num_subs];
 
-    di.comps = comps;
-    di.subs = subs;
+      di.comps = comps;
+      di.subs = subs;
 #else
-    di.comps = alloca (di.num_comps * sizeof (*di.comps));
-    di.subs = alloca (di.num_subs * sizeof (*di.subs));
+      di.comps = alloca (di.num_comps * sizeof (*di.comps));
+      di.subs = alloca (di.num_subs * sizeof (*di.subs));
 #endif
 
-    if (type)
-      dc = cplus_demangle_type (&di);
-    else
-      dc = cplus_demangle_mangled_name (&di, 1);
-
-    /* If DMGL_PARAMS is set, then if we didn't consume the entire
-       mangled string, then we didn't successfully demangle it.  If
-       DMGL_PARAMS is not set, we didn't look at the trailing
-       parameters.  */
-    if (((options & DMGL_PARAMS) != 0) && d_peek_char (&di) != '\0')
-      dc = NULL;
+      status = d_demangle_and_print (&di, type, options, callback, opaque);
+    }
+  else if (use_heap)
+    {
+      di.comps = ((struct demangle_component *)
+		  malloc (di.num_comps * sizeof (*di.comps)));
+      di.subs = ((struct demangle_component **)
+		 malloc (di.num_subs * sizeof (*di.subs)));
 
-#ifdef CP_DEMANGLE_DEBUG
-    d_dump (dc, 0);
-#endif
+      if (di.comps != NULL && di.subs != NULL)
+	status = d_demangle_and_print (&di, type, options, callback, opaque);
+      else
+	status = -1;
 
-    status = (dc != NULL)
-             ? cplus_demangle_print_callback (options, dc, callback, opaque)
-             : 0;
-  }
+      free (di.comps);
+      free (di.subs);
+    }
+  else
+    status = 0;
 
   return status;
 }
 
+/* Demangle MANGLED as d_demangle_callback_1 does, for the callback
+   interfaces: without allocating memory, so that with
+   DMGL_BOUNDED_STACK names too long to demangle within
+   CP_DEMANGLE_STACK_LIMIT are rejected.  Returns 1 on success, 0 on
+   failure.  */
+
+static int
+d_demangle_callback (const char *mangled, int options,
+                     demangle_callbackref callback, void *opaque)
+{
+  return d_demangle_callback_1 (mangled, options, callback, opaque, 0);
+}
+
 /* Entry point for the demangler.  If MANGLED is a g++ v3 ABI mangled
    name, return a buffer allocated with malloc holding the demangled
    name.  OPTIONS is the usual libiberty demangler options.  On
@@ -4566,12 +4675,12 @@ d_demangle (const char *mangled, int options, size_t *palc)
 
   d_growable_string_init (&dgs, 0);
 
-  status = d_demangle_callback (mangled, options,
-                                d_growable_string_callback_adapter, &dgs);
-  if (status == 0)
+  status = d_demangle_callback_1 (mangled, options,
+                                  d_growable_string_callback_adapter, &dgs, 1);
+  if (status <= 0)
     {
       free (dgs.buf);
-      *palc = 0;
+      *palc = status < 0 ? 1 : 0;
       return NULL;
     }
 
@@ -70,6 +70,19 @@ extern int errno;
                lib$get_current_invo_context(decc$$get_vfork_jmpbuf()) : -1)
 #endif /* VMS */
 
+/* Start children with posix_spawn where the host has it.  Unlike fork
+   it does not copy the page tables of the parent, which is expensive
+   when the parent is large, such as lto1 or a linker plugin.  Before
+   version 2.24, the GNU C library's posix_spawn reports success when
+   the exec fails, and the child just exits with status 127; the driver
+   would lose its "cannot execute" diagnostic, so use vfork there.  */
+#if defined (_POSIX_SPAWN) && _POSIX_SPAWN > 0 && !defined (VMS) \
+    && (!defined (__GLIBC__) \
+	|| __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 24))
+#define USE_POSIX_SPAWN
+#include <spawn.h>
+#endif
+
 
 /* File mode to use for private and world-readable files.  */
 
@@ -355,6 +368,136 @@ pex_child_error (struct pex_obj *obj, const char *executable,
 
 extern char **environ;
 
+#ifdef USE_POSIX_SPAWN
+
+/* Add to ACTIONS the redirection of the standard descriptor STD_FD to
+   FD, unless it is STD_FD already.  Return an error number or 0.  */
+
+static int
+pex_unix_spawn_redirect (posix_spawn_file_actions_t *actions, int fd,
+			 int std_fd)
+{
+  int ret;
+
+  if (fd == std_fd)
+    return 0;
+  ret = posix_spawn_file_actions_adddup2 (actions, fd, std_fd);
+  if (ret == 0)
+    ret = posix_spawn_file_actions_addclose (actions, fd);
+  return ret;
+}
+
+/* Return the file that execvp would run for PROGRAM when the PATH
+   variable of the environment ENV is the one in effect, in memory
+   allocated with malloc, or NULL if there is no PATH in ENV or no such
+   file.  */
+
+static char *
+pex_unix_search_env_path (const char *program, char * const * env)
+{
+  const char *path = NULL;
+  size_t len = strlen (program);
+  char * const * e;
+
+  for (e = env; *e != NULL; e++)
+    if (strncmp (*e, "PATH=", 5) == 0)
+      {
+	path = *e + 5;
+	break;
+      }
+  if (path == NULL)
+    return NULL;
+
+  for (;;)
+    {
+      const char *end = strchr (path, ':');
+      size_t dirlen = end ? (size_t) (end - path) : strlen (path);
+      char *file = XNEWVEC (char, dirlen + len + 2);
+      struct stat st;
+
+      /* An empty directory name stands for the current directory.  */
+      if (dirlen == 0)
+	strcpy (file, program);
+      else
+	{
+	  memcpy (file, path, dirlen);
+	  file[dirlen] = '/';
+	  strcpy (file + dirlen + 1, program);
+	}
+      if (access (file, X_OK) == 0
+	  && stat (file, &st) == 0 && S_ISREG (st.st_mode))
+	return file;
+      free (file);
+
+      if (end == NULL)
+	return NULL;
+      path = end + 1;
+    }
+}
+
+/* Execute a child with posix_spawn, with the arguments of
+   pex_unix_exec_child.  The descriptors are set up in the child like
+   pex_unix_exec_child does after vfork.  Return the pid of the child,
+   or -1 if it could not be started.  */
+
+static pid_t
+pex_unix_spawn_child (int flags, const char *executable,
+		      char * const * argv, char * const * env,
+		      int in, int out, int errdes, int toclose)
+{
+  posix_spawn_file_actions_t actions;
+  char *found = NULL;
+  pid_t pid;
+  int ret;
+
+  /* posix_spawnp would search the PATH of this process, but the
+     program is to be found in the PATH of ENV, as execvp does after
+     the vfork child has switched to ENV.  */
+  if ((flags & PEX_SEARCH) != 0 && env != NULL
+      && strchr (executable, '/') == NULL)
+    {
+      found = pex_unix_search_env_path (executable, env);
+      if (found == NULL)
+	return (pid_t) -1;
+      executable = found;
+      flags &= ~PEX_SEARCH;
+    }
+
+  if (posix_spawn_file_actions_init (&actions) != 0)
+    {
+      free (found);
+      return (pid_t) -1;
+    }
+
+  ret = pex_unix_spawn_redirect (&actions, in, STDIN_FILE_NO);
+  if (ret == 0)
+    ret = pex_unix_spawn_redirect (&actions, out, STDOUT_FILE_NO);
+  if (ret == 0)
+    ret = pex_unix_spawn_redirect (&actions, errdes, STDERR_FILE_NO);
+  if (ret == 0 && toclose >= 0)
+    ret = posix_spawn_file_actions_addclose (&actions, toclose);
+  if (ret == 0 && (flags & PEX_STDERR_TO_STDOUT) != 0)
+    ret = posix_spawn_file_actions_adddup2 (&actions, STDOUT_FILE_NO,
+					    STDERR_FILE_NO);
+
+  if (ret == 0)
+    {
+      if (env == NULL)
+	env = environ;
+      if ((flags & PEX_SEARCH) != 0)
+	ret = posix_spawnp (&pid, executable, &actions, NULL, argv, env);
+      else
+	ret = posix_spawn (&pid, executable, &actions, NULL, argv, env);
+    }
+
+  posix_spawn_file_actions_destroy (&actions);
+  free (found);
+
+  return ret == 0 ? pid : (pid_t) -1;
+}
+
+#endif /* USE_POSIX_SPAWN */
+
 static pid_t
 pex_unix_exec_child (struct pex_obj *obj, int flags, const char *executable,
 		     char * const * argv, char * const * env,
@@ -370,7 +513,13 @@ pex_unix_exec_child (struct pex_obj *obj, int flags, const char *executable,
 
   sleep_interval = 1;
   pid = -1;
-  for (retries = 0; retries < 4; ++retries)
+#ifdef USE_POSIX_SPAWN
+  /* If posix_spawn fails, for instance because EXECUTABLE cannot be
+     run, use vfork, which reports the error as usual.  */
+  pid = pex_unix_spawn_child (flags, executable, argv, env,
+			      in, out, errdes, toclose);
+#endif
+  for (retries = 0; pid < 0 && retries < 4; ++retries)
     {
       pid = vfork ();
       if (pid >= 0)
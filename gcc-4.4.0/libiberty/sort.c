@@ -41,6 +41,10 @@ Boston, MA 02110-1301, USA.  */
 #define UCHAR_MAX ((unsigned char)(-1))
 #endif
 
+#ifndef CHAR_BIT
+#define CHAR_BIT 8
+#endif
+
 /* POINTERS and WORK are both arrays of N pointers.  When this
    function returns POINTERS will be sorted in ascending order.  */
 
@@ -130,6 +134,103 @@ void sort_pointers (size_t n, void **pointers, void **work)
     }
 }
 
+/* An element to sort by key: its key, and its index in the array
+   being sorted.  */
+
+struct sort_key
+{
+  size_t key;
+  size_t index;
+};
+
+/* Sort the N elements of SIZE bytes at BASE stably in ascending order
+   of the keys KEY returns for them.  KEY is called once per element,
+   with the element and DATA.
+
+   This is a radix sort of the keys; the elements themselves are moved
+   only once, so it is suited to large arrays of records, where qsort
+   would spend most of its time calling the comparison function and
+   swapping records.  */
+
+void
+sort_by_key (void *base, size_t n, size_t size,
+	     size_t (*key) (const void *, void *), void *data)
+{
+  typedef unsigned char digit_t;
+  unsigned int count[DIGIT_MAX];
+  struct sort_key *keys, *work, *tmp;
+  size_t all_or, all_and;
+  char *elts, *sorted;
+  unsigned int shift;
+  size_t i;
+
+  if (n < 2)
+    return;
+
+  keys = XNEWVEC (struct sort_key, n);
+  work = XNEWVEC (struct sort_key, n);
+
+  elts = (char *) base;
+  all_or = 0;
+  all_and = ~(size_t) 0;
+  for (i = 0; i < n; ++i)
+    {
+      keys[i].key = (*key) (elts + i * size, data);
+      keys[i].index = i;
+      all_or |= keys[i].key;
+      all_and &= keys[i].key;
+    }
+
+  /* Sort on each digit in turn, least significant first, using a
+     counting sort.  Digits that are the same in every key do not
+     change the order, so skip them; small keys only cost a pass or
+     two this way.  */
+  for (shift = 0; shift < sizeof (size_t) * CHAR_BIT;
+       shift += sizeof (digit_t) * CHAR_BIT)
+    {
+      unsigned int *countp;
+      unsigned int total;
+      struct sort_key *keyp;
+
+      if ((((all_or ^ all_and) >> shift) & (DIGIT_MAX - 1)) == 0)
+	continue;
+
+      memset (count, 0, DIGIT_MAX * sizeof (unsigned int));
+      for (keyp = keys; keyp < keys + n; ++keyp)
+	++count[(digit_t) (keyp->key >> shift)];
+
+      /* Make COUNT[K] the number of keys whose digit is less than K.  */
+      for (countp = count, total = 0; countp < count + DIGIT_MAX; ++countp)
+	{
+	  unsigned int c = *countp;
+	  *countp = total;
+	  total += c;
+	}
+
+      for (keyp = keys; keyp < keys + n; ++keyp)
+	work[count[(digit_t) (keyp->key >> shift)]++] = *keyp;
+
+      tmp = keys;
+      keys = work;
+      work = tmp;
+    }
+
+  /* Now move the elements into place.  WORK is no longer needed, so
+     reuse it if it is large enough.  */
+  if (size <= sizeof (struct sort_key))
+    sorted = (char *) work;
+  else
+    sorted = XNEWVEC (char, n * size);
+  for (i = 0; i < n; ++i)
+    memcpy (sorted + i * size, elts + keys[i].index * size, size);
+  memcpy (base, sorted, n * size);
+
+  if (sorted != (char *) work)
+    free (sorted);
+  free (keys);
+  free (work);
+}
+
 /* Everything below here is a unit test for the routines in this
    file.  */
 
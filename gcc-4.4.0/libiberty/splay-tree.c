@@ -37,6 +37,12 @@ Boston, MA 02110-1301, USA.  */
 #include "libiberty.h"
 #include "splay-tree.h"
 
+/* Lookups that find their key at most this deep in the tree do not
+   splay it.  Splaying writes to every node on the path even when the
+   key is already near the root; keys found deeper are still splayed,
+   so that paths made long by insertions get shorter again.  */
+#define SPLAY_TREE_LOOKUP_DEPTH 8
+
 static void splay_tree_delete_helper (splay_tree, splay_tree_node);
 static inline void rotate_left (splay_tree_node *,
 				splay_tree_node, splay_tree_node);
@@ -386,6 +392,22 @@ splay_tree_remove (splay_tree sp, splay_tree_key key)
 splay_tree_node
 splay_tree_lookup (splay_tree sp, splay_tree_key key)
 {
+  splay_tree_node n = sp->root;
+  int depth;
+
+  /* Look near the root without changing the tree.  */
+  for (depth = 0; n && depth < SPLAY_TREE_LOOKUP_DEPTH; depth++)
+    {
+      int cmp = (*sp->comp) (key, n->key);
+
+      if (cmp == 0)
+	return n;
+      n = cmp < 0 ? n->left : n->right;
+    }
+
+  if (!n)
+    return 0;
+
   splay_tree_splay (sp, key);
 
   if (sp->root && (*sp->comp)(sp->root->key, key) == 0)
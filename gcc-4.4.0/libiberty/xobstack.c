@@ -0,0 +1,137 @@
+/* Obstack chunk allocation with a cache of freed chunks.
+   Copyright (C) 2009 Free Software Foundation, Inc.
+
+This file is part of the libiberty library.
+Libiberty is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+Libiberty is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Library General Public License for more details.
+
+You should have received a copy of the GNU Library General Public
+License along with libiberty; see the file COPYING.LIB.  If
+not, write to the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,
+Boston, MA 02110-1301, USA.  */
+
+/*
+
+@deftypefn Extension void* xobstack_chunk_alloc (long @var{size})
+
+Allocate a chunk of @var{size} bytes for an obstack without fail.
+This is meant to be used as an obstack's chunk allocation function,
+together with @code{xobstack_chunk_free}.  Chunks of up to 64KB that
+have been freed are kept and handed out again, so that obstacks that
+are repeatedly grown and freed do not call @code{malloc} and
+@code{free} each time.
+
+The cache is not protected by a lock.  Programs that call these
+functions from more than one thread must serialize the calls
+themselves.
+
+@end deftypefn
+
+@deftypefn Extension void xobstack_chunk_free (void *@var{chunk})
+
+Free a @var{chunk} allocated by @code{xobstack_chunk_alloc}, keeping
+it for reuse if it is small enough.
+
+@end deftypefn
+
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "ansidecl.h"
+#include "libiberty.h"
+
+#include <sys/types.h> /* For size_t. */
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+/* Every chunk starts with a header recording its size class, or -1 if
+   it is too big to be cached.  The union keeps the chunk itself as
+   aligned as malloc would.  */
+
+union chunk_header
+{
+  int size_class;
+  double d;
+  void *p;
+  long l;
+};
+
+/* The number of size classes.  */
+#define CHUNK_CLASSES 5
+
+/* The number of free chunks of class K kept, so that each class holds
+   at most 256KB.  */
+#define CHUNK_CACHE_DEPTH(K) (64 >> (K))
+
+/* The usable size of the chunks of class K.  The smallest class holds
+   a default obstack chunk; with the header and malloc's own overhead,
+   each class still fits in a power of two.  */
+#define CHUNK_CLASS_SIZE(K) \
+  ((4096L << (K)) - (long) sizeof (union chunk_header) - 16)
+
+/* The freed chunks of each size class.  */
+static union chunk_header *chunk_cache[CHUNK_CLASSES][CHUNK_CACHE_DEPTH (0)];
+static int chunk_cache_count[CHUNK_CLASSES];
+
+/* Return the smallest size class that holds SIZE bytes, or -1 if none
+   does.  */
+
+static int
+chunk_size_class (long size)
+{
+  int k;
+
+  for (k = 0; k < CHUNK_CLASSES; k++)
+    if (size <= CHUNK_CLASS_SIZE (k))
+      return k;
+  return -1;
+}
+
+PTR
+xobstack_chunk_alloc (long size)
+{
+  union chunk_header *header;
+  int k = chunk_size_class (size);
+
+  if (k >= 0 && chunk_cache_count[k] > 0)
+    header = chunk_cache[k][--chunk_cache_count[k]];
+  else
+    {
+      /* Round up to the class size, so that the chunk can be reused
+	 for any request of this class.  */
+      if (k >= 0)
+	size = CHUNK_CLASS_SIZE (k);
+      header = (union chunk_header *) xmalloc (sizeof (union chunk_header)
+					       + size);
+      header->size_class = k;
+    }
+
+  return (PTR) (header + 1);
+}
+
+void
+xobstack_chunk_free (PTR chunk)
+{
+  union chunk_header *header;
+  int k;
+
+  if (chunk == NULL)
+    return;
+
+  header = (union chunk_header *) chunk - 1;
+  k = header->size_class;
+  if (k >= 0 && chunk_cache_count[k] < CHUNK_CACHE_DEPTH (k))
+    chunk_cache[k][chunk_cache_count[k]++] = header;
+  else
+    free (header);
+}
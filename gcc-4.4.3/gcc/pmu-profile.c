@@ -1,6 +1,6 @@
-/* Performance monitoring unit (PMU) profiler. If available, use an
-   external tool to collect hardware performance counter data and
-   write it in the .gcda files.
+/* Performance monitoring unit (PMU) profiler. If available, use the
+   perf_event interface of the kernel or an external tool to collect
+   hardware performance counter data and write it in the .gcda files.
 
    Copyright (C) 2010. Free Software Foundation, Inc.
    Contributed by Sharad Singhai <singhai@google.com>.
@@ -62,6 +62,23 @@ see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#if defined (__linux__)
+#include <sys/syscall.h>
+#endif
+
+/* Linux kernels since 2.6.32 provide the perf_event interface, which
+   allows sampling the hardware performance counters from within the
+   profiled process itself.  */
+#if defined (__linux__) && defined (__NR_perf_event_open)
+#define PMU_HAVE_PERF_EVENT 1
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/utsname.h>
+#include <linux/perf_event.h>
+#endif
+
 #define XNEWVEC(type,ne) (type *)calloc((ne),sizeof(type))
 #define XNEW(type) (type *)malloc(sizeof(type))
 #define XDELETEVEC(p) free(p)
@@ -137,6 +154,7 @@ const char *addr2line_args[PMU_TOOL_MAX_ARGS] = {
 enum pmu_tool_type
 {
   PTT_PFMON,
+  PTT_PERF_EVENT,
   PTT_LAST
 };
 
@@ -247,6 +265,13 @@ static void reset_symbolizer_child_pipes (void);
 static int parse_pmu_profile_options (const char *options);
 static gcov_pmu_tool_header_t *parse_pfmon_tool_header (FILE *fp,
                                                         const char *end_header);
+#ifdef PMU_HAVE_PERF_EVENT
+static void start_perf_event_module (pid_t pid, char *tmpfile,
+                                     const char **args);
+static void stop_perf_event_module (void);
+static int collect_perf_load_latency (char *filename, void *pmu_data);
+static int collect_perf_branch_mispredicts (char *filename, void *pmu_data);
+#endif
 
 
 /* How to access the necessary functions for the PMU tools.  */
@@ -304,7 +329,63 @@ pmu_tool_fns all_pmu_tool_fns[PTT_LAST][PET_LAST] = {
       end_addr2line_symbolizer,         /* end symbolizer */
       symbolize_addr2line,              /* symbolize */
     }
+  },
+#ifdef PMU_HAVE_PERF_EVENT
+  {
+    {
+      "perf-intel-load-latency",        /* name */
+      0,                                /* tool args */
+      init_pmu_load_latency,            /* initialization */
+      start_perf_event_module,          /* start */
+      stop_perf_event_module,           /* stop */
+      collect_perf_load_latency,        /* parse */
+      gcov_write_load_latency_infos,    /* write */
+      destroy_load_latency_infos,       /* cleanup */
+      start_addr2line_symbolizer,       /* start symbolizer */
+      end_addr2line_symbolizer,         /* end symbolizer */
+      symbolize_addr2line,              /* symbolize */
+    },
+    {
+      "perf-amd-load-latency",          /* name */
+      0,                                /* tool args */
+      init_pmu_load_latency,            /* initialization */
+      start_perf_event_module,          /* start */
+      stop_perf_event_module,           /* stop */
+      collect_perf_load_latency,        /* parse */
+      gcov_write_load_latency_infos,    /* write */
+      destroy_load_latency_infos,       /* cleanup */
+      start_addr2line_symbolizer,       /* start symbolizer */
+      end_addr2line_symbolizer,         /* end symbolizer */
+      symbolize_addr2line,              /* symbolize */
+    },
+    {
+      "perf-intel-branch-mispredict",   /* name */
+      0,                                /* tool args */
+      init_pmu_branch_mispredict,       /* initialization */
+      start_perf_event_module,          /* start */
+      stop_perf_event_module,           /* stop */
+      collect_perf_branch_mispredicts,  /* parse */
+      gcov_write_branch_mispredict_infos,/* write */
+      destroy_branch_mispredict_infos,  /* cleanup */
+      start_addr2line_symbolizer,       /* start symbolizer */
+      end_addr2line_symbolizer,         /* end symbolizer */
+      symbolize_addr2line,              /* symbolize */
+    },
+    {
+      "perf-amd-branch-mispredict",     /* name */
+      0,                                /* tool args */
+      init_pmu_branch_mispredict,       /* initialization */
+      start_perf_event_module,          /* start */
+      stop_perf_event_module,           /* stop */
+      collect_perf_branch_mispredicts,  /* parse */
+      gcov_write_branch_mispredict_infos,/* write */
+      destroy_branch_mispredict_infos,  /* cleanup */
+      start_addr2line_symbolizer,       /* start symbolizer */
+      end_addr2line_symbolizer,         /* end symbolizer */
+      symbolize_addr2line,              /* symbolize */
+    }
   }
+#endif
 };
 
 /* Determine the CPU vendor.  Currently only distinguishes x86 based
@@ -340,8 +421,10 @@ parse_pmu_profile_options (const char *options)
   enum pmu_event_type pet = PET_LAST;
   const char *pmutool_path;
   the_pmu_tool_info->cpu_vendor =  get_x86cpu_vendor ();
-  /* Determine the platform we are running on.  */
-  if (the_pmu_tool_info->cpu_vendor == CPU_VENDOR_UKNOWN)
+  /* Determine the platform we are running on.  The perf_event backend
+     falls back to the generic kernel events on unknown cpus.  */
+  if (the_pmu_tool_info->cpu_vendor == CPU_VENDOR_UKNOWN
+      && ptt != PTT_PERF_EVENT)
     {
       /* Cpuid failed or uknown vendor.  */
       the_pmu_tool_info->pmu_profiling_state = PMU_ERROR;
@@ -384,7 +467,8 @@ parse_pmu_profile_options (const char *options)
 
   /* Allow users to override the default tool path.  */
   pmutool_path = getenv ("GCOV_PMUTOOL_PATH");
-  if (pmutool_path && strlen (pmutool_path))
+  if (pmutool_path && strlen (pmutool_path)
+      && the_pmu_tool_info->tool_details->arg_array)
     the_pmu_tool_info->tool_details->arg_array[0] = pmutool_path;
 
   return 0;
@@ -1136,6 +1220,708 @@ parse_pfmon_branch_mispredicts (char *filename, void *pmu_data)
   return 0;
 }
 
+#ifdef PMU_HAVE_PERF_EVENT
+
+/* Older kernel headers do not know about sample weights, which carry
+   the load latency of PEBS load latency samples.  */
+#ifndef PERF_SAMPLE_WEIGHT
+#define PERF_SAMPLE_WEIGHT (1U << 14)
+#endif
+
+/* MEM_TRANS_RETIRED.LOAD_LATENCY, the PEBS load latency event on Intel
+   cpus since Sandy Bridge.  The latency threshold goes into config1.  */
+#define PERF_INTEL_LOAD_LATENCY_EVENT 0x1cd
+
+/* Number of latency ranges tracked per sampled address.  These are
+   the ranges of the gcov_pmu_ll_info_t fields lt_10 ... gt_1024.  */
+#define PERF_N_LATENCY_RANGES 6
+
+/* Largest record we ever look at.  Samples carry at most an ip and a
+   weight; anything else is only skipped over.  */
+#define PERF_MAX_RECORD_SIZE 64
+
+static const char perf_column_description[] =
+    "# description of columns:\n"
+    "#\tcounts: number of samples at the code address\n"
+    "#\t%self: percentage of all samples at the code address\n"
+    "#\t%cum: cumulative percentage of samples\n"
+    "#\t<N, >=N: percentage of the samples with a latency in this range\n"
+    "#\t%wself: percentage of the total latency at the code address\n"
+    "#\tother columns are self-explanatory\n";
+
+/* Samples aggregated per sampled code address.  */
+struct perf_sample_bucket
+{
+  gcov_type code_addr;         /* sampled address, 0 if the slot is free */
+  gcov_unsigned_t counts;      /* number of samples at CODE_ADDR */
+  gcov_unsigned_t latency[PERF_N_LATENCY_RANGES];  /* samples per range */
+  gcov_type weight;            /* sum of the sample latencies */
+};
+
+/* State of the in-process perf_event sampling backend.  Samples are
+   drained from the kernel ring buffer into a fixed size open addressed
+   table, so that draining is possible from the SIGIO handler.  */
+struct perf_event_info
+{
+  int fd;                       /* perf event descriptor */
+  pid_t owner;                  /* process which opened FD */
+  struct perf_event_attr attr;  /* the sampled event */
+  struct perf_event_mmap_page *meta;  /* ring buffer control page */
+  unsigned char *data;          /* ring buffer data pages */
+  size_t data_size;             /* size of DATA, a power of two */
+  size_t mmap_size;             /* size of the whole mapping */
+  struct perf_sample_bucket *buckets;  /* table of sampled addresses */
+  unsigned n_buckets;           /* size of BUCKETS, a power of two */
+  unsigned n_used;              /* number of used BUCKETS */
+  gcov_type total_samples;      /* all samples seen */
+  gcov_type total_weight;       /* sum of the latencies of all samples */
+  gcov_type lost_samples;       /* samples lost by the kernel or the table */
+  int async_drain;              /* non-zero if SIGIO drains the buffer */
+  volatile int drain_lock;      /* serializes draining against SIGIO */
+};
+
+static struct perf_event_info the_perf_event_info;
+
+/* Return the value of environment variable NAME as an unsigned
+   number, or DEFAULT_VALUE if it is not set or invalid.  */
+
+static unsigned long long
+pmu_getenv_ull (const char *name, unsigned long long default_value)
+{
+  const char *value = getenv (name);
+  unsigned long long result;
+  char *end;
+
+  if (!value || !*value)
+    return default_value;
+  result = strtoull (value, &end, 0);
+  if (*end)
+    {
+      fprintf (stderr, "Ignoring invalid %s value: %s\n", name, value);
+      return default_value;
+    }
+  return result;
+}
+
+/* Round N up to a power of two.  */
+
+static unsigned long
+pmu_round_pow2 (unsigned long n)
+{
+  unsigned long pow2 = 1;
+
+  while (pow2 < n)
+    pow2 <<= 1;
+  return pow2;
+}
+
+/* Set up ATTR for sampling the current event.  The defaults match the
+   events and sampling periods of the pfmon command lines above.  They
+   can be changed with GCOV_PMU_EVENT=TYPE:CONFIG[:CONFIG1] and
+   GCOV_PMU_SAMPLE_PERIOD; the Intel load latency threshold can be
+   changed with GCOV_PMU_LATENCY_THRESHOLD.  */
+
+static void
+setup_perf_event_attr (struct perf_event_attr *attr)
+{
+  const char *event;
+
+  memset (attr, 0, sizeof (*attr));
+  attr->size = sizeof (*attr);
+  attr->sample_type = PERF_SAMPLE_IP;
+  attr->disabled = 1;
+  attr->inherit = 1;
+  attr->exclude_kernel = 1;
+  attr->exclude_hv = 1;
+
+  switch (the_pmu_tool_info->event)
+    {
+    case PET_INTEL_LOAD_LATENCY:
+      attr->type = PERF_TYPE_RAW;
+      attr->config = PERF_INTEL_LOAD_LATENCY_EVENT;
+      attr->config1 = pmu_getenv_ull ("GCOV_PMU_LATENCY_THRESHOLD", 4);
+      attr->sample_type |= PERF_SAMPLE_WEIGHT;
+      attr->sample_period = 4000;
+      break;
+
+    case PET_AMD_LOAD_LATENCY:
+      /* There is no generic load latency event; sample L1 data cache
+         read misses instead.  These samples carry no latency.  */
+      attr->type = PERF_TYPE_HW_CACHE;
+      attr->config = (PERF_COUNT_HW_CACHE_L1D
+                      | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+      attr->sample_period = 4000;
+      break;
+
+    case PET_INTEL_BRANCH_MISPREDICT:
+    case PET_AMD_BRANCH_MISPREDICT:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+      attr->sample_period = 10000;
+      break;
+
+    default:
+      break;
+    }
+
+  event = getenv ("GCOV_PMU_EVENT");
+  if (event && *event)
+    {
+      char *end;
+      unsigned long type = strtoul (event, &end, 0);
+      unsigned long long config = 0, config1 = attr->config1;
+
+      if (*end == ':')
+        config = strtoull (end + 1, &end, 0);
+      if (*end == ':')
+        config1 = strtoull (end + 1, &end, 0);
+      if (*end || end == event)
+        fprintf (stderr, "Ignoring invalid GCOV_PMU_EVENT value: %s\n",
+                 event);
+      else
+        {
+          attr->type = type;
+          attr->config = config;
+          attr->config1 = config1;
+        }
+    }
+
+  attr->sample_period = pmu_getenv_ull ("GCOV_PMU_SAMPLE_PERIOD",
+                                        attr->sample_period);
+  if (!attr->sample_period)
+    attr->sample_period = 1;
+}
+
+/* Copy SIZE bytes at ring buffer position OFFSET of INFO into DEST,
+   taking care of records that wrap around the end of the buffer.  */
+
+static void
+perf_event_copy (const struct perf_event_info *info,
+                 unsigned long long offset, void *dest, size_t size)
+{
+  size_t start = offset & (info->data_size - 1);
+  size_t chunk = info->data_size - start;
+
+  if (chunk > size)
+    chunk = size;
+  memcpy (dest, info->data + start, chunk);
+  memcpy ((char *) dest + chunk, info->data, size - chunk);
+}
+
+/* Return the index of the latency range WEIGHT falls into.  */
+
+static unsigned
+perf_latency_range (gcov_type weight)
+{
+  if (weight < 10)
+    return 0;
+  if (weight < 32)
+    return 1;
+  if (weight < 64)
+    return 2;
+  if (weight < 256)
+    return 3;
+  if (weight < 1024)
+    return 4;
+  return 5;
+}
+
+/* Account a sample at ADDR with latency WEIGHT in INFO.  This may run
+   in a signal handler, so it must not allocate memory.  */
+
+static void
+record_perf_sample (struct perf_event_info *info, gcov_type addr,
+                    gcov_type weight)
+{
+  unsigned mask = info->n_buckets - 1;
+  unsigned i = (unsigned) (((unsigned long long) addr
+                            * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+  struct perf_sample_bucket *bucket;
+
+  info->total_samples++;
+  info->total_weight += weight;
+  for (;;)
+    {
+      bucket = &info->buckets[i];
+      if (bucket->code_addr == addr)
+        break;
+      if (!bucket->code_addr)
+        {
+          /* Keep the table at most 3/4 full.  */
+          if (info->n_used >= info->n_buckets - info->n_buckets / 4)
+            {
+              info->lost_samples++;
+              return;
+            }
+          bucket->code_addr = addr;
+          info->n_used++;
+          break;
+        }
+      i = (i + 1) & mask;
+    }
+
+  bucket->counts++;
+  bucket->weight += weight;
+  if (info->attr.sample_type & PERF_SAMPLE_WEIGHT)
+    bucket->latency[perf_latency_range (weight)]++;
+}
+
+/* Move all records from the ring buffer of INFO into its sample
+   table.  */
+
+static void
+drain_perf_event_buffer (struct perf_event_info *info)
+{
+  struct perf_event_mmap_page *meta = info->meta;
+  unsigned long long head, tail;
+
+  head = meta->data_head;
+  /* Pairs with the barrier in the kernel's ring buffer update.  */
+  __sync_synchronize ();
+  tail = meta->data_tail;
+
+  while (tail + sizeof (struct perf_event_header) <= head)
+    {
+      struct perf_event_header header;
+      unsigned long long record[PERF_MAX_RECORD_SIZE / 8];
+      size_t size;
+
+      perf_event_copy (info, tail, &header, sizeof (header));
+      if (header.size < sizeof (header) || tail + header.size > head)
+        break;
+      size = header.size - sizeof (header);
+      if (size > sizeof (record))
+        size = sizeof (record);
+      perf_event_copy (info, tail + sizeof (header), record, size);
+
+      switch (header.type)
+        {
+        case PERF_RECORD_SAMPLE:
+          /* The ip, followed by the weight if requested.  */
+          if (size >= 8)
+            record_perf_sample (info, (gcov_type) record[0],
+                                ((info->attr.sample_type & PERF_SAMPLE_WEIGHT)
+                                 && size >= 16) ? (gcov_type) record[1] : 0);
+          break;
+
+        case PERF_RECORD_LOST:
+          /* The event id, followed by the number of lost samples.  */
+          if (size >= 16)
+            info->lost_samples += record[1];
+          break;
+
+        default:
+          break;
+        }
+      tail += header.size;
+    }
+
+  __sync_synchronize ();
+  meta->data_tail = tail;
+}
+
+/* SIGIO handler draining the ring buffer once it is half full.  */
+
+static void
+perf_event_sigio_handler (int signo)
+{
+  struct perf_event_info *info = &the_perf_event_info;
+  int saved_errno = errno;
+
+  (void) signo;
+  /* If the buffer is being drained already, there is nothing to do.  */
+  if (!__sync_lock_test_and_set (&info->drain_lock, 1))
+    {
+      if (info->meta)
+        drain_perf_event_buffer (info);
+      __sync_lock_release (&info->drain_lock);
+    }
+  errno = saved_errno;
+}
+
+/* Arrange for SIGIO to be delivered whenever the ring buffer of INFO
+   fills up, so that no samples are lost in long running processes.
+   If the application handles SIGIO itself, the buffer is only drained
+   at exit.  */
+
+static void
+setup_perf_event_sigio (struct perf_event_info *info)
+{
+  struct sigaction old_sa, sa;
+
+  if (sigaction (SIGIO, NULL, &old_sa) != 0
+      || (old_sa.sa_flags & SA_SIGINFO)
+      || old_sa.sa_handler != SIG_DFL)
+    return;
+
+  memset (&sa, 0, sizeof (sa));
+  sa.sa_handler = perf_event_sigio_handler;
+  sigemptyset (&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  if (sigaction (SIGIO, &sa, NULL) != 0)
+    return;
+
+  if (fcntl (info->fd, F_SETOWN, info->owner) == -1
+      || fcntl (info->fd, F_SETFL, O_ASYNC | O_NONBLOCK) == -1)
+    {
+      sigaction (SIGIO, &old_sa, NULL);
+      return;
+    }
+  info->async_drain = 1;
+}
+
+/* Start sampling the current event in process PID.  Unlike pfmon this
+   does not need a separate process: samples are written by the kernel
+   into a ring buffer mapped into this process.  Inherited counters of
+   threads and children created later write into the same buffer.  On
+   failure the ring buffer of the_perf_event_info stays unmapped.  */
+
+static void
+start_perf_event_module (pid_t pid, char *tmpfile, const char **args)
+{
+  struct perf_event_info *info = &the_perf_event_info;
+  size_t page_size = getpagesize ();
+  unsigned long pages;
+  void *base;
+  int precise;
+  int fd = -1;
+
+  (void) tmpfile;
+  (void) args;
+  info->fd = -1;
+  info->owner = pid;
+  setup_perf_event_attr (&info->attr);
+
+  pages = pmu_round_pow2 (pmu_getenv_ull ("GCOV_PMU_MMAP_PAGES", 128));
+  info->data_size = pages * page_size;
+  info->mmap_size = info->data_size + page_size;
+  info->attr.watermark = 1;
+  info->attr.wakeup_watermark = info->data_size / 2;
+
+  info->n_buckets = pmu_round_pow2 (pmu_getenv_ull ("GCOV_PMU_MAX_ADDRESSES",
+                                                    65536));
+  info->buckets = XNEWVEC (struct perf_sample_bucket, info->n_buckets);
+  if (!info->buckets)
+    {
+      fprintf (stderr, "Cannot allocate PMU sample table.\n");
+      info->n_buckets = 0;
+      return;
+    }
+
+  /* Ask for the most precise ip the cpu supports.  */
+  for (precise = 2; precise >= 0; precise--)
+    {
+      info->attr.precise_ip = precise;
+      fd = syscall (__NR_perf_event_open, &info->attr, pid, -1, -1, 0);
+      if (fd != -1 || (errno != EINVAL && errno != EOPNOTSUPP))
+        break;
+    }
+  if (fd == -1)
+    {
+      fprintf (stderr, "Cannot open perf event %s: %s\n",
+               the_pmu_tool_info->tool_details->name, strerror (errno));
+      goto fail;
+    }
+
+  base = mmap (NULL, info->mmap_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+               fd, 0);
+  if (base == MAP_FAILED)
+    {
+      fprintf (stderr, "Cannot map perf event buffer: %s\n",
+               strerror (errno));
+      close (fd);
+      goto fail;
+    }
+  info->meta = (struct perf_event_mmap_page *) base;
+  info->data = (unsigned char *) base + page_size;
+  info->fd = fd;
+
+  setup_perf_event_sigio (info);
+  ioctl (fd, PERF_EVENT_IOC_ENABLE, 0);
+
+  if (tool_debug)
+    fprintf (stderr, "perf event %s: type %u config 0x%llx period %llu "
+             "precise %d\n", the_pmu_tool_info->tool_details->name,
+             info->attr.type, (unsigned long long) info->attr.config,
+             (unsigned long long) info->attr.sample_period, precise);
+  return;
+
+ fail:
+  XDELETEVEC (info->buckets);
+  info->buckets = 0;
+  info->n_buckets = 0;
+}
+
+/* Stop sampling and move the remaining samples into the sample
+   table.  */
+
+static void
+stop_perf_event_module (void)
+{
+  struct perf_event_info *info = &the_perf_event_info;
+  int owner_p;
+
+  if (!info->meta)
+    return;
+
+  /* Forked children share the event, its file description and the
+     buffer with the process that opened it.  Only that process stops
+     the event and collects the samples; a child that exits must not
+     turn off sampling or SIGIO for its parent.  */
+  owner_p = info->owner == getpid ();
+  if (owner_p)
+    {
+      ioctl (info->fd, PERF_EVENT_IOC_DISABLE, 0);
+      /* Our SIGIO handler stays installed; a signal that is already
+         pending finds the event closed and does nothing.  */
+      if (info->async_drain)
+        fcntl (info->fd, F_SETFL, 0);
+    }
+
+  while (__sync_lock_test_and_set (&info->drain_lock, 1))
+    continue;
+  if (owner_p)
+    drain_perf_event_buffer (info);
+  munmap (info->meta, info->mmap_size);
+  close (info->fd);
+  info->fd = -1;
+  info->meta = 0;
+  info->data = 0;
+  __sync_lock_release (&info->drain_lock);
+
+  if (tool_debug)
+    fprintf (stderr, "perf event: %lld samples, %lld lost, %u addresses\n",
+             (long long) info->total_samples, (long long) info->lost_samples,
+             info->n_used);
+}
+
+/* Compare two sample buckets by decreasing sample count.  */
+
+static int
+compare_perf_buckets (const void *p1, const void *p2)
+{
+  const struct perf_sample_bucket *b1 =
+    *(const struct perf_sample_bucket *const *) p1;
+  const struct perf_sample_bucket *b2 =
+    *(const struct perf_sample_bucket *const *) p2;
+
+  if (b1->counts != b2->counts)
+    return b1->counts < b2->counts ? 1 : -1;
+  if (b1->code_addr != b2->code_addr)
+    return b1->code_addr < b2->code_addr ? -1 : 1;
+  return 0;
+}
+
+/* Return a newly allocated array of the used sample buckets, sorted by
+   decreasing sample count and limited to the top_n_address hottest
+   ones.  The length is stored in *N_BUCKETS.  Returns NULL if there is
+   nothing to report.  */
+
+static struct perf_sample_bucket **
+sorted_perf_buckets (unsigned *n_buckets)
+{
+  struct perf_event_info *info = &the_perf_event_info;
+  struct perf_sample_bucket **sorted;
+  unsigned i, n = 0;
+
+  *n_buckets = 0;
+  if (!info->buckets || info->owner != getpid ())
+    return NULL;
+
+  sorted = XNEWVEC (struct perf_sample_bucket *, info->n_used + 1);
+  for (i = 0; i < info->n_buckets; ++i)
+    if (info->buckets[i].code_addr)
+      sorted[n++] = &info->buckets[i];
+  qsort (sorted, n, sizeof (*sorted), compare_perf_buckets);
+
+  if (the_pmu_tool_info->top_n_address
+      && n > the_pmu_tool_info->top_n_address)
+    n = the_pmu_tool_info->top_n_address;
+  *n_buckets = n;
+  return sorted;
+}
+
+/* Convert COUNT out of TOTAL into a per 10k value.  */
+
+static gcov_unsigned_t
+perf_per_10k (gcov_type count, gcov_type total)
+{
+  if (!total)
+    return 0;
+  return (gcov_unsigned_t) ((count * 10000) / total);
+}
+
+/* Run ADDR through the symbolizer and store the resulting source
+   location into *FILENAME and *LINE.  */
+
+static void
+symbolize_perf_sample (gcov_type addr, char **filename, gcov_unsigned_t *line)
+{
+  pmu_tool_fns *tool_details = the_pmu_tool_info->tool_details;
+  char *sym_info, *sep;
+
+  *filename = NULL;
+  *line = 0;
+  if (!tool_details->symbolize)
+    return;
+
+  sym_info = tool_details->symbolize ((void *) (long) addr);
+  /* sym_info is of the form src_filename:linenum.  */
+  sep = strchr (sym_info, ':');
+  if (sep)
+    {
+      *sep = 0;
+      *line = atol (sep + 1);
+    }
+  *filename = sym_info;
+}
+
+/* Create the tool header describing the sampled event, with
+   COLUMN_HEADER as the header of the data columns.  */
+
+static gcov_pmu_tool_header_t *
+create_perf_tool_header (const char *column_header)
+{
+  struct perf_event_info *info = &the_perf_event_info;
+  gcov_pmu_tool_header_t *tool_header = XNEWVEC (gcov_pmu_tool_header_t, 1);
+  struct utsname uts;
+  char buf[256];
+
+  if (uname (&uts) == 0)
+    {
+      snprintf (buf, sizeof (buf), "%ld-way %s",
+                sysconf (_SC_NPROCESSORS_ONLN), uts.machine);
+      tool_header->host_cpu = strdup (buf);
+      tool_header->hostname = strdup (uts.nodename);
+      tool_header->kernel_version = strdup (uts.release);
+    }
+  else
+    {
+      tool_header->host_cpu = strdup ("unknown");
+      tool_header->hostname = strdup ("unknown");
+      tool_header->kernel_version = strdup ("unknown");
+    }
+  tool_header->column_header = strdup (column_header);
+  tool_header->column_description = strdup (perf_column_description);
+  snprintf (buf, sizeof (buf),
+            "# perf_event %s: type %u config 0x%llx config1 0x%llx "
+            "period %llu\n# samples: %lld lost: %lld\n",
+            the_pmu_tool_info->tool_details->name, info->attr.type,
+            (unsigned long long) info->attr.config,
+            (unsigned long long) info->attr.config1,
+            (unsigned long long) info->attr.sample_period,
+            (long long) info->total_samples, (long long) info->lost_samples);
+  tool_header->full_header = strdup (buf);
+  return tool_header;
+}
+
+/* Release the sample table of the perf_event backend.  */
+
+static void
+destroy_perf_buckets (void)
+{
+  XDELETEVEC (the_perf_event_info.buckets);
+  the_perf_event_info.buckets = 0;
+  the_perf_event_info.n_used = 0;
+}
+
+/* Convert the load latency samples into PMU_DATA, in the same form as
+   parse_pfmon_load_latency produces them.  Returns 0 on success.  */
+
+static int
+collect_perf_load_latency (char *filename, void *pmu_data)
+{
+  struct perf_event_info *info = &the_perf_event_info;
+  ll_infos_t *load_latency_infos = (ll_infos_t *)pmu_data;
+  struct perf_sample_bucket **sorted;
+  gcov_type cum = 0;
+  unsigned i, n;
+
+  (void) filename;
+  sorted = sorted_perf_buckets (&n);
+  if (!sorted)
+    return 1;
+
+  XDELETEVEC (load_latency_infos->ll_array);
+  load_latency_infos->ll_array = XNEWVEC (gcov_pmu_ll_info_t *, n + 1);
+  load_latency_infos->alloc_ll_count = n + 1;
+  load_latency_infos->ll_count = 0;
+  for (i = 0; i < n; ++i)
+    {
+      const struct perf_sample_bucket *bucket = sorted[i];
+      gcov_pmu_ll_info_t *ll_info = XNEW (gcov_pmu_ll_info_t);
+
+      cum += bucket->counts;
+      ll_info->counts = bucket->counts;
+      ll_info->self = perf_per_10k (bucket->counts, info->total_samples);
+      ll_info->cum = perf_per_10k (cum, info->total_samples);
+      ll_info->lt_10 = perf_per_10k (bucket->latency[0], bucket->counts);
+      ll_info->lt_32 = perf_per_10k (bucket->latency[1], bucket->counts);
+      ll_info->lt_64 = perf_per_10k (bucket->latency[2], bucket->counts);
+      ll_info->lt_256 = perf_per_10k (bucket->latency[3], bucket->counts);
+      ll_info->lt_1024 = perf_per_10k (bucket->latency[4], bucket->counts);
+      ll_info->gt_1024 = perf_per_10k (bucket->latency[5], bucket->counts);
+      ll_info->wself = perf_per_10k (bucket->weight, info->total_weight);
+      ll_info->code_addr = bucket->code_addr;
+      ll_info->discriminator = 0;
+      symbolize_perf_sample (bucket->code_addr, &ll_info->filename,
+                             &ll_info->line);
+      load_latency_infos->ll_array[load_latency_infos->ll_count++] = ll_info;
+    }
+  load_latency_infos->pmu_tool_header =
+    create_perf_tool_header (pfmon_ll_header);
+
+  XDELETEVEC (sorted);
+  destroy_perf_buckets ();
+  return 0;
+}
+
+/* Convert the branch mispredict samples into PMU_DATA, in the same
+   form as parse_pfmon_branch_mispredicts produces them.  Returns 0 on
+   success.  */
+
+static int
+collect_perf_branch_mispredicts (char *filename, void *pmu_data)
+{
+  struct perf_event_info *info = &the_perf_event_info;
+  brm_infos_t *brm_infos = (brm_infos_t *)pmu_data;
+  struct perf_sample_bucket **sorted;
+  gcov_type cum = 0;
+  unsigned i, n;
+
+  (void) filename;
+  sorted = sorted_perf_buckets (&n);
+  if (!sorted)
+    return 1;
+
+  XDELETEVEC (brm_infos->brm_array);
+  brm_infos->brm_array = XNEWVEC (gcov_pmu_brm_info_t *, n + 1);
+  brm_infos->alloc_brm_count = n + 1;
+  brm_infos->brm_count = 0;
+  for (i = 0; i < n; ++i)
+    {
+      const struct perf_sample_bucket *bucket = sorted[i];
+      gcov_pmu_brm_info_t *brm = XNEW (gcov_pmu_brm_info_t);
+
+      cum += bucket->counts;
+      brm->counts = bucket->counts;
+      brm->self = perf_per_10k (bucket->counts, info->total_samples);
+      brm->cum = perf_per_10k (cum, info->total_samples);
+      brm->code_addr = bucket->code_addr;
+      brm->discriminator = 0;
+      symbolize_perf_sample (bucket->code_addr, &brm->filename, &brm->line);
+      brm_infos->brm_array[brm_infos->brm_count++] = brm;
+    }
+  brm_infos->pmu_tool_header = create_perf_tool_header (pfmon_bm_header);
+
+  XDELETEVEC (sorted);
+  destroy_perf_buckets ();
+  return 0;
+}
+
+#endif /* PMU_HAVE_PERF_EVENT */
+
 /* Start the monitoring process using pmu tool. Return 0 on success,
    non-zero otherwise.  */
 
@@ -1148,6 +1934,16 @@ pmu_start (void)
   if (!the_pmu_tool_info->tool_details->start_pmu_module)
     return 1;
 
+#ifdef PMU_HAVE_PERF_EVENT
+  /* The perf_event backend samples from within this process.  */
+  if (the_pmu_tool_info->tool == PTT_PERF_EVENT)
+    {
+      the_pmu_tool_info->tool_details->start_pmu_module (getpid (), NULL,
+                                                         NULL);
+      return the_perf_event_info.meta == NULL;
+    }
+#endif
+
   pid = fork ();
   if (pid == -1)
     {
@@ -1210,6 +2006,22 @@ init_pmu_branch_mispredict (void)
   return (void *)brm_info;
 }
 
+/* Select the PMU tool to use.  The in-process perf_event backend is
+   preferred where the kernel provides it; GCOV_PMU_TOOL=pfmon selects
+   the external pfmon tool instead.  */
+
+static enum pmu_tool_type
+select_pmu_tool (void)
+{
+#ifdef PMU_HAVE_PERF_EVENT
+  const char *tool = getenv ("GCOV_PMU_TOOL");
+
+  if (!tool || strcmp (tool, "pfmon"))
+    return PTT_PERF_EVENT;
+#endif
+  return PTT_PFMON;
+}
+
 /* Initialize pmu tool based upon PMU_INFO. Sets the appropriate tool
    type in the global the_pmu_tool_info.  */
 
@@ -1218,7 +2030,7 @@ init_pmu_tool (struct gcov_pmu_info *pmu_info)
 {
   the_pmu_tool_info->pmu_profiling_state = PMU_NONE;
   the_pmu_tool_info->verbose = 0;
-  the_pmu_tool_info->tool = PTT_PFMON;  /* we support only pfmon */
+  the_pmu_tool_info->tool = select_pmu_tool ();
   the_pmu_tool_info->pmu_tool_pid = 0;
   the_pmu_tool_info->top_n_address = pmu_info->pmu_top_n_address;
   the_pmu_tool_info->symbolizer_pid = 0;
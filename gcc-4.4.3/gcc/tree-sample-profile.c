@@ -57,6 +57,14 @@ along with GCC; see the file COPYING3.  If not see
 #include "l-ipo.h"
 #include "value-prof.h"
 
+#ifdef HAVE_MMAP_FILE
+# include <sys/mman.h>
+#endif
+
+#ifndef MAP_FAILED
+# define MAP_FAILED ((void *)-1)
+#endif
+
 #define DEFAULT_SAMPLE_DATAFILE "sp.data"
 #define MAX_LINENUM_CHARS         10
 #define FB_INLINE_MAX_STACK       200
@@ -99,6 +107,8 @@ static struct profile prog_unit;
 
 static struct gcov_ctr_summary *sp_profile_info;
 
+static void sp_load_function (const char *);
+
 /* Print hash table statistics for HTAB.  */
 static void
 print_hash_table_statistics (htab_t htab)
@@ -224,10 +234,17 @@ sp_info_hash (const void *fb_info)
   const struct sample_freq_detail *sp =
       (const struct sample_freq_detail *) fb_info;
 
+  hashval_t h;
+
   gcc_assert (sp->line_num >= 0);
 
-  return create_hash_string (realname (sp->filename), sp->line_num,
-                             sp->discriminator);
+  h = create_hash_string (realname (sp->filename), sp->line_num,
+                          sp->discriminator);
+  /* Only the functions looked up are read from an indexed file, so the
+     samples of a line must not depend on which others were read.  */
+  if (prog_unit.index)
+    h = iterative_hash (sp->func_name, strlen (sp->func_name), h);
+  return h;
 }
 
 
@@ -244,7 +261,8 @@ sp_info_eq (const void *p, const void *q)
 
   return (a->line_num == b->line_num)
     && (a->discriminator == b->discriminator)
-    && (!strcmp (realname (a->filename), realname (b->filename)));
+    && (!strcmp (realname (a->filename), realname (b->filename)))
+    && (!prog_unit.index || !strcmp (a->func_name, b->func_name));
 }
 
 /* Compute hash value for INLINE_INFO.  */
@@ -488,63 +506,126 @@ sp_get_indirect_calls (const char *func_name)
   struct sample_indirect_call ic;
   ic.func_name = func_name;
 
+  sp_load_function (func_name);
   return (struct sample_indirect_call *)
          htab_find (sp_indirect_htab, (void *) &ic);
 }
 
-/* Read file header from input file INFILE into PROG_UNIT. Return 0 if
-   successful, -1 otherwise.  */
+/* Read SIZE bytes at OFFSET of the sample file of PROG_UNIT into BUF,
+   from the mapped file if there is one.  Return 0 if successful, -1
+   otherwise.  */
 static int
-read_file_header (FILE *infile, struct profile *prog_unit)
+sp_read_at (struct profile *prog_unit, unsigned long long offset,
+            void *buf, size_t size)
 {
-  if (fread (&(prog_unit->fb_hdr), 1, sizeof (struct fb_sample_hdr), infile)
-      != sizeof (struct fb_sample_hdr))
+  if (prog_unit->map)
+    {
+      if (offset > prog_unit->map_size
+          || size > prog_unit->map_size - offset)
+        return -1;
+      memcpy (buf, prog_unit->map + offset, size);
+      return 0;
+    }
+
+  if (fseek (prog_unit->file, offset, SEEK_SET) != 0)
+    return -1;
+  if (fread (buf, 1, size, prog_unit->file) != size)
     return -1;
   return 0;
 }
 
-/* Read string table from INFILE into PROG_UNIT. Return 0 if successful, -1
-   otherwise.  */
+/* Read file header from the sample file into PROG_UNIT. Return 0 if
+   successful, -1 otherwise.  */
 static int
-read_string_table (FILE *infile, struct profile *prog_unit)
+read_file_header (struct profile *prog_unit)
 {
-  unsigned long long str_table_size;
+  return sp_read_at (prog_unit, 0, &(prog_unit->fb_hdr),
+                     sizeof (struct fb_sample_hdr));
+}
 
-  if (fseek (infile, (prog_unit->fb_hdr).fb_str_table_offset, SEEK_SET) != 0)
-    return -1;
+/* Read string table from the sample file into PROG_UNIT. Return 0 if
+   successful, -1 otherwise.  A mapped string table is used in place.  */
+static int
+read_string_table (struct profile *prog_unit)
+{
+  unsigned long long str_table_offset = prog_unit->fb_hdr.fb_str_table_offset;
+  unsigned long long str_table_size = prog_unit->fb_hdr.fb_str_table_size;
 
-  str_table_size = prog_unit->fb_hdr.fb_str_table_size;
+  if (prog_unit->map)
+    {
+      if (str_table_offset > prog_unit->map_size
+          || str_table_size > prog_unit->map_size - str_table_offset)
+        return -1;
+      prog_unit->str_table = prog_unit->map + str_table_offset;
+      return 0;
+    }
 
   prog_unit->str_table = (char *) xmalloc (str_table_size);
   if (!(prog_unit->str_table))
     return -1;
-  if (fread (prog_unit->str_table, 1, str_table_size, infile) !=
-      str_table_size)
-    return -1;
-
-  return 0;
+  return sp_read_at (prog_unit, str_table_offset, prog_unit->str_table,
+                     str_table_size);
 }
 
-/* Read function header with index I from INFILE into FUNC_HDR. PROG_UNIT holds
-   file header and string table. Return 0 if successful, -1 otherwise.  */
+/* Read function header with index I from the sample file into FUNC_HDR.
+   PROG_UNIT holds file header and string table. Return 0 if successful, -1
+   otherwise.  */
 static int
-read_function_header (FILE *infile, unsigned int i,
-		      struct profile *prog_unit,
+read_function_header (unsigned int i, struct profile *prog_unit,
 		      struct func_sample_hdr *func_hdr)
 {
   struct fb_sample_hdr *fb_hdr = &(prog_unit->fb_hdr);
   unsigned int func_hdr_size;
-  unsigned int offset;
+  unsigned long long offset;
 
   gcc_assert (i <= fb_hdr->fb_func_hdr_num);
   func_hdr_size = fb_hdr->fb_func_hdr_ent_size;
-  offset = i * func_hdr_size;
+  offset = (unsigned long long) i * func_hdr_size;
 
-  if (fseek (infile, fb_hdr->fb_func_hdr_offset + offset, SEEK_SET) != 0)
-    return -1;
-  if (fread (func_hdr, 1, func_hdr_size, infile) != func_hdr_size)
-    return -1;
-  return 0;
+  return sp_read_at (prog_unit, fb_hdr->fb_func_hdr_offset + offset,
+                     func_hdr, func_hdr_size);
+}
+
+/* If the sample file of PROG_UNIT has a function index, map the file so
+   that functions can be read when they are first looked up.  */
+static void
+sp_map_index (struct profile *prog_unit)
+{
+#ifdef HAVE_MMAP_FILE
+  struct fb_sample_hdr *fb_hdr = &(prog_unit->fb_hdr);
+  struct fb_func_index_hdr *index_hdr = &(prog_unit->index_hdr);
+  unsigned long long index_size;
+  struct stat st;
+  char *map;
+
+  if (fb_hdr->fb_func_hdr_offset
+      < sizeof (struct fb_sample_hdr) + sizeof (struct fb_func_index_hdr)
+      || sp_read_at (prog_unit, sizeof (struct fb_sample_hdr), index_hdr,
+                     sizeof (struct fb_func_index_hdr)) != 0
+      || strncmp (index_hdr->fb_index_ident, FB_SAMPLE_INDEX_IDENT,
+                  FB_SAMPLE_NIDENT) != 0
+      || index_hdr->fb_index_num != fb_hdr->fb_func_hdr_num
+      || index_hdr->fb_index_offset % sizeof (unsigned int) != 0)
+    return;
+
+  if (fstat (fileno (prog_unit->file), &st) != 0)
+    return;
+  index_size = index_hdr->fb_index_num * sizeof (struct fb_func_index_entry);
+  if (index_hdr->fb_index_offset > (unsigned long long) st.st_size
+      || index_size > st.st_size - index_hdr->fb_index_offset)
+    return;
+
+  map = (char *) mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+                       fileno (prog_unit->file), 0);
+  if (map == (char *) MAP_FAILED)
+    return;
+
+  prog_unit->map = map;
+  prog_unit->map_size = st.st_size;
+  prog_unit->index = (const struct fb_func_index_entry *)
+      (map + index_hdr->fb_index_offset);
+  prog_unit->index_loaded = XCNEWVEC (unsigned char, index_hdr->fb_index_num);
+#endif
 }
 
 static int
@@ -599,6 +680,8 @@ get_total_count (gimple stmt, const char *func_name)
   if (idx == -1)
     return 0;
 
+  sp_load_function (sp_get_real_funcname (func_name));
+
   inline_loc.depth = idx;
   inline_loc.inline_stack = stack;
   inline_loc.func_name = func_name;
@@ -638,6 +721,11 @@ get_total_count_edge (struct cgraph_edge *edge, const char *func_name)
         return 0;
     }
 
+  /* The samples of the inline instances are read with the function they
+     were inlined into.  */
+  sp_load_function (sp_get_real_funcname (IDENTIFIER_POINTER
+                      (DECL_ASSEMBLER_NAME (edge->caller->decl))));
+
   inline_loc.depth = idx;
   inline_loc.inline_stack = stack;
   inline_loc.func_name = func_name;
@@ -654,12 +742,12 @@ get_total_count_edge (struct cgraph_edge *edge, const char *func_name)
   return inline_htab_entry->freq;
 }
 
-/* Read inline sections for the function header FUNC_HDR in file INFILE.
-   PROG_UNIT holds file header information and string table. Input parameter
-   NUM_SAMPLES specifies the number of samples read so far. Return the
-   total number of samples read, including NUM_SAMPLES.  */
+/* Read inline sections for the function header FUNC_HDR from the sample
+   file. PROG_UNIT holds file header information and string table. Input
+   parameter NUM_SAMPLES specifies the number of samples read so far. Return
+   the total number of samples read, including NUM_SAMPLES.  */
 static unsigned long long
-read_inline_function (FILE *infile, struct profile *prog_unit,
+read_inline_function (struct profile *prog_unit,
                       struct func_sample_hdr *func_hdr,
                       unsigned long long num_samples)
 {
@@ -684,14 +772,10 @@ read_inline_function (FILE *infile, struct profile *prog_unit,
       inline_hdr_offset = 
           fb_hdr->fb_func_hdr_offset + func_hdr->func_inline_hdr_offset
           + fb_hdr->fb_func_hdr_num * func_hdr_size + k * func_hdr_size;
-      if (fseek (infile, inline_hdr_offset, SEEK_SET) != 0)
-        {
-          error ("read_inline_function(): fseek inline_func_hdr error.");
-          return curr_num_samples;
-        }
-      if (fread (&inline_func_hdr, 1, func_hdr_size, infile) != func_hdr_size)
+      if (sp_read_at (prog_unit, inline_hdr_offset, &inline_func_hdr,
+                      func_hdr_size) != 0)
         {
-          error ("read_inline_function(): fread inline_func_hdr error.");
+          error ("read_inline_function(): read inline_func_hdr error.");
           return curr_num_samples;
         }
 
@@ -708,19 +792,12 @@ read_inline_function (FILE *infile, struct profile *prog_unit,
           xcalloc (inline_func_hdr.inline_depth,
                    sizeof (struct expanded_inline_location));
 
-      /* Seek to beginning of the inline stack.  */
-      if (fseek (infile, profile_offset, SEEK_SET) != 0)
-        {
-          error ("read_inline_function(): fseek profile_data error.");
-          return curr_num_samples;
-        }
-
       gcc_assert (inline_depth < FB_INLINE_MAX_STACK);
       gcc_assert (inline_depth > 0);
-      if (fread (&stack_entry, stack_entry_size, inline_depth, infile)
-          != (size_t) inline_depth)
+      if (sp_read_at (prog_unit, profile_offset, &stack_entry,
+                      stack_entry_size * inline_depth) != 0)
         {
-          error ("read_inline_function(): fread profile_data error.");
+          error ("read_inline_function(): read profile_data error.");
           return curr_num_samples;
         }
       /* Set up stack buffer.  */
@@ -767,15 +844,10 @@ read_inline_function (FILE *infile, struct profile *prog_unit,
           /* Find the offset of the frequency profile.  */
           profile_offset = prog_unit->fb_hdr.fb_profile_offset
               + inline_func_hdr.func_profile_offset + j * sizeof (sample);
-          if (fseek (infile, profile_offset, SEEK_SET) != 0)
-            {
-              error ("read_inline_function(): fseek profile_data error.");
-              return curr_num_samples;
-            }
-
-          if (fread (&sample, 1, sizeof (sample), infile) != sizeof (sample))
+          if (sp_read_at (prog_unit, profile_offset, &sample,
+                          sizeof (sample)) != 0)
             {
-              error ("read_inline_function(): fread profile_data error.");
+              error ("read_inline_function(): read profile_data error.");
               return curr_num_samples;
             }
 
@@ -801,18 +873,11 @@ read_inline_function (FILE *infile, struct profile *prog_unit,
             profile_offset = prog_unit->fb_hdr.fb_profile_offset
               + inline_func_hdr.func_hist_table_offset
               + sample.hist_offset * sizeof(struct fb_info_hist);
-            if (fseek (infile, profile_offset, SEEK_SET) != 0)
-              {
-                error ("read_inline_function(): fseek profile_data error.");
-                return curr_num_samples;
-              }
-
-            if (fread (hist_buf,
-                       sample.num_value,
-                       sizeof (struct fb_info_hist),
-                       infile) != sizeof (struct fb_info_hist))
+            if (sp_read_at (prog_unit, profile_offset, hist_buf,
+                            sample.num_value * sizeof (struct fb_info_hist))
+                != 0)
               {
-                error ("read_inline_function(): fread profile_data error.");
+                error ("read_inline_function(): read profile_data error.");
                 return curr_num_samples;
               }
 
@@ -946,10 +1011,10 @@ sp_find_module_by_id (struct module_sample_hdr *hdr,
   return -1;
 }
 
-/* Read in the module grouping information from the sample profile INFILE.
-   Use PROG_UNIT to get the string table.  */
+/* Read in the module grouping information from the sample profile of
+   PROG_UNIT.  Use PROG_UNIT to get the string table.  */
 static void
-sp_read_modules (FILE *infile, struct profile *prog_unit)
+sp_read_modules (struct profile *prog_unit)
 {
   struct fb_sample_hdr *fb_hdr = &(prog_unit->fb_hdr);
   unsigned long long module_start = fb_hdr->fb_module_hdr_offset;
@@ -961,11 +1026,9 @@ sp_read_modules (FILE *infile, struct profile *prog_unit)
 
   struct module_sample_hdr *hdr = (struct module_sample_hdr *) buf;
 
-  if (fseek (infile, module_start, SEEK_SET) != 0)
-    error ("read_inline_function(): fseek profile_data error.");
-  if (fread (buf, 1, fb_hdr->fb_module_profile_size, infile) !=
-      fb_hdr->fb_module_profile_size)
-    error ("sp_read_modules(): fread module_hdr error.");
+  if (sp_read_at (prog_unit, module_start, buf,
+                  fb_hdr->fb_module_profile_size) != 0)
+    error ("sp_read_modules(): read module_hdr error.");
 
   curr_file_name = in_fnames[0];
   if (dump_file)
@@ -1018,178 +1081,262 @@ sp_read_modules (FILE *infile, struct profile *prog_unit)
     }
 }
 
+/* Read the samples of the function with header FUNC_HDR, including those
+   of its inline instances, from the sample file of PROG_UNIT into sp_htab
+   and sp_inline_htab.  Samples read from an indexed file are keyed by
+   function as well as by line.  Add the number of new <> tuples to *NUM_SAMPLES.
+   Return 0 if successful, -1 otherwise.  */
+static int
+sp_read_function (struct profile *prog_unit, struct func_sample_hdr *func_hdr,
+                  unsigned long long *num_samples)
+{
+  unsigned long long j;
+  unsigned long long num_lines;
+  unsigned long long profile_offset;
+  struct sample_freq_detail **slot;
+
+  num_lines = func_hdr->func_num_freq_entries;
+
+  sample_buf = (struct sample_freq_detail *)
+          xcalloc (num_lines + 1, sizeof (struct sample_freq_detail));
+
+  sample_buf[0].func_name =
+      &(prog_unit->str_table[func_hdr->func_name_index]);
+  sample_buf[0].filename =
+      &(prog_unit->str_table[func_hdr->func_name_index]);
+  sample_buf[0].line_num = 0;
+  sample_buf[0].discriminator = 0;
+  sample_buf[0].freq = func_hdr->entry_count;
+  sample_buf[0].num_instr = 0;
+  slot = (struct sample_freq_detail **)
+          htab_find_slot (sp_htab, &sample_buf[0], INSERT);
+  if (!*slot) {
+    *slot = &sample_buf[0];
+  }
+
+  for (j = 1; j <= num_lines; ++j)
+    {
+      struct fb_info_freq sample;
+      /* Get the offset of the frequency profile.  */
+      profile_offset = prog_unit->fb_hdr.fb_profile_offset +
+                       func_hdr->func_profile_offset +
+                       func_hdr->func_freq_offset + /* This should be 0 */
+                       (j - 1) * sizeof (sample);
+      if (sp_read_at (prog_unit, profile_offset, &sample, sizeof (sample))
+          != 0)
+        return -1;
+
+      sample_buf[j].func_name =
+          &(prog_unit->str_table[func_hdr->func_name_index]);
+      sample_buf[j].filename =
+          &(prog_unit->str_table[sample.filename_offset]);
+      sample_buf[j].line_num = sample.line_num;
+      sample_buf[j].discriminator = DISCRIM (sample.discriminator);
+      sample_buf[j].freq = sample.freq;
+      sample_buf[j].num_instr = sample.num_instr;
+      if (sample.freq > sp_max_count)
+        sp_max_count = sample.freq;
+
+      sample_buf[j].num_value = sample.num_value;
+      if (sample.num_value > 0) {
+        unsigned long long k;
+        struct fb_info_hist *hist_buf = (struct fb_info_hist *)
+            alloca (sample.num_value * sizeof (struct fb_info_hist));
+
+        /* Get the offset of the value profile.  */
+        profile_offset = prog_unit->fb_hdr.fb_profile_offset
+          + func_hdr->func_hist_table_offset
+          + sample.hist_offset * sizeof (struct fb_info_hist);
+        if (sp_read_at (prog_unit, profile_offset, hist_buf,
+                        sample.num_value * sizeof (struct fb_info_hist))
+            != 0)
+          return -1;
+
+        sample_buf[j].values = (struct sample_hist *)
+          xcalloc (sample.num_value, sizeof (struct sample_hist));
+
+        for (k = 0; k < sample.num_value; k++) {
+          sample_buf[j].values[k].type = hist_buf[k].type;
+          if (hist_buf[k].type == CALL_HIST)
+            {
+              sample_buf[j].values[k].value.func_name =
+                  &(prog_unit->str_table[hist_buf[k].value]);
+              sp_add_indirect_call (
+                  &(prog_unit->str_table[func_hdr->func_name_index]),
+                  &(prog_unit->str_table[hist_buf[k].value]),
+                  hist_buf[k].count);
+            }
+          else
+            {
+              sample_buf[j].values[k].value.value = hist_buf[k].value;
+            }
+          sample_buf[j].values[k].count = hist_buf[k].count;
+        }
+      }
+
+      /* Insert new sample into hash table.  */
+      slot = (struct sample_freq_detail **)
+          htab_find_slot (sp_htab, &sample_buf[j], INSERT);
+      if (*slot)
+        {
+          if (PARAM_VALUE (PARAM_SAMPLEFDO_USE_DISCRIMINATORS))
+            {
+              char *func_name =
+                &(prog_unit->str_table[func_hdr->func_name_index]);
+              inform (0, "Duplicate entry: %s:%d func_name:%s",
+                      sample_buf[j].filename,
+                      sample_buf[j].line_num, func_name);
+            }
+          else
+            {
+              /* When not using discriminators, merge multiple
+                 entries with different discriminator values */
+              (*slot)->freq += sample_buf[j].freq;
+              (*slot)->num_instr += sample_buf[j].num_instr;
+            }
+        }
+      else
+        {
+          *slot = &sample_buf[j];
+          (*num_samples)++;
+        }
+    }
+  if (func_hdr->func_num_inline_entries > 0)
+    *num_samples = read_inline_function (prog_unit, func_hdr, *num_samples);
+  return 0;
+}
+
 /* Read sample profile file with filename IN_FILENAME to initialize sp_htab and
-   PROG_UNIT. Return the number of <> tuples.  */
+   PROG_UNIT. Return the number of <> tuples.  If the file has a function
+   index, only map it and return the number of tuples recorded in the index;
+   sp_load_function then reads the functions the compiler looks up.  */
 static unsigned long long
 sp_reader (const char *in_filename, struct profile *prog_unit)
 {
   unsigned int num_funcs;
-  FILE *in_file;
   unsigned int i;
-  unsigned long long j;
-  unsigned long long num_lines;
-  unsigned long long profile_offset;
   unsigned long long num_samples = 0;
 
-  if ((in_file = fopen (in_filename, "r")) == NULL)
+  if ((prog_unit->file = fopen (in_filename, "r")) == NULL)
     {
       error ("Error opening sample profile file %s.\n", in_filename);
       return 0;
     }
 
-  if (read_file_header (in_file, prog_unit) != 0)
+  if (read_file_header (prog_unit) != 0)
     {
       error ("Error reading file header of %s.\n", in_filename);
-      fclose (in_file);
+      fclose (prog_unit->file);
       return 0;
     }
 
-  if (read_string_table (in_file, prog_unit) != 0)
+  if (PARAM_VALUE (PARAM_SAMPLEFDO_LAZY_LOAD))
+    sp_map_index (prog_unit);
+
+  if (read_string_table (prog_unit) != 0)
     {
       error ("Error reading string table of %s.\n", in_filename);
-      if (prog_unit->str_table)
+      if (prog_unit->str_table && !prog_unit->map)
 	free (prog_unit->str_table);
-      fclose (in_file);
+      prog_unit->str_table = NULL;
+      fclose (prog_unit->file);
       return 0;
     }
 
   if (flag_dyn_ipa)
-    sp_read_modules (in_file, prog_unit);
+    sp_read_modules (prog_unit);
+
+  if (prog_unit->index)
+    {
+      /* The mapping stays valid once the file is closed.  */
+      fclose (prog_unit->file);
+      sp_max_count = prog_unit->index_hdr.fb_max_count;
+      return prog_unit->index_hdr.fb_num_samples;
+    }
 
   num_funcs = prog_unit->fb_hdr.fb_func_hdr_num;
   for (i = 0; i < num_funcs; ++i)
     {
       struct func_sample_hdr func_hdr;
-      struct sample_freq_detail **slot;
 
-      if (read_function_header (in_file, i, prog_unit, &func_hdr) != 0)
+      if (read_function_header (i, prog_unit, &func_hdr) != 0)
 	{
 	  error ("Error reading the %dth function header of %s.\n", i,
 		  in_filename);
 	  if (prog_unit->str_table)
 	    free (prog_unit->str_table);
-	  fclose (in_file);
+	  prog_unit->str_table = NULL;
+	  fclose (prog_unit->file);
 	  return 0;
 	}
 
-      num_lines = func_hdr.func_num_freq_entries;
+      if (sp_read_function (prog_unit, &func_hdr, &num_samples) != 0)
+        {
+          fclose (prog_unit->file);
+          return 0;
+        }
+    }
 
-      sample_buf = (struct sample_freq_detail *)
-              xcalloc (num_lines + 1, sizeof (struct sample_freq_detail));
+  fclose (prog_unit->file);
+  return num_samples;
+}
 
-      sample_buf[0].func_name =
-          &(prog_unit->str_table[func_hdr.func_name_index]);
-      sample_buf[0].filename =
-          &(prog_unit->str_table[func_hdr.func_name_index]);
-      sample_buf[0].line_num = 0;
-      sample_buf[0].discriminator = 0;
-      sample_buf[0].freq = func_hdr.entry_count;
-      sample_buf[0].num_instr = 0;
-      slot = (struct sample_freq_detail **)
-              htab_find_slot (sp_htab, &sample_buf[0], INSERT);
-      if (!*slot) {
-        *slot = &sample_buf[0];
-      }
+/* Read the samples of the functions named NAME from the indexed sample
+   file, unless they have been read already.  Does nothing if the whole
+   file was read by sp_reader.  */
+static void
+sp_load_function (const char *name)
+{
+  const struct fb_func_index_entry *index = prog_unit.index;
+  unsigned long long lo, hi, num_samples = 0;
+  hashval_t hash;
 
-      for (j = 1; j <= num_lines; ++j)
-	{
-	  struct fb_info_freq sample;
-          /* Get the offset of the frequency profile.  */
-          profile_offset = prog_unit->fb_hdr.fb_profile_offset +
-                           func_hdr.func_profile_offset +
-                           func_hdr.func_freq_offset + /* This should be 0 */
-                           (j - 1) * sizeof (sample);
-          if (fseek (in_file, profile_offset, SEEK_SET) != 0)
-            return 0;
-	  if (fread (&sample, 1, sizeof (sample), in_file) != sizeof (sample))
-	    return 0;
-
-          sample_buf[j].func_name = 
-              &(prog_unit->str_table[func_hdr.func_name_index]);
-	  sample_buf[j].filename =
-  	      &(prog_unit->str_table[sample.filename_offset]);
-	  sample_buf[j].line_num = sample.line_num;
-	  sample_buf[j].discriminator = DISCRIM (sample.discriminator);
-	  sample_buf[j].freq = sample.freq;
-          sample_buf[j].num_instr = sample.num_instr;
-	  if (sample.freq > sp_max_count)
-	    sp_max_count = sample.freq;
+  if (!index || !name)
+    return;
 
-          sample_buf[j].num_value = sample.num_value;
-          if (sample.num_value > 0) {
-            unsigned long long k;
-            struct fb_info_hist *hist_buf = (struct fb_info_hist *)
-                alloca (sample.num_value * sizeof (struct fb_info_hist));
+  /* Find the first entry with the hash of NAME.  */
+  hash = htab_hash_string (name);
+  lo = 0;
+  hi = prog_unit.index_hdr.fb_index_num;
+  while (lo < hi)
+    {
+      unsigned long long mid = lo + (hi - lo) / 2;
+      if (index[mid].name_hash < hash)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
 
-            /* Get the offset of the value profile.  */
-            profile_offset = prog_unit->fb_hdr.fb_profile_offset
-              + func_hdr.func_hist_table_offset
-              + sample.hist_offset * sizeof (struct fb_info_hist);
-            if (fseek (in_file, profile_offset, SEEK_SET) != 0)
-              return 0;
-
-            if (fread (hist_buf,
-                       sample.num_value,
-                       sizeof (struct fb_info_hist),
-                       in_file) != sizeof (struct fb_info_hist)) {
-              return 0;
-            }
-            sample_buf[j].values = (struct sample_hist *)
-              xcalloc (sample.num_value, sizeof (struct sample_hist));
+  for (; lo < prog_unit.index_hdr.fb_index_num
+         && index[lo].name_hash == hash; lo++)
+    {
+      struct func_sample_hdr func_hdr;
 
-            for (k = 0; k < sample.num_value; k++) {
-              sample_buf[j].values[k].type = hist_buf[k].type;
-              if (hist_buf[k].type == CALL_HIST)
-                {
-                  sample_buf[j].values[k].value.func_name =
-                      &(prog_unit->str_table[hist_buf[k].value]);
-                  sp_add_indirect_call (
-                      &(prog_unit->str_table[func_hdr.func_name_index]),
-                      &(prog_unit->str_table[hist_buf[k].value]),
-                      hist_buf[k].count);
-                }
-              else
-                {
-                  sample_buf[j].values[k].value.value = hist_buf[k].value;
-                }
-              sample_buf[j].values[k].count = hist_buf[k].count;
-            }
-          }
+      if (prog_unit.index_loaded[lo])
+        continue;
 
-          /* Insert new sample into hash table.  */
-          slot = (struct sample_freq_detail **)
-              htab_find_slot (sp_htab, &sample_buf[j], INSERT);
-          if (*slot)
-            {
-	      if (PARAM_VALUE (PARAM_SAMPLEFDO_USE_DISCRIMINATORS))
-		{
-		  char *func_name =
-		    &(prog_unit->str_table[func_hdr.func_name_index]);
-		  inform (0, "Duplicate entry: %s:%d func_name:%s",
-			  sample_buf[j].filename,
-			  sample_buf[j].line_num, func_name);
-		}
-	      else
-		{
-		  /* When not using discriminators, merge multiple
-		     entries with different discriminator values */
-		  (*slot)->freq += sample_buf[j].freq;
-		  (*slot)->num_instr += sample_buf[j].num_instr;
-		}
-            }
-          else
-            {
-              *slot = &sample_buf[j];
-	      num_samples++;
-            }
-	}
-        if (func_hdr.func_num_inline_entries > 0)
-          num_samples = read_inline_function (in_file, prog_unit, &func_hdr,
-                                              num_samples);
-    }
+      if (index[lo].func_hdr_ix >= prog_unit.fb_hdr.fb_func_hdr_num
+          || read_function_header (index[lo].func_hdr_ix, &prog_unit,
+                                   &func_hdr) != 0
+          || func_hdr.func_name_index >= prog_unit.fb_hdr.fb_str_table_size)
+        {
+          error ("Error reading the function index of %s.\n",
+                 sample_data_name);
+          prog_unit.index_loaded[lo] = 1;
+          continue;
+        }
 
-  fclose (in_file);
-  return num_samples;
+      /* Another function with the same hash.  */
+      if (strcmp (name, &(prog_unit.str_table[func_hdr.func_name_index])))
+        continue;
+
+      prog_unit.index_loaded[lo] = 1;
+      timevar_push (TV_TREE_SAMPLE_READ);
+      if (sp_read_function (&prog_unit, &func_hdr, &num_samples) != 0)
+        error ("Error reading the samples of %s from %s.\n", name,
+               sample_data_name);
+      timevar_pop (TV_TREE_SAMPLE_READ);
+    }
 }
 
 static int
@@ -1336,8 +1483,7 @@ sp_annotate_bb (basic_block bb)
           ir_loc.line_num = lineno;
 	  ir_loc.discriminator = discriminator;
 
-          hash_val = create_hash_string (ir_loc.filename, lineno,
-                                         discriminator);
+          hash_val = sp_info_hash (&ir_loc);
 
           htab_entry = (struct sample_freq_detail *)
           htab_find_with_hash (sp_htab, (void *) &ir_loc, hash_val);
@@ -1520,6 +1666,8 @@ sp_annotate_cfg (void)
   gcov_type func_max_count = 0;
   cgraph_need_artificial_indirect_call_edges = 0;
 
+  sp_load_function (sp_get_real_funcname (current_function_assembler_name ()));
+
   if (dump_file)
     {
       fprintf (dump_file,
@@ -1620,7 +1768,9 @@ init_sample_profile (void)
                                         xcalloc,
                                         free);
 
+  timevar_push (TV_TREE_SAMPLE_READ);
   sp_num_samples = sp_reader (sample_data_name, &prog_unit);
+  timevar_pop (TV_TREE_SAMPLE_READ);
   sp_profile_info =
     (struct gcov_ctr_summary *) xcalloc (1, sizeof (struct gcov_ctr_summary));
 
@@ -1641,8 +1791,13 @@ init_sample_profile (void)
 void
 end_sample_profile (void)
 {
-  if (prog_unit.str_table)
+  if (prog_unit.str_table && !prog_unit.map)
     free (prog_unit.str_table);
+#ifdef HAVE_MMAP_FILE
+  if (prog_unit.map)
+    munmap (prog_unit.map, prog_unit.map_size);
+#endif
+  free (prog_unit.index_loaded);
   if (sp_htab)
     htab_delete (sp_htab);
   sp_htab = NULL;
@@ -48,7 +48,12 @@ along with GCC; see the file COPYING3.  If not see
    module_hdr 1
    module_hdr 2 ...
    Module_Profile_Data
-   Profile_Data.  */
+   Profile_Data.
+
+   A file may also carry a function index, which lets the compiler read
+   only the profiles of the functions it compiles.  The fb_func_index_hdr
+   then directly follows fb_sample_hdr, ahead of the pu_hdrs, and the
+   index entries are stored at fb_index_offset.  */
 
 struct fb_sample_hdr
 {
@@ -86,6 +91,38 @@ struct fb_sample_hdr
   unsigned long long fb_profile_offset;
 };
 
+/* Identifier of the optional fb_func_index_hdr.  */
+#define FB_SAMPLE_INDEX_IDENT "fb_func_index"
+
+/* Header of the function index.  */
+struct fb_func_index_hdr
+{
+  /* FB_SAMPLE_INDEX_IDENT, NUL padded.  */
+  char fb_index_ident[FB_SAMPLE_NIDENT];
+
+  /* File offset of the index entries.  */
+  unsigned long long fb_index_offset;
+
+  /* Number of index entries, equal to fb_func_hdr_num.  */
+  unsigned long long fb_index_num;
+
+  /* Number of <filename, line_num, freq> tuples in the file.  */
+  unsigned long long fb_num_samples;
+
+  /* Maximum freq of any tuple in the file.  */
+  unsigned long long fb_max_count;
+};
+
+/* Index entry for a function header, sorted by NAME_HASH.  */
+struct fb_func_index_entry
+{
+  /* htab_hash_string of the function name.  */
+  unsigned int name_hash;
+
+  /* Index of the function header.  */
+  unsigned int func_hdr_ix;
+};
+
 /* Header for each function.  */
 struct func_sample_hdr
 {
@@ -256,6 +293,19 @@ struct profile
 {
   struct fb_sample_hdr fb_hdr;
   char *str_table;
+
+  /* The feedback data file while it is being read.  */
+  FILE *file;
+
+  /* The mapped feedback data file if it has a function index, in which
+     case functions are read when first looked up.  */
+  char *map;
+  size_t map_size;
+  struct fb_func_index_hdr index_hdr;
+  const struct fb_func_index_entry *index;
+
+  /* Whether the function of each index entry has been read.  */
+  unsigned char *index_loaded;
 };
 
 extern void init_sample_profile (void);
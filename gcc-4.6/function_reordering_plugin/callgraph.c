@@ -0,0 +1,738 @@
+/* Callgraph based function layout for the function reordering plugin.
+   Copyright (C) 2011 Free Software Foundation, Inc.
+
+This file is part of GCC.
+
+GCC is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation; either version 3, or (at your option) any later
+version.
+
+GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with GCC; see the file COPYING3.  If not see
+<http://www.gnu.org/licenses/>.  */
+
+/* The call graph is read from the .gnu.callgraph.text sections that
+   -fcallgraph-profiles-sections makes the compiler emit.  Each section
+   is a sequence of NUL terminated strings: "Function <name>", followed
+   by a callee name and a decimal call count for each profiled call.
+
+   Functions are laid out as described by Pettis and Hansen, "Profile
+   Guided Code Positioning", PLDI 1990.  Every function starts as a
+   chain of its own.  The heaviest remaining edge between two chains
+   merges them, and the edges of the merged chains to any third chain
+   are combined.  The two chains are joined at the ends whose functions
+   call each other the most, reversing one of them if needed.  Chains
+   are then placed in order of decreasing call weight.
+
+   The text sections of functions not in the call graph follow in input
+   order, and the .text.unlikely sections, holding unlikely executed
+   functions and the cold parts of split functions, come last.  */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libiberty.h"
+#include "hashtab.h"
+#include "callgraph.h"
+
+/* A text section of an input file.  */
+
+struct section_id
+{
+  /* Name of the function in the section.  */
+  char *name;
+  /* Full section name.  */
+  char *section_name;
+  void *handle;
+  unsigned int shndx;
+  /* Nonzero once the section is in the layout.  */
+  int placed;
+  /* Next section in input order.  */
+  struct section_id *next;
+};
+
+/* A function in the call graph.  */
+
+struct node
+{
+  unsigned int id;
+  char *name;
+  /* Nonzero once the callees of the function have been read, so that
+     the copies of a COMDAT function in other objects are ignored.  */
+  int is_parsed;
+};
+
+/* A call graph edge between the functions with ids A < B, with the
+   calls in both directions counted in WEIGHT.  */
+
+struct edge
+{
+  unsigned int a, b;
+  unsigned long long weight;
+};
+
+/* An edge between two chains, as seen by merge_chains.  */
+
+struct adjacent
+{
+  unsigned int chain;
+  unsigned long long weight;
+};
+
+/* A candidate chain merge.  It is stale unless both chains are still
+   chain heads with the recorded versions.  */
+
+struct heap_entry
+{
+  unsigned int a, b;
+  unsigned int version_a, version_b;
+  unsigned long long weight;
+};
+
+/* Functions by name and by id.  */
+static htab_t node_htab;
+static struct node **nodes;
+static unsigned int num_nodes, alloc_nodes;
+
+/* Edges by function pair.  */
+static htab_t edge_htab;
+static unsigned int num_edges;
+
+/* Hot and unlikely text sections by function name, and in input
+   order.  */
+static htab_t section_htab;
+static htab_t unlikely_section_htab;
+static struct section_id *first_section, **last_section = &first_section;
+static struct section_id *first_unlikely, **last_unlikely = &first_unlikely;
+
+/* The chains.  A chain is identified by the id of its first merged
+   function, CHAIN_OF maps functions to it, and the functions of a chain
+   are linked from CHAIN_HEAD to CHAIN_TAIL by NEXT_IN_CHAIN and
+   PREV_IN_CHAIN.  */
+static unsigned int *chain_of;
+static unsigned int *chain_head, *chain_tail;
+static unsigned int *next_in_chain, *prev_in_chain;
+static unsigned int *chain_version;
+static unsigned long long *chain_weight;
+static struct adjacent **adjacent;
+static unsigned int *num_adjacent;
+
+/* The chain heads in layout order.  */
+static unsigned int *layout;
+static unsigned int num_layout;
+
+#define NO_NODE ((unsigned int) -1)
+
+static hashval_t
+node_hash (const void *p)
+{
+  return htab_hash_string (((const struct node *) p)->name);
+}
+
+static int
+node_eq (const void *p1, const void *p2)
+{
+  return !strcmp (((const struct node *) p1)->name,
+		  ((const struct node *) p2)->name);
+}
+
+static hashval_t
+edge_hash (const void *p)
+{
+  const struct edge *e = (const struct edge *) p;
+
+  return e->a * 31 + e->b;
+}
+
+static int
+edge_eq (const void *p1, const void *p2)
+{
+  const struct edge *e1 = (const struct edge *) p1;
+  const struct edge *e2 = (const struct edge *) p2;
+
+  return e1->a == e2->a && e1->b == e2->b;
+}
+
+static hashval_t
+section_hash (const void *p)
+{
+  return htab_hash_string (((const struct section_id *) p)->name);
+}
+
+static int
+section_eq (const void *p1, const void *p2)
+{
+  return !strcmp (((const struct section_id *) p1)->name,
+		  ((const struct section_id *) p2)->name);
+}
+
+/* Return the function named NAME, creating it if needed.  */
+
+static struct node *
+get_node (const char *name)
+{
+  struct node key, **slot;
+
+  /* Names of functions with an asm name start with '*'.  */
+  if (*name == '*')
+    name++;
+
+  if (!node_htab)
+    node_htab = htab_create (1000, node_hash, node_eq, NULL);
+
+  key.name = CONST_CAST (char *, name);
+  slot = (struct node **) htab_find_slot (node_htab, &key, INSERT);
+  if (!*slot)
+    {
+      if (num_nodes == alloc_nodes)
+	{
+	  alloc_nodes = alloc_nodes * 2 + 1000;
+	  nodes = XRESIZEVEC (struct node *, nodes, alloc_nodes);
+	}
+      *slot = XCNEW (struct node);
+      (*slot)->id = num_nodes;
+      (*slot)->name = xstrdup (name);
+      nodes[num_nodes++] = *slot;
+    }
+  return *slot;
+}
+
+/* Add WEIGHT to the edge between the functions with ids A and B.  */
+
+static void
+add_edge (unsigned int a, unsigned int b, unsigned long long weight)
+{
+  struct edge key, **slot;
+
+  if (a == b || weight == 0)
+    return;
+  if (!edge_htab)
+    edge_htab = htab_create (1000, edge_hash, edge_eq, free);
+
+  key.a = a < b ? a : b;
+  key.b = a < b ? b : a;
+  slot = (struct edge **) htab_find_slot (edge_htab, &key, INSERT);
+  if (!*slot)
+    {
+      *slot = XNEW (struct edge);
+      **slot = key;
+      (*slot)->weight = 0;
+      num_edges++;
+    }
+  (*slot)->weight += weight;
+}
+
+/* Return the weight of the edge between the functions with ids A and
+   B.  */
+
+static unsigned long long
+edge_weight (unsigned int a, unsigned int b)
+{
+  struct edge key, *e;
+
+  key.a = a < b ? a : b;
+  key.b = a < b ? b : a;
+  e = (struct edge *) htab_find (edge_htab, &key);
+  return e ? e->weight : 0;
+}
+
+void
+parse_callgraph_section_contents (const unsigned char *contents,
+				  unsigned int length)
+{
+  const char *p = (const char *) contents;
+  const char *end = p + length;
+  struct node *caller = NULL;
+
+  while (p < end)
+    {
+      const char *callee = p;
+      const char *count;
+
+      p = (const char *) memchr (p, '\0', end - p);
+      if (!p)
+	return;
+      p++;
+      if (!strncmp (callee, "Function ", 9))
+	{
+	  caller = get_node (callee + 9);
+	  /* Copies of COMDAT functions carry the same profile.  */
+	  if (caller->is_parsed)
+	    caller = NULL;
+	  else
+	    caller->is_parsed = 1;
+	  continue;
+	}
+
+      count = p;
+      p = (const char *) memchr (p, '\0', end - p);
+      if (!p)
+	return;
+      p++;
+      if (caller)
+	add_edge (caller->id, get_node (callee)->id,
+		  strtoull (count, NULL, 10));
+    }
+}
+
+/* Record SECTION_NAME for function NAME in HTAB and the list ending in
+   *LAST.  Only the first of several sections for NAME is kept, as the
+   linker keeps the first copy of a COMDAT function.  */
+
+static void
+add_section (htab_t *htab, struct section_id ***last, const char *name,
+	     const char *section_name, void *handle, unsigned int shndx)
+{
+  struct section_id key, **slot;
+
+  if (!*htab)
+    *htab = htab_create (1000, section_hash, section_eq, NULL);
+
+  key.name = CONST_CAST (char *, name);
+  slot = (struct section_id **) htab_find_slot (*htab, &key, INSERT);
+  if (*slot)
+    return;
+
+  *slot = XCNEW (struct section_id);
+  (*slot)->name = xstrdup (name);
+  (*slot)->section_name = xstrdup (section_name);
+  (*slot)->handle = handle;
+  (*slot)->shndx = shndx;
+  **last = *slot;
+  *last = &(*slot)->next;
+}
+
+void
+map_section_name_to_index (const char *section_name, void *handle,
+			   unsigned int shndx)
+{
+  if (!strncmp (section_name, ".text.unlikely.", 15))
+    add_section (&unlikely_section_htab, &last_unlikely, section_name + 15,
+		 section_name, handle, shndx);
+  else if (!strncmp (section_name, ".text.hot.", 10))
+    add_section (&section_htab, &last_section, section_name + 10,
+		 section_name, handle, shndx);
+  /* Startup and exit code is grouped by the linker.  */
+  else if (!strncmp (section_name, ".text.startup.", 14)
+	   || !strncmp (section_name, ".text.exit.", 11))
+    return;
+  else if (!strncmp (section_name, ".text.", 6))
+    add_section (&section_htab, &last_section, section_name + 6,
+		 section_name, handle, shndx);
+}
+
+int
+is_callgraph_empty (void)
+{
+  return num_edges == 0;
+}
+
+/* Return the section for function NAME in HTAB, or NULL.  */
+
+static struct section_id *
+find_section (htab_t htab, const char *name)
+{
+  struct section_id key;
+
+  if (!htab)
+    return NULL;
+  key.name = CONST_CAST (char *, name);
+  return (struct section_id *) htab_find (htab, &key);
+}
+
+/* The candidate merges, a binary max-heap on weight.  */
+static struct heap_entry *heap;
+static unsigned int heap_size, heap_alloc;
+
+/* Return nonzero if heap entry I is heavier than entry J.  Ties go to
+   the entry with the lower chain ids, to keep the layout independent
+   of the hash table order.  */
+
+static int
+heap_greater (unsigned int i, unsigned int j)
+{
+  if (heap[i].weight != heap[j].weight)
+    return heap[i].weight > heap[j].weight;
+  if (heap[i].a != heap[j].a)
+    return heap[i].a < heap[j].a;
+  return heap[i].b < heap[j].b;
+}
+
+static void
+heap_swap (unsigned int i, unsigned int j)
+{
+  struct heap_entry tmp = heap[i];
+
+  heap[i] = heap[j];
+  heap[j] = tmp;
+}
+
+/* Add a candidate merge of chains A and B with WEIGHT.  */
+
+static void
+heap_push (unsigned int a, unsigned int b, unsigned long long weight)
+{
+  unsigned int i;
+
+  if (heap_size == heap_alloc)
+    {
+      heap_alloc = heap_alloc * 2 + 1000;
+      heap = XRESIZEVEC (struct heap_entry, heap, heap_alloc);
+    }
+  i = heap_size++;
+  heap[i].a = a < b ? a : b;
+  heap[i].b = a < b ? b : a;
+  heap[i].version_a = chain_version[heap[i].a];
+  heap[i].version_b = chain_version[heap[i].b];
+  heap[i].weight = weight;
+  while (i > 0 && heap_greater (i, (i - 1) / 2))
+    {
+      heap_swap (i, (i - 1) / 2);
+      i = (i - 1) / 2;
+    }
+}
+
+/* Remove the heaviest candidate merge and store it in *ENTRY.  */
+
+static void
+heap_pop (struct heap_entry *entry)
+{
+  unsigned int i = 0;
+
+  *entry = heap[0];
+  heap[0] = heap[--heap_size];
+  for (;;)
+    {
+      unsigned int largest = i;
+      unsigned int left = 2 * i + 1, right = 2 * i + 2;
+
+      if (left < heap_size && heap_greater (left, largest))
+	largest = left;
+      if (right < heap_size && heap_greater (right, largest))
+	largest = right;
+      if (largest == i)
+	break;
+      heap_swap (i, largest);
+      i = largest;
+    }
+}
+
+/* Add the edge E to the adjacency lists of its chains.  */
+
+static int
+add_adjacent (void **slot, void *data ATTRIBUTE_UNUSED)
+{
+  const struct edge *e = (const struct edge *) *slot;
+
+  adjacent[e->a][num_adjacent[e->a]].chain = e->b;
+  adjacent[e->a][num_adjacent[e->a]++].weight = e->weight;
+  adjacent[e->b][num_adjacent[e->b]].chain = e->a;
+  adjacent[e->b][num_adjacent[e->b]++].weight = e->weight;
+  return 1;
+}
+
+/* Count the edge E for the adjacency lists of its chains.  */
+
+static int
+count_adjacent (void **slot, void *data ATTRIBUTE_UNUSED)
+{
+  const struct edge *e = (const struct edge *) *slot;
+
+  num_adjacent[e->a]++;
+  num_adjacent[e->b]++;
+  return 1;
+}
+
+/* Reverse the order of the functions in chain C.  */
+
+static void
+reverse_chain (unsigned int c)
+{
+  unsigned int n, tmp;
+
+  for (n = chain_head[c]; n != NO_NODE; n = prev_in_chain[n])
+    {
+      tmp = next_in_chain[n];
+      next_in_chain[n] = prev_in_chain[n];
+      prev_in_chain[n] = tmp;
+    }
+  tmp = chain_head[c];
+  chain_head[c] = chain_tail[c];
+  chain_tail[c] = tmp;
+}
+
+/* Merge chain B into chain A, joined by the edge with WEIGHT.  SLOT is
+   scratch space of NUM_NODES entries set to NO_NODE.  */
+
+static void
+merge_chains (unsigned int a, unsigned int b, unsigned long long weight,
+	      unsigned int *slot)
+{
+  unsigned long long tail_head, tail_tail, head_head, head_tail;
+  struct adjacent *merged;
+  unsigned int i, n, num_merged;
+
+  /* Join the chains where the functions at the ends call each other
+     the most.  */
+  tail_head = edge_weight (chain_tail[a], chain_head[b]);
+  tail_tail = edge_weight (chain_tail[a], chain_tail[b]);
+  head_head = edge_weight (chain_head[a], chain_head[b]);
+  head_tail = edge_weight (chain_head[a], chain_tail[b]);
+  if (tail_tail > tail_head && tail_tail >= head_head
+      && tail_tail >= head_tail)
+    reverse_chain (b);
+  else if (head_head > tail_head && head_head >= head_tail)
+    reverse_chain (a);
+  else if (head_tail > tail_head)
+    {
+      reverse_chain (a);
+      reverse_chain (b);
+    }
+  next_in_chain[chain_tail[a]] = chain_head[b];
+  prev_in_chain[chain_head[b]] = chain_tail[a];
+  chain_tail[a] = chain_tail[b];
+  for (n = chain_head[b]; n != NO_NODE; n = next_in_chain[n])
+    chain_of[n] = a;
+  chain_weight[a] += chain_weight[b] + weight;
+
+  /* Combine the edges of A and B to other chains.  Entries for chains
+     merged since are folded into their chain as well.  */
+  merged = XNEWVEC (struct adjacent, num_adjacent[a] + num_adjacent[b]);
+  num_merged = 0;
+  for (i = 0; i < num_adjacent[a] + num_adjacent[b]; i++)
+    {
+      struct adjacent *adj = (i < num_adjacent[a]
+			      ? &adjacent[a][i]
+			      : &adjacent[b][i - num_adjacent[a]]);
+      unsigned int c = chain_of[adj->chain];
+
+      if (c == a)
+	continue;
+      if (slot[c] == NO_NODE)
+	{
+	  slot[c] = num_merged;
+	  merged[num_merged].chain = c;
+	  merged[num_merged++].weight = 0;
+	}
+      merged[slot[c]].weight += adj->weight;
+    }
+  free (adjacent[a]);
+  free (adjacent[b]);
+  adjacent[a] = merged;
+  num_adjacent[a] = num_merged;
+  adjacent[b] = NULL;
+  num_adjacent[b] = 0;
+
+  chain_version[a]++;
+  chain_version[b]++;
+  for (i = 0; i < num_merged; i++)
+    {
+      slot[merged[i].chain] = NO_NODE;
+      heap_push (a, merged[i].chain, merged[i].weight);
+    }
+}
+
+/* Order chain heads by decreasing weight, then by id.  */
+
+static int
+compare_chains (const void *p1, const void *p2)
+{
+  unsigned int c1 = *(const unsigned int *) p1;
+  unsigned int c2 = *(const unsigned int *) p2;
+
+  if (chain_weight[c1] != chain_weight[c2])
+    return chain_weight[c1] > chain_weight[c2] ? -1 : 1;
+  return c1 < c2 ? -1 : c1 > c2;
+}
+
+void
+find_pettis_hansen_function_layout (void)
+{
+  struct heap_entry entry;
+  unsigned int *slot;
+  unsigned int i;
+
+  chain_of = XNEWVEC (unsigned int, num_nodes);
+  chain_head = XNEWVEC (unsigned int, num_nodes);
+  chain_tail = XNEWVEC (unsigned int, num_nodes);
+  next_in_chain = XNEWVEC (unsigned int, num_nodes);
+  prev_in_chain = XNEWVEC (unsigned int, num_nodes);
+  chain_version = XCNEWVEC (unsigned int, num_nodes);
+  chain_weight = XCNEWVEC (unsigned long long, num_nodes);
+  adjacent = XNEWVEC (struct adjacent *, num_nodes);
+  num_adjacent = XCNEWVEC (unsigned int, num_nodes);
+  slot = XNEWVEC (unsigned int, num_nodes);
+  for (i = 0; i < num_nodes; i++)
+    {
+      chain_of[i] = chain_head[i] = chain_tail[i] = i;
+      next_in_chain[i] = prev_in_chain[i] = NO_NODE;
+      slot[i] = NO_NODE;
+    }
+
+  if (edge_htab)
+    {
+      htab_traverse (edge_htab, count_adjacent, NULL);
+      for (i = 0; i < num_nodes; i++)
+	{
+	  adjacent[i] = XNEWVEC (struct adjacent, num_adjacent[i]);
+	  num_adjacent[i] = 0;
+	}
+      htab_traverse (edge_htab, add_adjacent, NULL);
+      for (i = 0; i < num_nodes; i++)
+	{
+	  unsigned int j;
+
+	  for (j = 0; j < num_adjacent[i]; j++)
+	    if (i < adjacent[i][j].chain)
+	      heap_push (i, adjacent[i][j].chain, adjacent[i][j].weight);
+	}
+    }
+  else
+    for (i = 0; i < num_nodes; i++)
+      adjacent[i] = NULL;
+
+  while (heap_size)
+    {
+      heap_pop (&entry);
+      if (chain_of[entry.a] != entry.a || chain_of[entry.b] != entry.b
+	  || chain_version[entry.a] != entry.version_a
+	  || chain_version[entry.b] != entry.version_b)
+	continue;
+      merge_chains (entry.a, entry.b, entry.weight, slot);
+    }
+
+  layout = XNEWVEC (unsigned int, num_nodes);
+  num_layout = 0;
+  for (i = 0; i < num_nodes; i++)
+    if (chain_of[i] == i)
+      layout[num_layout++] = i;
+  qsort (layout, num_layout, sizeof (unsigned int), compare_chains);
+
+  free (slot);
+}
+
+/* Append SECTION to the layout in *HANDLES and *SHNDX at position *N,
+   and write its name to FP if it is not NULL.  */
+
+static void
+place_section (FILE *fp, struct section_id *section, void **handles,
+	       unsigned int *shndx, unsigned int *n)
+{
+  if (section->placed)
+    return;
+  section->placed = 1;
+  handles[*n] = section->handle;
+  shndx[*n] = section->shndx;
+  (*n)++;
+  if (fp)
+    fprintf (fp, "%s\n", section->section_name);
+}
+
+unsigned int
+get_layout (FILE *fp, void ***handles, unsigned int **shndx)
+{
+  struct section_id *section;
+  unsigned int i, n = 0, num_sections = 0;
+
+  for (section = first_section; section; section = section->next)
+    num_sections++;
+  for (section = first_unlikely; section; section = section->next)
+    num_sections++;
+  *handles = XNEWVEC (void *, num_sections);
+  *shndx = XNEWVEC (unsigned int, num_sections);
+
+  for (i = 0; i < num_layout; i++)
+    {
+      unsigned int node;
+
+      for (node = chain_head[layout[i]]; node != NO_NODE;
+	   node = next_in_chain[node])
+	{
+	  section = find_section (section_htab, nodes[node]->name);
+	  if (section)
+	    place_section (fp, section, *handles, *shndx, &n);
+	}
+    }
+  for (section = first_section; section; section = section->next)
+    place_section (fp, section, *handles, *shndx, &n);
+  for (section = first_unlikely; section; section = section->next)
+    place_section (fp, section, *handles, *shndx, &n);
+  return n;
+}
+
+/* Free the sections in the list FIRST.  */
+
+static void
+free_sections (struct section_id *first)
+{
+  struct section_id *next;
+
+  for (; first; first = next)
+    {
+      next = first->next;
+      free (first->name);
+      free (first->section_name);
+      free (first);
+    }
+}
+
+void
+cleanup (void)
+{
+  unsigned int i;
+
+  for (i = 0; i < num_nodes; i++)
+    {
+      if (adjacent)
+	free (adjacent[i]);
+      free (nodes[i]->name);
+      free (nodes[i]);
+    }
+  free (nodes);
+  nodes = NULL;
+  num_nodes = alloc_nodes = 0;
+  if (node_htab)
+    htab_delete (node_htab);
+  node_htab = NULL;
+  if (edge_htab)
+    htab_delete (edge_htab);
+  edge_htab = NULL;
+  num_edges = 0;
+
+  if (section_htab)
+    htab_delete (section_htab);
+  if (unlikely_section_htab)
+    htab_delete (unlikely_section_htab);
+  section_htab = unlikely_section_htab = NULL;
+  free_sections (first_section);
+  free_sections (first_unlikely);
+  first_section = first_unlikely = NULL;
+  last_section = &first_section;
+  last_unlikely = &first_unlikely;
+
+  free (chain_of);
+  free (chain_head);
+  free (chain_tail);
+  free (next_in_chain);
+  free (prev_in_chain);
+  free (chain_version);
+  free (chain_weight);
+  free (adjacent);
+  free (num_adjacent);
+  free (layout);
+  free (heap);
+  chain_of = chain_head = chain_tail = NULL;
+  next_in_chain = prev_in_chain = chain_version = NULL;
+  chain_weight = NULL;
+  adjacent = NULL;
+  num_adjacent = layout = NULL;
+  heap = NULL;
+  num_layout = heap_size = heap_alloc = 0;
+}
@@ -0,0 +1,48 @@
+/* Callgraph based function layout for the function reordering plugin.
+   Copyright (C) 2011 Free Software Foundation, Inc.
+
+This file is part of GCC.
+
+GCC is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation; either version 3, or (at your option) any later
+version.
+
+GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with GCC; see the file COPYING3.  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#ifndef CALLGRAPH_H
+#define CALLGRAPH_H
+
+#include <stdio.h>
+
+/* Add the call graph edges in CONTENTS, the LENGTH bytes of a
+   .gnu.callgraph.text section, to the program call graph.  */
+void parse_callgraph_section_contents (const unsigned char *contents,
+				       unsigned int length);
+
+/* Record that the text section SECTION_NAME is section SHNDX of the
+   input file with HANDLE.  */
+void map_section_name_to_index (const char *section_name, void *handle,
+				unsigned int shndx);
+
+/* Return nonzero if no call graph edges were read.  */
+int is_callgraph_empty (void);
+
+/* Compute the function layout from the call graph.  */
+void find_pettis_hansen_function_layout (void);
+
+/* Store the text sections in layout order in *HANDLES and *SHNDX, and
+   return their number.  Write their names to FP if it is not NULL.  */
+unsigned int get_layout (FILE *fp, void ***handles, unsigned int **shndx);
+
+/* Free the call graph and the section map.  */
+void cleanup (void);
+
+#endif /* CALLGRAPH_H */
@@ -0,0 +1,242 @@
+/* Function re-ordering plugin for gold.
+   Copyright (C) 2011 Free Software Foundation, Inc.
+
+This file is part of GCC.
+
+GCC is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation; either version 3, or (at your option) any later
+version.
+
+GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with GCC; see the file COPYING3.  If not see
+<http://www.gnu.org/licenses/>.  */
+
+/* This plugin lays out the functions of a program so that functions
+   that call each other often end up close together, and cold code ends
+   up away from hot code, using the call graph profile the compiler
+   emits with -fcallgraph-profiles-sections.  The objects must be
+   compiled with -ffunction-sections, and with -fprofile-use so that
+   there is a profile.
+
+   The plugin looks at the sections of every input file without claiming
+   any.  Once all symbols are read it computes the layout in callgraph.c
+   and passes it to gold with update_section_order.
+
+   Usage: --plugin libfunction_reordering_plugin.so
+   Options, given with --plugin-opt:
+     file=<name>  Also write the layout to <name>, in the format of
+		  gold's --section-ordering-file.  */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libiberty.h"
+#include "plugin-api.h"
+#include "callgraph.h"
+
+/* Linker interfaces.  */
+static ld_plugin_register_claim_file register_claim_file_hook = NULL;
+static ld_plugin_register_all_symbols_read
+  register_all_symbols_read_hook = NULL;
+static ld_plugin_register_cleanup register_cleanup_hook = NULL;
+static ld_plugin_message message = NULL;
+static ld_plugin_get_input_section_count get_input_section_count = NULL;
+static ld_plugin_get_input_section_name get_input_section_name = NULL;
+static ld_plugin_get_input_section_contents get_input_section_contents = NULL;
+static ld_plugin_update_section_order update_section_order = NULL;
+static ld_plugin_allow_section_ordering allow_section_ordering = NULL;
+
+/* Name of the file to write the layout to, or NULL.  */
+static char *layout_file_name = NULL;
+
+/* Nonzero once gold has been asked to allow section ordering.  */
+static int is_ordering_specified = 0;
+
+/* Process the plugin option OPTION.  */
+
+static void
+process_option (const char *option)
+{
+  if (!strncmp (option, "file=", 5))
+    {
+      free (layout_file_name);
+      layout_file_name = xstrdup (option + 5);
+    }
+  else if (message)
+    message (LDPL_WARNING, "function reordering plugin: "
+	     "ignoring unknown option %s", option);
+}
+
+/* Read the call graph sections and map the text sections of the input
+   FILE.  FILE is never claimed.  */
+
+static enum ld_plugin_status
+claim_file_hook (const struct ld_plugin_input_file *file, int *claimed)
+{
+  unsigned int num_input_sections;
+  unsigned int i;
+
+  *claimed = 0;
+
+  if (!is_ordering_specified)
+    {
+      allow_section_ordering ();
+      is_ordering_specified = 1;
+    }
+
+  if (get_input_section_count (file->handle, &num_input_sections) != LDPS_OK)
+    return LDPS_OK;
+
+  for (i = 0; i < num_input_sections; i++)
+    {
+      struct ld_plugin_section section;
+      const unsigned char *contents;
+      size_t length;
+      char *name;
+
+      section.handle = file->handle;
+      section.shndx = i;
+      if (get_input_section_name (section, &name) != LDPS_OK)
+	continue;
+
+      if (!strncmp (name, ".gnu.callgraph.text", 19))
+	{
+	  if (get_input_section_contents (section, &contents,
+					  &length) == LDPS_OK)
+	    parse_callgraph_section_contents (contents, length);
+	}
+      else if (!strncmp (name, ".text.", 6))
+	map_section_name_to_index (name, file->handle, i);
+      free (name);
+    }
+
+  return LDPS_OK;
+}
+
+/* Compute the function layout and pass it to the linker.  */
+
+static enum ld_plugin_status
+all_symbols_read_hook (void)
+{
+  struct ld_plugin_section *section_list;
+  unsigned int num_sections, i;
+  unsigned int *shndx;
+  void **handles;
+  FILE *fp = NULL;
+
+  if (is_callgraph_empty ())
+    return LDPS_OK;
+
+  if (layout_file_name)
+    {
+      fp = fopen (layout_file_name, "w");
+      if (!fp && message)
+	message (LDPL_WARNING, "function reordering plugin: "
+		 "cannot open %s", layout_file_name);
+    }
+
+  find_pettis_hansen_function_layout ();
+  num_sections = get_layout (fp, &handles, &shndx);
+  if (fp)
+    fclose (fp);
+
+  section_list = XNEWVEC (struct ld_plugin_section, num_sections);
+  for (i = 0; i < num_sections; i++)
+    {
+      section_list[i].handle = handles[i];
+      section_list[i].shndx = shndx[i];
+    }
+  if (num_sections)
+    update_section_order (section_list, num_sections);
+
+  free (section_list);
+  free (handles);
+  free (shndx);
+  return LDPS_OK;
+}
+
+/* Free the plugin's data.  */
+
+static enum ld_plugin_status
+cleanup_hook (void)
+{
+  cleanup ();
+  free (layout_file_name);
+  layout_file_name = NULL;
+  return LDPS_OK;
+}
+
+/* Called by the linker when the plugin is loaded.  TV lists the linker
+   interfaces and the plugin options.  */
+
+enum ld_plugin_status
+onload (struct ld_plugin_tv *tv)
+{
+  struct ld_plugin_tv *entry;
+
+  for (entry = tv; entry->tv_tag != LDPT_NULL; entry++)
+    switch (entry->tv_tag)
+      {
+      case LDPT_REGISTER_CLAIM_FILE_HOOK:
+	register_claim_file_hook = entry->tv_u.tv_register_claim_file;
+	break;
+      case LDPT_REGISTER_ALL_SYMBOLS_READ_HOOK:
+	register_all_symbols_read_hook
+	  = entry->tv_u.tv_register_all_symbols_read;
+	break;
+      case LDPT_REGISTER_CLEANUP_HOOK:
+	register_cleanup_hook = entry->tv_u.tv_register_cleanup;
+	break;
+      case LDPT_MESSAGE:
+	message = entry->tv_u.tv_message;
+	break;
+      case LDPT_GET_INPUT_SECTION_COUNT:
+	get_input_section_count = entry->tv_u.tv_get_input_section_count;
+	break;
+      case LDPT_GET_INPUT_SECTION_NAME:
+	get_input_section_name = entry->tv_u.tv_get_input_section_name;
+	break;
+      case LDPT_GET_INPUT_SECTION_CONTENTS:
+	get_input_section_contents = entry->tv_u.tv_get_input_section_contents;
+	break;
+      case LDPT_UPDATE_SECTION_ORDER:
+	update_section_order = entry->tv_u.tv_update_section_order;
+	break;
+      case LDPT_ALLOW_SECTION_ORDERING:
+	allow_section_ordering = entry->tv_u.tv_allow_section_ordering;
+	break;
+      default:
+	break;
+      }
+
+  /* Options are processed once MESSAGE is known.  */
+  for (entry = tv; entry->tv_tag != LDPT_NULL; entry++)
+    if (entry->tv_tag == LDPT_OPTION)
+      process_option (entry->tv_u.tv_string);
+
+  /* Section ordering needs a linker with the section interfaces; do
+     nothing with others.  */
+  if (!register_claim_file_hook || !register_all_symbols_read_hook
+      || !get_input_section_count || !get_input_section_name
+      || !get_input_section_contents || !update_section_order
+      || !allow_section_ordering)
+    {
+      if (message)
+	message (LDPL_WARNING, "function reordering plugin: "
+		 "linker does not support section ordering");
+      return LDPS_OK;
+    }
+
+  register_claim_file_hook (claim_file_hook);
+  register_all_symbols_read_hook (all_symbols_read_hook);
+  if (register_cleanup_hook)
+    register_cleanup_hook (cleanup_hook);
+  return LDPS_OK;
+}
@@ -0,0 +1,967 @@
+/* The dynamic call graph and the LIPO module groups computed from it.
+   Copyright (C) 2009, 2011. Free Software Foundation, Inc.
+   Contributed by Xinliang David Li (davidxl@google.com) and
+                  Raksit Ashok  (raksit@google.com)
+
+This file is part of GCC.
+
+GCC is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation; either version 3, or (at your option) any later
+version.
+
+GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+Under Section 7 of GPL version 3, you are granted additional
+permissions described in the GCC Runtime Library Exception, version
+3.1, as published by the Free Software Foundation.
+
+You should have received a copy of the GNU General Public License and
+a copy of the GCC Runtime Library Exception along with this program;
+see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+<http://www.gnu.org/licenses/>.  */
+
+/* This file is included by dyn-ipa.c, which groups the modules when a
+   training run exits, and by gcov-merge.c, which groups them from the
+   merged gcda files.  In libgcov a module is described by its
+   gcov_info; in gcov-merge by the merge_object read from its gcda
+   file.  The includer builds the call graph from the call counters,
+   with gcov_build_callgraph_dc_fn and gcov_build_callgraph_ic_fn, and
+   then calls gcov_compute_cutoff_count and
+   gcov_compute_module_groups.  */
+
+struct dyn_pointer_set;
+
+struct dyn_cgraph_node
+{
+  struct dyn_pointer_set *imported_modules;
+
+  gcov_type guid;
+  gcov_type sum_in_count;
+
+  /* The out edges of the node are the N_CALLEES entries of the edge
+     array starting at FIRST_CALLEE.  The in edges are the edges whose
+     indices are the N_CALLERS entries of the caller edge array starting
+     at FIRST_CALLER.  */
+  unsigned first_callee;
+  unsigned n_callees;
+  unsigned first_caller;
+  unsigned n_callers;
+  gcov_unsigned_t visited;
+};
+
+struct dyn_cgraph_edge
+{
+  /* Indices of the caller and the callee in the node array.  */
+  unsigned caller;
+  unsigned callee;
+  gcov_type count;
+};
+
+#if !IN_LIBGCOV
+/* Information about a single imported module.  In libgcov this is
+   defined in gcov-io.h and points to the gcov_info of the module.  */
+struct dyn_imp_mod
+{
+  /* Index of the module, its ident minus one.  */
+  gcov_unsigned_t mod_id;
+  double weight;
+};
+#endif
+
+struct dyn_module_info
+{
+  struct dyn_pointer_set *imported_modules;
+  gcov_unsigned_t max_func_ident;
+  /* Index in the node array of the node for function ident 0.  */
+  unsigned node_base;
+#if !IN_LIBGCOV
+  /* The profile, or NULL if no gcda file has this ident.  */
+  struct merge_object *obj;
+  /* The module info record of the module itself in the trailer of OBJ:
+     tag, length and data.  */
+  const gcov_unsigned_t *mod_info;
+  int is_exported;
+#endif
+};
+
+struct dyn_cgraph
+{
+#if IN_LIBGCOV
+  struct gcov_info **modules;
+  const struct gcov_fn_info ***functions;
+#endif
+  /* supplement module information  */
+  struct dyn_module_info *sup_modules;
+
+  /* The nodes of all modules.  The node of a function is at the
+     NODE_BASE of its module plus its ident, so no lookup is needed.
+     Nodes for idents without a function have a zero guid.  */
+  struct dyn_cgraph_node *nodes;
+  unsigned num_nodes;
+
+  /* The edges, grouped by caller.  */
+  struct dyn_cgraph_edge *edges;
+  unsigned num_edges;
+  unsigned alloc_edges;
+
+#if IN_LIBGCOV
+  /* Edge indices grouped by callee.  Only built for dumping.  */
+  unsigned *caller_edges;
+#endif
+
+  /* Number and total count of the edges dropped by pruning.  */
+  unsigned num_pruned_edges;
+  gcov_type pruned_count;
+
+  unsigned num_modules;
+  unsigned num_nodes_executed;
+};
+
+struct dyn_pointer_set
+{
+  size_t log_slots;
+  size_t n_slots;		/* n_slots = 2^log_slots */
+  size_t n_elements;
+
+  void **slots;
+  unsigned (*get_key) (const void *);
+};
+
+static struct dyn_cgraph the_dyn_call_graph;
+static int total_zero_count = 0;
+static int total_insane_count = 0;
+
+/* Return (module_id - 1). FUNC_GUID is the global unique id.  */
+
+static inline gcov_unsigned_t
+get_module_idx_from_func_glob_uid (gcov_type func_guid)
+{
+  return EXTRACT_MODULE_ID_FROM_GLOBAL_ID (func_guid) - 1;
+}
+
+/* Return intra-module function id given function global unique id
+   FUNC_GUID.  */
+
+static inline gcov_unsigned_t
+get_intra_module_func_id (gcov_type func_guid)
+{
+  return EXTRACT_FUNC_ID_FROM_GLOBAL_ID (func_guid);
+}
+
+/* Return the pointer to the dynamic call graph node for FUNC_GUID.  */
+
+static inline struct dyn_cgraph_node *
+get_cgraph_node (gcov_type func_guid)
+{
+  gcov_unsigned_t mod_id, func_id;
+  struct dyn_cgraph_node *node;
+
+  mod_id = get_module_idx_from_func_glob_uid (func_guid);
+
+  /* This is to workaround: calls in __static_initialization_and_destruction
+     should not be instrumented as the module id context for the callees have
+     not setup yet -- this leads to mod_id == (unsigned) (0 - 1). Multithreaded
+     programs may also produce insane func_guid in the profile counter.  */
+  if (mod_id >= the_dyn_call_graph.num_modules)
+    return 0;
+
+  func_id = get_intra_module_func_id (func_guid);
+  if (func_id > the_dyn_call_graph.sup_modules[mod_id].max_func_ident)
+    return 0;
+
+  node = &the_dyn_call_graph.nodes[the_dyn_call_graph.sup_modules[mod_id].node_base
+				   + func_id];
+  return node->guid ? node : 0;
+}
+
+/* Return the number of functions of the module with index MOD_ID.  */
+
+static inline unsigned
+get_module_num_functions (gcov_unsigned_t mod_id)
+{
+#if IN_LIBGCOV
+  return the_dyn_call_graph.modules[mod_id]->n_functions;
+#else
+  const struct merge_object *obj = the_dyn_call_graph.sup_modules[mod_id].obj;
+
+  return obj ? obj->n_functions : 0;
+#endif
+}
+
+/* Return the dynamic call graph node for function F_IX of the module
+   with index MOD_ID.  */
+
+static inline struct dyn_cgraph_node *
+get_module_fn_cgraph_node (gcov_unsigned_t mod_id, unsigned f_ix)
+{
+  gcov_unsigned_t ident;
+
+#if IN_LIBGCOV
+  ident = the_dyn_call_graph.functions[mod_id][f_ix]->ident;
+#else
+  ident = the_dyn_call_graph.sup_modules[mod_id].obj->functions[f_ix].ident;
+#endif
+  return &the_dyn_call_graph.nodes[the_dyn_call_graph.sup_modules[mod_id].node_base
+				   + ident];
+}
+
+/* Return the caller node of EDGE.  */
+
+static inline struct dyn_cgraph_node *
+get_edge_caller (const struct dyn_cgraph_edge *edge)
+{
+  return &the_dyn_call_graph.nodes[edge->caller];
+}
+
+/* Return the callee node of EDGE.  */
+
+static inline struct dyn_cgraph_node *
+get_edge_callee (const struct dyn_cgraph_edge *edge)
+{
+  return &the_dyn_call_graph.nodes[edge->callee];
+}
+
+/* Return the index of the module imported by M.  */
+
+static inline gcov_unsigned_t
+get_imp_mod_idx (const struct dyn_imp_mod *m)
+{
+#if IN_LIBGCOV
+  return m->imp_mod->mod_info->ident - 1;
+#else
+  return m->mod_id;
+#endif
+}
+
+/* Add a call graph edge between caller CALLER and callee CALLEE.
+   The edge count is COUNT.  The edges of a caller must be added
+   together, as they are stored next to each other.  */
+
+static void
+gcov_add_cgraph_edge (struct dyn_cgraph_node *caller,
+		      struct dyn_cgraph_node *callee,
+		      gcov_type count)
+{
+  struct dyn_cgraph_edge *new_edge;
+
+  if (the_dyn_call_graph.num_edges == the_dyn_call_graph.alloc_edges)
+    {
+      the_dyn_call_graph.alloc_edges
+        = the_dyn_call_graph.alloc_edges * 2 + 1024;
+      the_dyn_call_graph.edges
+        = XRESIZEVEC (struct dyn_cgraph_edge, the_dyn_call_graph.edges,
+                      the_dyn_call_graph.alloc_edges);
+    }
+
+  new_edge = &the_dyn_call_graph.edges[the_dyn_call_graph.num_edges++];
+  new_edge->caller = caller - the_dyn_call_graph.nodes;
+  new_edge->callee = callee - the_dyn_call_graph.nodes;
+  new_edge->count = count;
+
+  caller->n_callees++;
+  callee->sum_in_count += count;
+}
+
+/* Add call graph edges from direct calls for caller CALLER. DIR_CALL_COUNTERS
+   is the array of call counters. N_COUNTS is the number of counters.  */
+
+static void
+gcov_build_callgraph_dc_fn (struct dyn_cgraph_node *caller,
+                            const gcov_type *dir_call_counters,
+                            unsigned n_counts)
+{
+  unsigned i;
+
+  for (i = 0; i < n_counts; i += 2)
+    {
+      struct dyn_cgraph_node *callee;
+      gcov_type count;
+      gcov_type callee_guid = dir_call_counters[i];
+
+      count = dir_call_counters[i + 1];
+      if (count == 0)
+        {
+          total_zero_count++;
+          continue;
+        }
+      callee = get_cgraph_node (callee_guid);
+      if (!callee)
+        {
+          total_insane_count++;
+          continue;
+        }
+      gcov_add_cgraph_edge (caller, callee, count);
+    }
+}
+
+/* Add call graph edges from indirect calls for caller CALLER. ICALL_COUNTERS
+   is the array of icall counters. N_COUNTS is the number of counters.  */
+
+static void
+gcov_build_callgraph_ic_fn (struct dyn_cgraph_node *caller,
+                            const gcov_type *icall_counters,
+                            unsigned n_counts)
+{
+  unsigned i, j;
+
+  for (i = 0; i < n_counts; i += GCOV_ICALL_TOPN_NCOUNTS)
+    {
+      const gcov_type *value_array = &icall_counters[i + 1];
+      for (j = 0; j < GCOV_ICALL_TOPN_NCOUNTS - 1; j += 2)
+        {
+          struct dyn_cgraph_node *callee;
+          gcov_type count;
+          gcov_type callee_guid = value_array[j];
+
+          count = value_array[j + 1];
+	  /* Do not update zero count edge count
+	   * as it means there is no target in this entry.  */
+          if (count == 0)
+            continue;
+          callee = get_cgraph_node (callee_guid);
+          if (!callee)
+	    {
+              total_insane_count++;
+              continue;
+	    }
+          gcov_add_cgraph_edge (caller, callee, count);
+        }
+    }
+}
+
+/* Comparator for sorting edges in descending order of counts.  */
+
+static int
+sort_edges_by_count (const void *pa, const void *pb)
+{
+  const struct dyn_cgraph_edge *edge_a = (const struct dyn_cgraph_edge *) pa;
+  const struct dyn_cgraph_edge *edge_b = (const struct dyn_cgraph_edge *) pb;
+
+  if (edge_b->count > edge_a->count)
+    return 1;
+  else if (edge_b->count == edge_a->count)
+    return 0;
+  else
+    return -1;
+}
+
+/* Keep only the MAX_EDGES hottest out edges of CALLER, whose edges
+   must be the last ones added.  The counts of the dropped edges stay
+   in the SUM_IN_COUNT of their callees and are added to PRUNED_COUNT,
+   so scaling factors and the cutoff still reflect the whole
+   profile.  */
+
+static void
+gcov_prune_callees (struct dyn_cgraph_node *caller, unsigned max_edges)
+{
+  struct dyn_cgraph_edge *callees;
+  unsigned i;
+
+  if (max_edges == 0 || caller->n_callees <= max_edges)
+    return;
+
+  callees = &the_dyn_call_graph.edges[caller->first_callee];
+  qsort (callees, caller->n_callees, sizeof (struct dyn_cgraph_edge),
+         sort_edges_by_count);
+  for (i = max_edges; i < caller->n_callees; i++)
+    the_dyn_call_graph.pruned_count += callees[i].count;
+  the_dyn_call_graph.num_pruned_edges += caller->n_callees - max_edges;
+
+  caller->n_callees = max_edges;
+  the_dyn_call_graph.num_edges = caller->first_callee + max_edges;
+}
+
+/* Return the number of out edges kept for each function, zero for all
+   of them.  Edges are pruned as each function is read, so the edge
+   array never holds more than this many edges per function.  */
+
+#define DEFAULT_MAX_OUT_EDGES 64
+static unsigned
+gcov_get_max_out_edges (void)
+{
+  const char *max_edges_str = getenv ("GCOV_DYN_CGRAPH_MAX_EDGES");
+
+  if (max_edges_str && strlen (max_edges_str))
+    return atoi (max_edges_str);
+  return DEFAULT_MAX_OUT_EDGES;
+}
+
+static inline size_t
+hash1 (unsigned p, unsigned long max, unsigned long logmax)
+{
+  const unsigned long long A = 0x9e3779b97f4a7c16ull;
+  const unsigned long long shift = 64 - logmax;
+
+  return ((A * (unsigned long) p) >> shift) & (max - 1);
+}
+
+/* Allocate an empty imported-modules set.  */
+
+static struct dyn_pointer_set *
+pointer_set_create (unsigned (*get_key) (const void *))
+{
+  struct dyn_pointer_set *result = XNEW (struct dyn_pointer_set);
+
+  result->n_elements = 0;
+  result->log_slots = 8;
+  result->n_slots = (size_t) 1 << result->log_slots;
+
+  result->slots = XNEWVEC (void *, result->n_slots);
+  memset (result->slots, 0, sizeof (void *) * result->n_slots);
+  result->get_key = get_key;
+
+  return result;
+}
+
+/* Reclaim all memory associated with PSET.  */
+
+static void
+pointer_set_destroy (struct dyn_pointer_set *pset)
+{
+  size_t i;
+  for (i = 0; i < pset->n_slots; i++)
+    if (pset->slots[i])
+      XDELETE (pset->slots[i]);
+  XDELETEVEC (pset->slots);
+  XDELETE (pset);
+}
+
+/* Subroutine of pointer_set_find_or_insert.  Return the insertion slot for KEY
+   into an empty element of SLOTS, an array of length N_SLOTS.  */
+static inline size_t
+insert_aux (unsigned key, void **slots,
+	    size_t n_slots, size_t log_slots,
+	    unsigned (*get_key) (const void *))
+{
+  size_t n = hash1 (key, n_slots, log_slots);
+  while (1)
+    {
+      if (slots[n] == 0 || get_key (slots[n]) == key)
+	return n;
+      else
+	{
+	  ++n;
+	  if (n == n_slots)
+	    n = 0;
+	}
+    }
+}
+
+/* Find slot for KEY. KEY must be nonnull.  */
+
+static void **
+pointer_set_find_or_insert (struct dyn_pointer_set *pset, unsigned key)
+{
+  size_t n;
+
+  /* For simplicity, expand the set even if KEY is already there.  This can be
+     superfluous but can happen at most once.  */
+  if (pset->n_elements > pset->n_slots / 4)
+    {
+      size_t new_log_slots = pset->log_slots + 1;
+      size_t new_n_slots = pset->n_slots * 2;
+      void **new_slots = XNEWVEC (void *, new_n_slots);
+      memset (new_slots, 0, sizeof (void *) * new_n_slots);
+      size_t i;
+
+      for (i = 0; i < pset->n_slots; ++i)
+        {
+	  void *value = pset->slots[i];
+	  if (!value)
+	    continue;
+	  n = insert_aux (pset->get_key (value), new_slots, new_n_slots,
+			  new_log_slots, pset->get_key);
+	  new_slots[n] = value;
+	}
+
+      XDELETEVEC (pset->slots);
+      pset->n_slots = new_n_slots;
+      pset->log_slots = new_log_slots;
+      pset->slots = new_slots;
+    }
+
+  n = insert_aux (key, pset->slots, pset->n_slots, pset->log_slots,
+		  pset->get_key);
+  return &pset->slots[n];
+}
+
+/* Pass each pointer in PSET to the function in FN, together with the fixed
+   parameters DATA1, DATA2, DATA3.  If FN returns false, the iteration stops.  */
+
+static void
+pointer_set_traverse (const struct dyn_pointer_set *pset,
+                      int (*fn) (const void *, void *, void *, void *),
+		      void *data1, void *data2, void *data3)
+{
+  size_t i;
+  for (i = 0; i < pset->n_slots; ++i)
+    if (pset->slots[i] && !fn (pset->slots[i], data1, data2, data3))
+      break;
+}
+
+/* Add WT to the weight of the module with index MOD_ID in the imported
+   module set P.  Return 1 if the module was already in the set.  */
+
+static int
+imp_mod_set_insert (struct dyn_pointer_set *p, gcov_unsigned_t mod_id,
+		    double wt)
+{
+  struct dyn_imp_mod **m = (struct dyn_imp_mod **)
+    pointer_set_find_or_insert (p, mod_id + 1);
+  if (*m)
+    {
+      (*m)->weight += wt;
+      return 1;
+    }
+  else
+    {
+      *m = XNEW (struct dyn_imp_mod);
+#if IN_LIBGCOV
+      (*m)->imp_mod = the_dyn_call_graph.modules[mod_id];
+#else
+      (*m)->mod_id = mod_id;
+#endif
+      (*m)->weight = wt;
+      p->n_elements++;
+      return 0;
+    }
+}
+
+/* Callback function to propagate import module (VALUE) from callee to
+   caller's imported-module-set (DATA1).
+   The weight is scaled by the scaling-factor (DATA2) before propagation,
+   and accumulated into DATA3.  */
+static int
+gcov_propagate_imp_modules (const void *value, void *data1, void *data2,
+			    void *data3)
+{
+  const struct dyn_imp_mod *m = (const struct dyn_imp_mod *) value;
+  struct dyn_pointer_set *receiving_set = (struct dyn_pointer_set *) data1;
+  double *scale = (double *) data2;
+  double *sum = (double *) data3;
+  double wt = m->weight;
+  if (scale)
+    wt *= *scale;
+  if (sum)
+    (*sum) += wt;
+  imp_mod_set_insert (receiving_set, get_imp_mod_idx (m), wt);
+  return 1;
+}
+
+static int
+sort_by_count (const void *pa, const void *pb)
+{
+  return sort_edges_by_count (&the_dyn_call_graph.edges[*(const unsigned *) pa],
+                              &the_dyn_call_graph.edges[*(const unsigned *) pb]);
+}
+
+/* Compute the hot callgraph edge threhold.  */
+
+static gcov_type
+gcov_compute_cutoff_count (void)
+{
+  unsigned i;
+  unsigned num_edges = the_dyn_call_graph.num_edges;
+  gcov_type cutoff_count = 1;
+  double total, cum, cum_cutoff;
+  unsigned *edges;
+  char *cutoff_str;
+  char *num_perc_str;
+  unsigned cutoff_perc;
+  unsigned num_perc;
+  int do_dump;
+
+  /* Sort the edge indices, the edges themselves are kept in caller
+     order.  */
+  edges = XNEWVEC (unsigned, num_edges);
+  for (i = 0; i < num_edges; i++)
+    edges[i] = i;
+ qsort (edges, num_edges, sizeof (unsigned), sort_by_count);
+#define CUM_CUTOFF_PERCENT 80
+#define MIN_NUM_EDGE_PERCENT 0
+  cutoff_str = getenv ("GCOV_DYN_CGRAPH_CUTOFF");
+  if (cutoff_str && strlen (cutoff_str))
+    {
+      if ((num_perc_str = strchr (cutoff_str, ':')))
+        {
+          *num_perc_str = '\0';
+          num_perc_str++;
+        }
+      cutoff_perc = atoi (cutoff_str);
+      if (num_perc_str)
+        num_perc = atoi (num_perc_str);
+      else
+        num_perc = MIN_NUM_EDGE_PERCENT;
+    }
+  else
+    {
+      cutoff_perc = CUM_CUTOFF_PERCENT;
+      num_perc = MIN_NUM_EDGE_PERCENT;
+    }
+
+  /* Pruned edges count towards the total, so if they hold more than
+     the cold part of the profile all the kept edges are hot.  */
+  total = the_dyn_call_graph.pruned_count;
+  cum = 0;
+  for (i = 0; i < num_edges; i++)
+    total += the_dyn_call_graph.edges[edges[i]].count;
+
+  cum_cutoff = (total * cutoff_perc)/100;
+  do_dump = (getenv ("GCOV_DYN_CGRAPH_DUMP") != 0);
+  for (i = 0; i < num_edges; i++)
+    {
+      const struct dyn_cgraph_edge *edge = &the_dyn_call_graph.edges[edges[i]];
+
+      cum += edge->count;
+      if (do_dump)
+        fprintf (stderr, "// edge[%d] count = %.0f [%llx --> %llx]\n",
+                 i, (double) edge->count,
+                 (long long) get_edge_caller (edge)->guid,
+                 (long long) get_edge_callee (edge)->guid);
+      if (cum >= cum_cutoff && (i * 100 >= num_edges * num_perc))
+        {
+          cutoff_count = edge->count;
+          break;
+        }
+    }
+
+  if (do_dump)
+    fprintf (stderr, "// total = %.0f cum = %.0f cum/total = %.0f%%"
+             " cutoff_count = %lld [total edges: %d hot edges: %d perc: %d%%]\n"
+	     " total_zero_count_edges = %d total_insane_count_edgess = %d\n"
+	     " total_pruned_edges = %d pruned_count = %.0f\n"
+             " total_nodes_executed = %d\n",
+             total, cum, (cum * 100)/total, (long long) cutoff_count,
+             num_edges, i, (i * 100)/num_edges, total_zero_count,
+             total_insane_count, the_dyn_call_graph.num_pruned_edges,
+             (double) the_dyn_call_graph.pruned_count,
+             the_dyn_call_graph.num_nodes_executed);
+
+  XDELETEVEC (edges);
+  return cutoff_count;
+}
+
+static inline unsigned
+imp_mod_get_key (const void *p)
+{
+  return get_imp_mod_idx ((const struct dyn_imp_mod *) p) + 1;
+}
+
+/* Return the imported module set for NODE.  */
+
+static struct dyn_pointer_set *
+gcov_get_imp_module_set (struct dyn_cgraph_node *node)
+{
+  if (!node->imported_modules)
+    node->imported_modules = pointer_set_create (imp_mod_get_key);
+
+  return node->imported_modules;
+}
+
+/* Return the imported module set for MODULE MI.  */
+
+static struct dyn_pointer_set *
+gcov_get_module_imp_module_set (struct dyn_module_info *mi)
+{
+  if (!mi->imported_modules)
+    mi->imported_modules = pointer_set_create (imp_mod_get_key);
+
+  return mi->imported_modules;
+}
+
+/* Callback function to mark if a module needs to be exported.  */
+
+static int
+gcov_mark_export_modules (const void *value,
+			  void *data1 ATTRIBUTE_UNUSED,
+			  void *data2 ATTRIBUTE_UNUSED,
+			  void *data3 ATTRIBUTE_UNUSED)
+{
+  const struct dyn_imp_mod *m = (const struct dyn_imp_mod *) value;
+
+#if IN_LIBGCOV
+  m->imp_mod->mod_info->is_exported = 1;
+#else
+  the_dyn_call_graph.sup_modules[m->mod_id].is_exported = 1;
+#endif
+  return 1;
+}
+
+/* Compute the export attribute of the modules from the imported
+   modules of each module.  */
+
+static void
+gcov_compute_export_modules (void)
+{
+  unsigned m_ix;
+
+  for (m_ix = 0; m_ix < the_dyn_call_graph.num_modules; m_ix++)
+    {
+      struct dyn_module_info *mi
+          = &the_dyn_call_graph.sup_modules[m_ix];
+      if (mi->imported_modules)
+        pointer_set_traverse (mi->imported_modules,
+                              gcov_mark_export_modules, 0, 0, 0);
+    }
+}
+
+struct gcov_import_mod_array
+{
+  const struct dyn_imp_mod **imported_modules;
+  gcov_unsigned_t importing_mod_id;
+  unsigned len;
+};
+
+/* Callback function to compute pointer set size.  */
+
+static int
+gcov_compute_mset_size (const void *value ATTRIBUTE_UNUSED,
+                        void *data1,
+			void *data2 ATTRIBUTE_UNUSED,
+			void *data3 ATTRIBUTE_UNUSED)
+{
+  unsigned *len = (unsigned *) data1;
+  (*len)++;
+  return 1;
+}
+
+/* Callback function to collect imported modules.  */
+
+static int
+gcov_collect_imported_modules (const void *value,
+			       void *data1,
+			       void *data2 ATTRIBUTE_UNUSED,
+			       void *data3 ATTRIBUTE_UNUSED)
+{
+  struct gcov_import_mod_array *out_array;
+  const struct dyn_imp_mod *m
+    = (const struct dyn_imp_mod *) value;
+
+  out_array = (struct gcov_import_mod_array *) data1;
+
+  if (get_imp_mod_idx (m) != out_array->importing_mod_id)
+    out_array->imported_modules[out_array->len++] = m;
+
+  return 1;
+}
+
+/* Comparator for sorting imported modules using weights.  */
+
+static int
+sort_by_module_wt (const void *pa, const void *pb)
+{
+  const struct dyn_imp_mod *m_a = *((const struct dyn_imp_mod * const *) pa);
+  const struct dyn_imp_mod *m_b = *((const struct dyn_imp_mod * const *) pb);
+
+  /* We want to sort in descending order of weights.  */
+  if (m_a->weight < m_b->weight)
+    return +1;
+  if (m_a->weight > m_b->weight)
+    return -1;
+  return get_imp_mod_idx (m_a) - get_imp_mod_idx (m_b);
+}
+
+/* Return a dynamic array of the modules imported by the module with
+   index MOD_ID, sorted for writing out, or 0 if there are none.  The
+   length of the array is returned in *LEN.  */
+
+static const struct dyn_imp_mod **
+gcov_get_sorted_imported_modules (gcov_unsigned_t mod_id, unsigned *len)
+{
+  struct dyn_module_info *sup_mod_info;
+  unsigned array_len = 0;
+  struct gcov_import_mod_array imp_array;
+
+  sup_mod_info = &the_dyn_call_graph.sup_modules[mod_id];
+
+  if (sup_mod_info->imported_modules == 0)
+    return 0;
+
+  pointer_set_traverse (sup_mod_info->imported_modules,
+                        gcov_compute_mset_size, &array_len, 0, 0);
+  imp_array.imported_modules = XNEWVEC (const struct dyn_imp_mod *, array_len);
+  imp_array.len = 0;
+  imp_array.importing_mod_id = mod_id;
+  pointer_set_traverse (sup_mod_info->imported_modules,
+                        gcov_collect_imported_modules, &imp_array, 0, 0);
+  *len = imp_array.len;
+  qsort (imp_array.imported_modules, imp_array.len,
+         sizeof (void *), sort_by_module_wt);
+  return imp_array.imported_modules;
+}
+
+/* Compute modules that are needed for NODE (for cross module inlining).
+   CUTTOFF_COUNT is the call graph edge count cutoff value.
+   IMPORT_SCALE is the scaling-factor (percent) by which to scale the
+   weights of imported modules of a callee before propagating them to
+   the caller, if the callee and caller are in different modules.
+
+   Each imported module is assigned a weight that corresponds to the
+   expected benefit due to cross-module inlining. When the imported modules
+   are written out, they are sorted with highest weight first.
+
+   The following example illustrates how the weight is computed:
+
+   Suppose we are processing call-graph node A. It calls function B 50 times,
+   which calls function C 1000 times, and function E 800 times. Lets say B has
+   another in-edge from function D, with edge-count of 50. Say all the
+   functions are in separate modules (modules a, b, c, d, e, respectively):
+
+              D
+              |
+              | 50
+              |
+       50     v     1000
+  A --------> B ----------> C
+              |
+              | 800
+              |
+              v
+              E
+
+  Nodes are processed in depth-first order, so when processing A, we first
+  process B. For node B, we are going to add module c to the imported-module
+  set, with weight 1000 (edge-count), and module e with weight 800.
+  Coming back to A, we are going to add the imported-module-set of B to A,
+  after doing some scaling.
+  The first scaling factor comes from the fact that A calls B 50 times, but B
+  has in-edge-count total of 100. So this scaling factor is 50/100 = 0.5
+  The second scaling factor is that since B is in a different module than A,
+  we want to slightly downgrade imported modules of B, before adding to the
+  imported-modules set of A. This scaling factor has a default value of 50%
+  (can be set via env variable GCOV_DYN_IMPORT_SCALE).
+  So we end up adding modules c and e to the imported-set of A, with weights
+  0.5*0.5*1000=250 and 0.5*0.5*800=200, respectively.
+
+  Next, we have to add module b itself to A. The weight is computed as the
+  edge-count plus the sum of scaled-weights of all modules in the
+  imported-module set of B, i.e., 50 + 250 + 200 = 500.
+
+  In computing the weight of module b, we add the sum of scaled-weights of
+  imported modules of b, because it doesn't make sense to import c, e in
+  module a, until module b is imported.  */
+
+static void
+gcov_process_cgraph_node (struct dyn_cgraph_node *node,
+                          gcov_type cutoff_count,
+			  unsigned import_scale)
+{
+  unsigned mod_id, i;
+  struct dyn_cgraph_edge *callees;
+  node->visited = 1;
+
+  /* SUM_IN_COUNT was accumulated when the edges were added.  */
+  callees = &the_dyn_call_graph.edges[node->first_callee];
+  mod_id = get_module_idx_from_func_glob_uid (node->guid);
+
+  /* Callees are visited from the last call site to the first.  In a
+     cycle the visiting order decides which node is completed first,
+     and with it the import weights.  */
+  for (i = node->n_callees; i-- > 0; )
+    {
+      struct dyn_cgraph_node *callee = get_edge_callee (&callees[i]);
+
+      if (!callee->visited)
+        gcov_process_cgraph_node (callee,
+                                  cutoff_count,
+				  import_scale);
+    }
+
+  for (i = node->n_callees; i-- > 0; )
+    {
+      struct dyn_cgraph_node *callee = get_edge_callee (&callees[i]);
+      gcov_type count = callees[i].count;
+
+      if (count >= cutoff_count)
+        {
+          unsigned callee_mod_id;
+          struct dyn_pointer_set *imp_modules
+              = gcov_get_imp_module_set (node);
+
+          callee_mod_id
+              = get_module_idx_from_func_glob_uid (callee->guid);
+
+	  double callee_mod_wt = (double) count;
+          if (callee->imported_modules)
+	    {
+	      double scale = ((double) count) /
+		((double) callee->sum_in_count);
+	      /* Reduce weight if callee is in different module.  */
+	      if (mod_id != callee_mod_id)
+		scale = (scale * import_scale) / 100.0;
+	      pointer_set_traverse (callee->imported_modules,
+				    gcov_propagate_imp_modules,
+				    imp_modules, &scale, &callee_mod_wt);
+	    }
+          if (mod_id != callee_mod_id)
+            imp_mod_set_insert (imp_modules, callee_mod_id, callee_mod_wt);
+        }
+    }
+}
+
+/* Compute module grouping using CUTOFF_COUNT as the hot edge
+   threshold.  */
+
+#define DEFAULT_IMPORT_SCALE 100
+static void
+gcov_compute_module_groups (gcov_type cutoff_count)
+{
+  unsigned m_ix;
+  const char *import_scale_str;
+  unsigned import_scale = DEFAULT_IMPORT_SCALE;
+
+  import_scale_str = getenv ("GCOV_DYN_IMPORT_SCALE");
+  if (import_scale_str && strlen (import_scale_str))
+    import_scale = atoi (import_scale_str);
+
+  for (m_ix = 0; m_ix < the_dyn_call_graph.num_modules; m_ix++)
+    {
+      unsigned f_ix, n_functions = get_module_num_functions (m_ix);
+
+      for (f_ix = 0; f_ix < n_functions; f_ix++)
+	{
+	  struct dyn_cgraph_node *node;
+
+	  node = get_module_fn_cgraph_node (m_ix, f_ix);
+          if (node->visited)
+            continue;
+
+          gcov_process_cgraph_node (node, cutoff_count, import_scale);
+	}
+    }
+
+  for (m_ix = 0; m_ix < the_dyn_call_graph.num_modules; m_ix++)
+    {
+      unsigned f_ix, n_functions = get_module_num_functions (m_ix);
+
+      for (f_ix = 0; f_ix < n_functions; f_ix++)
+	{
+	  struct dyn_cgraph_node *node;
+          unsigned mod_id;
+          struct dyn_pointer_set *imp_modules;
+
+	  node = get_module_fn_cgraph_node (m_ix, f_ix);
+
+          if (!node->imported_modules)
+            continue;
+
+          mod_id = get_module_idx_from_func_glob_uid (node->guid);
+          gcc_assert (mod_id == m_ix);
+
+          imp_modules
+              = gcov_get_module_imp_module_set (
+                  &the_dyn_call_graph.sup_modules[mod_id]);
+
+          pointer_set_traverse (node->imported_modules,
+                                gcov_propagate_imp_modules,
+                                imp_modules, 0, 0);
+	}
+    }
+
+  /* Now compute the export attribute  */
+  gcov_compute_export_modules ();
+}
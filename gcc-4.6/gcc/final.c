@@ -4331,18 +4331,24 @@ debug_free_queue (void)
     }
 }
 
-/* List the call graph profiled edges whise value is greater than
+/* List the call graph profiled edges of NODE whose value is greater than
    PARAM_NOTE_CGRAPH_SECTION_EDGE_THRESHOLD in the
-   "gnu.callgraph.text" section. */
+   "gnu.callgraph.text" section.  The calls made by the bodies inlined
+   into NODE are listed as calls of NODE, as that is where they are
+   made from.  */
 static void
-dump_cgraph_profiles (void)
+dump_cgraph_profiles (struct cgraph_node *node)
 {
-  struct cgraph_node *node = cgraph_node (current_function_decl);
   struct cgraph_edge *e;
   struct cgraph_node *callee;
 
   for (e = node->callees; e != NULL; e = e->next_callee)
     {
+      if (!e->inline_failed)
+        {
+          dump_cgraph_profiles (e->callee);
+          continue;
+        }
       if (e->count <= PARAM_VALUE (PARAM_NOTE_CGRAPH_SECTION_EDGE_THRESHOLD))
         continue;
       callee = e->callee;
@@ -4432,7 +4438,7 @@ rest_of_handle_final (void)
       asprintf (&profile_fnname, ".gnu.callgraph.text.%s", fnname);
       switch_to_section (get_section (profile_fnname, flags, NULL));
       fprintf (asm_out_file, "\t.string \"Function %s\"\n", fnname);
-      dump_cgraph_profiles ();
+      dump_cgraph_profiles (cgraph_node (current_function_decl));
       free (profile_fnname);
     }
 
@@ -129,6 +129,13 @@ enum excess_precision
   EXCESS_PRECISION_STANDARD
 };
 
+/* The method of updating profile counters.  */
+enum profile_update
+{
+  PROFILE_UPDATE_SINGLE,
+  PROFILE_UPDATE_ATOMIC
+};
+
 /* Selection of the graph form.  */
 enum graph_dump_types
 {
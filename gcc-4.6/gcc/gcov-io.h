@@ -151,6 +151,17 @@ see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
    Note that the data file might contain information from several runs
    concatenated, or the data might be merged.
 
+   When GCOV_SPOOL_DIR is set in the environment, an instrumented
+   program does not merge into the data files at exit.  Instead it
+   writes a single spool file holding the data of every object file
+   in the program, which gcov-merge later folds into the data files.
+	spool: int32:magic int32:version {object data}* int32:0
+	object: header string:da_filename
+   The DATA is exactly the contents of a data file written for a single
+   run, without the trailing zero.  The data of a LIPO object is followed
+   by the module info record of the object itself, from which gcov-merge
+   -l computes the module groups.
+
    This file is included by both the compiler, gcov tools and the
    runtime support library libgcov. IN_LIBGCOV and IN_GCOV are used to
    distinguish which case is which.  If IN_LIBGCOV is nonzero,
@@ -326,7 +337,7 @@ typedef HOST_WIDEST_INT gcov_type;
 #define FUNC_ID_MASK ((1L << FUNC_ID_WIDTH) - 1)
 #define EXTRACT_MODULE_ID_FROM_GLOBAL_ID(gid) (unsigned)(((gid) >> FUNC_ID_WIDTH) & FUNC_ID_MASK)
 #define EXTRACT_FUNC_ID_FROM_GLOBAL_ID(gid) (unsigned)((gid) & FUNC_ID_MASK)
-#define FUNC_GLOBAL_ID(m,f) ((((HOST_WIDE_INT) (m)) << FUNC_ID_WIDTH) | (f)
+#define GEN_FUNC_GLOBAL_ID(m,f) ((((gcov_type) (m)) << FUNC_ID_WIDTH) | (f))
 
 #else /*!IN_GCOV */
 #define GCOV_TYPE_SIZE (LONG_LONG_TYPE_SIZE > 32 ? 64 : 32)
@@ -402,10 +413,12 @@ typedef HOST_WIDEST_INT gcov_type;
 /* File suffixes.  */
 #define GCOV_DATA_SUFFIX ".gcda"
 #define GCOV_NOTE_SUFFIX ".gcno"
+#define GCOV_SPOOL_SUFFIX ".gcspool"
 
 /* File magic. Must not be palindromes.  */
 #define GCOV_DATA_MAGIC ((gcov_unsigned_t)0x67636461) /* "gcda" */
 #define GCOV_NOTE_MAGIC ((gcov_unsigned_t)0x67636e6f) /* "gcno" */
+#define GCOV_SPOOL_MAGIC ((gcov_unsigned_t)0x67637370) /* "gcsp" */
 
 /* gcov-iov.h is automatically generated by the makefile from
    version.c, it looks like
@@ -449,6 +462,7 @@ typedef HOST_WIDEST_INT gcov_type;
 #define GCOV_TAG_PMU_BRANCH_MISPREDICT_LENGTH(filename)  \
   (gcov_string_length (filename) + 5 + 2)
 #define GCOV_TAG_PMU_TOOL_HEADER ((gcov_unsigned_t)0xa9000000)
+#define GCOV_TAG_SPOOL_OBJECT ((gcov_unsigned_t)0xab000000)
 
 /* Counters that are collected.  */
 #define GCOV_COUNTER_ARCS 	0  /* Arc transitions.  */
@@ -773,6 +787,23 @@ extern void __gcov_indirect_call_topn_profiler (void *, void *, gcov_unsigned_t)
 extern void __gcov_direct_call_profiler (void *, void *, gcov_unsigned_t) ATTRIBUTE_HIDDEN;
 extern void __gcov_average_profiler (gcov_type *, gcov_type);
 extern void __gcov_ior_profiler (gcov_type *, gcov_type);
+
+/* Thread-safe variants of the profiler functions, used with
+   -fprofile-update=atomic.  */
+extern void __gcov_interval_profiler_atomic (gcov_type *, gcov_type, int,
+					     unsigned);
+extern void __gcov_pow2_profiler_atomic (gcov_type *, gcov_type);
+extern void __gcov_one_value_profiler_atomic (gcov_type *, gcov_type);
+extern void __gcov_indirect_call_profiler_atomic (gcov_type *, gcov_type,
+						  void *, void *);
+extern void __gcov_indirect_call_topn_profiler_atomic (void *, void *,
+						       gcov_unsigned_t)
+  ATTRIBUTE_HIDDEN;
+extern void __gcov_direct_call_profiler_atomic (void *, void *,
+						gcov_unsigned_t)
+  ATTRIBUTE_HIDDEN;
+extern void __gcov_average_profiler_atomic (gcov_type *, gcov_type);
+extern void __gcov_ior_profiler_atomic (gcov_type *, gcov_type);
 extern void __gcov_sort_n_vals (gcov_type *value_array, int n);
 
 /* Initialize/start/stop/dump performance monitoring unit (PMU) profile */
@@ -0,0 +1,1454 @@
+/* Merge gcov spool files into gcda files.
+   Copyright (C) 2011 Free Software Foundation, Inc.
+
+Gcov is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Gcov is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Gcov; see the file COPYING3.  If not see
+<http://www.gnu.org/licenses/>.  */
+
+/* A program run with GCOV_SPOOL_DIR set writes all its counters to a
+   private spool file at exit, rather than merging them into each gcda
+   file under a lock.  This tool folds any number of spool files into
+   the gcda files they name, with the __gcov_merge_* routines of
+   libgcov.
+
+   The spool files are split into JOBS slices that are merged in
+   parallel by worker processes, each producing one partial spool
+   file.  The partial results are then combined and the gcda files are
+   updated, again split across the workers.  Every input is read once
+   and memory use is bounded by the size of the profile, not by the
+   number of dumps.  Workers are processes rather than threads as the
+   gcov-io reader keeps its state in the global gcov_var.
+
+   With -l, the LIPO module groups are then computed from the merged
+   gcda files, and any gcda files given, instead of at the exit of
+   each training run.  The grouping code is shared with libgcov in
+   dyn-ipa-cgraph.c.  */
+
+#include "config.h"
+#include "system.h"
+#include "coretypes.h"
+#include "tm.h"
+#include "version.h"
+#include "hashtab.h"
+#include <getopt.h>
+#define IN_GCOV (-1)
+#include "gcov-io.h"
+#include "gcov-io.c"
+
+/* The counter merge functions of libgcov.  */
+#define L_gcov_merge_add
+#define L_gcov_merge_ior
+#define L_gcov_merge_reusedist
+#define L_gcov_merge_dc
+#define L_gcov_merge_icall_topn
+#define L_gcov_merge_single
+#define L_gcov_merge_delta
+#include "libgcov-merge.c"
+
+/* Execution counts of one function.  */
+
+struct merge_function
+{
+  gcov_unsigned_t ident;
+  gcov_unsigned_t lineno_checksum;
+  gcov_unsigned_t cfg_checksum;
+
+  /* Number of counters of each type.  */
+  unsigned n_ctrs[GCOV_COUNTERS];
+};
+
+/* The profile of one object file, as read from a gcda file or from a
+   spool file.  */
+
+struct merge_object
+{
+  /* Name of the gcda file.  This is the hash table key.  */
+  char *da_filename;
+
+  gcov_unsigned_t stamp;
+
+  /* Mask of the counter types present.  */
+  unsigned ctr_mask;
+
+  unsigned n_functions;
+  unsigned alloc_functions;
+  struct merge_function *functions;
+
+  /* All counters in file order: by function, then by type.  */
+  unsigned n_values;
+  unsigned alloc_values;
+  gcov_type *values;
+
+  struct gcov_summary object;
+
+  /* Program summaries, one per program checksum.  */
+  unsigned n_programs;
+  struct gcov_summary *programs;
+
+  /* Module info records following the summaries, copied verbatim.  */
+  unsigned n_trailer;
+  gcov_unsigned_t *trailer;
+};
+
+/* A growable buffer of words to be written to a file.  */
+
+struct word_buffer
+{
+  gcov_unsigned_t *words;
+  size_t n_words;
+  size_t alloc;
+};
+
+static void merge_counters (unsigned, gcov_type *, const gcov_type *,
+			    unsigned);
+static int merge_objects (struct merge_object *, const struct merge_object *,
+			  const char *);
+static struct merge_object *read_object (const char *, gcov_unsigned_t *);
+static struct merge_object *read_gcda_file (const char *);
+static int merge_spool_file (htab_t, const char *);
+static int write_spool_file (htab_t, const char *);
+static int write_gcda_file (struct merge_object *);
+static int group_modules (char **, unsigned);
+static int run_workers (int (*) (unsigned, unsigned, void *), unsigned,
+			void *, int *);
+static void read_module_infos (struct word_buffer *, gcov_unsigned_t *);
+static void print_usage (void);
+static void print_version (void);
+
+extern int main (int, char **);
+
+static int flag_remove_inputs = 0;
+static int flag_lipo = 0;
+static unsigned n_jobs = 1;
+
+static const struct option options[] =
+{
+  { "help",                 no_argument,       NULL, 'h' },
+  { "version",              no_argument,       NULL, 'v' },
+  { "jobs",                 required_argument, NULL, 'j' },
+  { "remove",               no_argument,       NULL, 'r' },
+  { "lipo",                 no_argument,       NULL, 'l' },
+  { 0, 0, 0, 0 }
+};
+
+/* Hash table support for merge_object, keyed by the gcda name.  */
+
+static hashval_t
+merge_object_hash (const void *p)
+{
+  return htab_hash_string (((const struct merge_object *) p)->da_filename);
+}
+
+static int
+merge_object_eq (const void *p1, const void *p2)
+{
+  return !strcmp (((const struct merge_object *) p1)->da_filename,
+		  ((const struct merge_object *) p2)->da_filename);
+}
+
+static void
+merge_object_free (void *p)
+{
+  struct merge_object *obj = (struct merge_object *) p;
+
+  free (obj->da_filename);
+  free (obj->functions);
+  free (obj->values);
+  free (obj->programs);
+  free (obj->trailer);
+  free (obj);
+}
+
+static htab_t
+new_object_table (void)
+{
+  return htab_create (1021, merge_object_hash, merge_object_eq,
+		      merge_object_free);
+}
+
+/* Merge the N counters of type T_IX in SRC into DST, with the libgcov
+   merge function named for T_IX in GCOV_MERGE_FUNCTIONS.  DST plays
+   the part of the in-memory counters and SRC that of the counters
+   read from the file.  */
+
+static void
+merge_counters (unsigned t_ix, gcov_type *dst, const gcov_type *src,
+		unsigned n)
+{
+  gcov_merge_src = src;
+  switch (t_ix)
+    {
+    case GCOV_COUNTER_ARCS:
+    case GCOV_COUNTER_V_INTERVAL:
+    case GCOV_COUNTER_V_POW2:
+    case GCOV_COUNTER_AVERAGE:
+      __gcov_merge_add (dst, n);
+      break;
+
+    case GCOV_COUNTER_IOR:
+      __gcov_merge_ior (dst, n);
+      break;
+
+    case GCOV_COUNTER_V_SINGLE:
+    case GCOV_COUNTER_V_INDIR:
+      __gcov_merge_single (dst, n);
+      break;
+
+    case GCOV_COUNTER_V_DELTA:
+      __gcov_merge_delta (dst, n);
+      break;
+
+    case GCOV_COUNTER_ICALL_TOPNV:
+      __gcov_merge_icall_topn (dst, n);
+      break;
+
+    case GCOV_COUNTER_DIRECT_CALL:
+      __gcov_merge_dc (dst, n);
+      break;
+
+    case GCOV_COUNTER_REUSE_DIST:
+      __gcov_merge_reusedist (dst, n);
+      break;
+
+    default:
+      gcc_unreachable ();
+    }
+}
+
+/* Merge the summary SRC into DST, as libgcov merges the summary of the
+   current run into the one found in the gcda file.  Return nonzero on
+   a mismatch.  */
+
+static int
+merge_summary (struct gcov_summary *dst, const struct gcov_summary *src)
+{
+  unsigned t_ix;
+
+  for (t_ix = 0; t_ix < GCOV_COUNTERS_SUMMABLE; t_ix++)
+    {
+      struct gcov_ctr_summary *cs_dst = &dst->ctrs[t_ix];
+      const struct gcov_ctr_summary *cs_src = &src->ctrs[t_ix];
+
+      if (!cs_src->runs)
+	continue;
+      if (!cs_dst->runs)
+	cs_dst->num = cs_src->num;
+      else if (cs_dst->num != cs_src->num)
+	return 1;
+      cs_dst->runs += cs_src->runs;
+      cs_dst->sum_all += cs_src->sum_all;
+      if (cs_dst->run_max < cs_src->run_max)
+	cs_dst->run_max = cs_src->run_max;
+      cs_dst->sum_max += cs_src->sum_max;
+    }
+  return 0;
+}
+
+/* Merge the profile SRC into DST.  ORIGIN names the file SRC was read
+   from, for diagnostics.  Return nonzero if the two do not describe
+   the same compilation, in which case DST is left alone.  */
+
+static int
+merge_objects (struct merge_object *dst, const struct merge_object *src,
+	       const char *origin)
+{
+  struct gcov_summary object;
+  struct gcov_summary *programs;
+  unsigned f_ix, t_ix, p_ix, q_ix;
+  gcov_type *dst_values, *src_values;
+
+  if (dst->stamp != src->stamp
+      || dst->ctr_mask != src->ctr_mask
+      || dst->n_functions != src->n_functions
+      || dst->n_values != src->n_values
+      || memcmp (dst->functions, src->functions,
+		 dst->n_functions * sizeof (struct merge_function)))
+    {
+      fprintf (stderr, "%s:%s:profile mismatch, ignored\n",
+	       origin, dst->da_filename);
+      return 1;
+    }
+
+  /* Work on copies of the summaries so that DST stays intact if they
+     turn out not to match.  */
+  object = dst->object;
+  programs = XNEWVEC (struct gcov_summary, dst->n_programs + src->n_programs);
+  memcpy (programs, dst->programs,
+	  dst->n_programs * sizeof (struct gcov_summary));
+  if (merge_summary (&object, &src->object))
+    goto mismatch;
+  for (p_ix = 0, q_ix = dst->n_programs; p_ix < src->n_programs; p_ix++)
+    {
+      unsigned ix;
+
+      for (ix = 0; ix < q_ix; ix++)
+	if (programs[ix].checksum == src->programs[p_ix].checksum)
+	  break;
+      if (ix == q_ix)
+	{
+	  memset (&programs[ix], 0, sizeof (struct gcov_summary));
+	  programs[ix].checksum = src->programs[p_ix].checksum;
+	  q_ix++;
+	}
+      if (merge_summary (&programs[ix], &src->programs[p_ix]))
+	goto mismatch;
+    }
+
+  dst->object = object;
+  free (dst->programs);
+  dst->programs = programs;
+  dst->n_programs = q_ix;
+
+  dst_values = dst->values;
+  src_values = src->values;
+  for (f_ix = 0; f_ix < dst->n_functions; f_ix++)
+    for (t_ix = 0; t_ix < GCOV_COUNTERS; t_ix++)
+      {
+	unsigned n_counts = dst->functions[f_ix].n_ctrs[t_ix];
+
+	if (!n_counts)
+	  continue;
+	merge_counters (t_ix, dst_values, src_values, n_counts);
+	dst_values += n_counts;
+	src_values += n_counts;
+      }
+  return 0;
+
+ mismatch:
+  fprintf (stderr, "%s:%s:summary mismatch, ignored\n",
+	   origin, dst->da_filename);
+  free (programs);
+  return 1;
+}
+
+/* Read the data of one object from the current file, starting at the
+   stamp.  FILENAME is used for diagnostics.  The data ends at a zero
+   tag, a module info record or the next object of a spool file; the
+   tag of that record (zero at the end) is stored in *NEXT_TAG, and the
+   file is left positioned at its length.  Return the object, or NULL
+   if the data is malformed.  */
+
+static struct merge_object *
+read_object (const char *filename, gcov_unsigned_t *next_tag)
+{
+  struct merge_object *obj = XCNEW (struct merge_object);
+  struct merge_function *fn = NULL;
+  gcov_unsigned_t tag, length;
+
+  obj->stamp = gcov_read_unsigned ();
+  while (1)
+    {
+      tag = gcov_read_unsigned ();
+      if (!tag || gcov_is_error ())
+	break;
+      if (tag == GCOV_TAG_SPOOL_OBJECT || tag == GCOV_TAG_MODULE_INFO)
+	{
+	  /* The caller deals with the rest of the record.  */
+	  *next_tag = tag;
+	  return obj;
+	}
+      length = gcov_read_unsigned ();
+
+      if (tag == GCOV_TAG_FUNCTION && length == GCOV_TAG_FUNCTION_LENGTH)
+	{
+	  if (obj->n_functions == obj->alloc_functions)
+	    {
+	      obj->alloc_functions = obj->alloc_functions * 2 + 16;
+	      obj->functions = XRESIZEVEC (struct merge_function,
+					   obj->functions,
+					   obj->alloc_functions);
+	    }
+	  fn = &obj->functions[obj->n_functions++];
+	  memset (fn, 0, sizeof (*fn));
+	  fn->ident = gcov_read_unsigned ();
+	  fn->lineno_checksum = gcov_read_unsigned ();
+	  fn->cfg_checksum = gcov_read_unsigned ();
+	}
+      else if (GCOV_TAG_IS_COUNTER (tag) && fn)
+	{
+	  unsigned t_ix = GCOV_COUNTER_FOR_TAG (tag);
+	  unsigned n_counts = GCOV_TAG_COUNTER_NUM (length);
+
+	  if (fn->n_ctrs[t_ix])
+	    goto malformed;
+	  obj->ctr_mask |= 1 << t_ix;
+	  fn->n_ctrs[t_ix] = n_counts;
+	  if (obj->n_values + n_counts > obj->alloc_values)
+	    {
+	      obj->alloc_values = (obj->n_values + n_counts) * 2;
+	      obj->values = XRESIZEVEC (gcov_type, obj->values,
+					obj->alloc_values);
+	    }
+	  while (n_counts--)
+	    obj->values[obj->n_values++] = gcov_read_counter ();
+	}
+      else if (tag == GCOV_TAG_OBJECT_SUMMARY
+	       && length == GCOV_TAG_SUMMARY_LENGTH)
+	gcov_read_summary (&obj->object);
+      else if (tag == GCOV_TAG_PROGRAM_SUMMARY
+	       && length == GCOV_TAG_SUMMARY_LENGTH)
+	{
+	  obj->programs = XRESIZEVEC (struct gcov_summary, obj->programs,
+				      obj->n_programs + 1);
+	  gcov_read_summary (&obj->programs[obj->n_programs++]);
+	}
+      else
+	goto malformed;
+    }
+
+  *next_tag = 0;
+  if (!gcov_is_error ())
+    return obj;
+
+ malformed:
+  fprintf (stderr, "%s:malformed profile data\n", filename);
+  obj->da_filename = NULL;
+  merge_object_free (obj);
+  return NULL;
+}
+
+/* Add OBJ, read from FILENAME, to TABLE, merging it into the object
+   there for the same gcda file if there is one.  */
+
+static void
+add_object (htab_t table, struct merge_object *obj, const char *filename)
+{
+  void **slot = htab_find_slot (table, obj, INSERT);
+
+  if (*slot)
+    {
+      struct merge_object *dst = (struct merge_object *) *slot;
+
+      if (!merge_objects (dst, obj, filename) && !dst->n_trailer)
+	{
+	  dst->trailer = obj->trailer;
+	  dst->n_trailer = obj->n_trailer;
+	  obj->trailer = NULL;
+	  obj->n_trailer = 0;
+	}
+      merge_object_free (obj);
+    }
+  else
+    *slot = obj;
+}
+
+/* Read the spool file FILENAME and merge each object in it into
+   TABLE.  Nothing is merged from a file that cannot be read in full.
+   Return nonzero if it cannot.  */
+
+static int
+merge_spool_file (htab_t table, const char *filename)
+{
+  struct merge_object **objs = NULL;
+  unsigned n_objs = 0, alloc_objs = 0, ix;
+  gcov_unsigned_t tag;
+  int error = 0;
+
+  if (!gcov_open (filename, 1))
+    {
+      fprintf (stderr, "%s:cannot open, ignored\n", filename);
+      return 1;
+    }
+  if (!gcov_magic (gcov_read_unsigned (), GCOV_SPOOL_MAGIC))
+    {
+      fprintf (stderr, "%s:not a gcov spool file, ignored\n", filename);
+      gcov_close ();
+      return 1;
+    }
+  if (gcov_read_unsigned () != GCOV_VERSION)
+    {
+      fprintf (stderr, "%s:version mismatch, ignored\n", filename);
+      gcov_close ();
+      return 1;
+    }
+
+  tag = gcov_read_unsigned ();
+  while (tag == GCOV_TAG_SPOOL_OBJECT)
+    {
+      struct merge_object *obj;
+      const char *da_filename;
+
+      gcov_read_unsigned ();
+      da_filename = gcov_read_string ();
+      if (!da_filename
+	  || gcov_read_unsigned () != GCOV_DATA_MAGIC
+	  || gcov_read_unsigned () != GCOV_VERSION)
+	break;
+      da_filename = xstrdup (da_filename);
+      obj = read_object (filename, &tag);
+      if (!obj)
+	{
+	  free (CONST_CAST (char *, da_filename));
+	  break;
+	}
+      obj->da_filename = CONST_CAST (char *, da_filename);
+      if (tag == GCOV_TAG_MODULE_INFO)
+	{
+	  struct word_buffer trailer = { NULL, 0, 0 };
+
+	  read_module_infos (&trailer, &tag);
+	  obj->trailer = trailer.words;
+	  obj->n_trailer = trailer.n_words;
+	}
+
+      if (n_objs == alloc_objs)
+	{
+	  alloc_objs = alloc_objs * 2 + 16;
+	  objs = XRESIZEVEC (struct merge_object *, objs, alloc_objs);
+	}
+      objs[n_objs++] = obj;
+    }
+
+  /* A truncated file reads as zeros past its end, which are counted
+     in gcov_var.overread.  */
+  if (tag || gcov_is_error () || gcov_var.overread != -1u)
+    {
+      fprintf (stderr, "%s:malformed spool file, ignored\n", filename);
+      error = 1;
+    }
+  gcov_close ();
+
+  for (ix = 0; ix < n_objs; ix++)
+    if (error)
+      merge_object_free (objs[ix]);
+    else
+      add_object (table, objs[ix], filename);
+  free (objs);
+  return error;
+}
+
+/* Append VALUE to BUF.  */
+
+static void
+put_unsigned (struct word_buffer *buf, gcov_unsigned_t value)
+{
+  if (buf->n_words == buf->alloc)
+    {
+      buf->alloc = buf->alloc * 2 + GCOV_BLOCK_SIZE;
+      buf->words = XRESIZEVEC (gcov_unsigned_t, buf->words, buf->alloc);
+    }
+  buf->words[buf->n_words++] = value;
+}
+
+/* Read module info records from the current file into BUF, as long as
+   there are any.  *TAG is the tag of the first record, whose length
+   is next in the file; it is set to the tag following the records.
+   The records are dropped if the file is not in the native byte
+   order, as they hold strings.  */
+
+static void
+read_module_infos (struct word_buffer *buf, gcov_unsigned_t *tag)
+{
+  size_t start = buf->n_words;
+
+  while (*tag == GCOV_TAG_MODULE_INFO && !gcov_is_error ())
+    {
+      gcov_unsigned_t length = gcov_read_unsigned ();
+
+      put_unsigned (buf, *tag);
+      put_unsigned (buf, length);
+      while (length--)
+	put_unsigned (buf, gcov_read_unsigned ());
+      *tag = gcov_read_unsigned ();
+    }
+  if (gcov_var.endian || gcov_is_error ())
+    buf->n_words = start;
+}
+
+/* Append the counter VALUE to BUF, low part first.  */
+
+static void
+put_counter (struct word_buffer *buf, gcov_type value)
+{
+  put_unsigned (buf, (gcov_unsigned_t) value);
+  if (sizeof (value) > sizeof (gcov_unsigned_t))
+    put_unsigned (buf, (gcov_unsigned_t) (value >> 31 >> 1));
+  else
+    put_unsigned (buf, 0);
+}
+
+/* Append the N_WORDS words at WORDS to BUF.  */
+
+static void
+put_words (struct word_buffer *buf, const gcov_unsigned_t *words,
+	   size_t n_words)
+{
+  while (n_words--)
+    put_unsigned (buf, *words++);
+}
+
+/* Append STRING to BUF, as gcov_write_string does.  */
+
+static void
+put_string (struct word_buffer *buf, const char *string)
+{
+  size_t length = strlen (string);
+  unsigned alloc = (length + 4) >> 2;
+  unsigned ix;
+
+  put_unsigned (buf, alloc);
+  for (ix = 0; ix < alloc; ix++)
+    put_unsigned (buf, 0);
+  memcpy (&buf->words[buf->n_words - alloc], string, length);
+}
+
+/* Append the summary record SUMMARY with tag TAG to BUF.  */
+
+static void
+put_summary (struct word_buffer *buf, gcov_unsigned_t tag,
+	     const struct gcov_summary *summary)
+{
+  unsigned ix;
+
+  put_unsigned (buf, tag);
+  put_unsigned (buf, GCOV_TAG_SUMMARY_LENGTH);
+  put_unsigned (buf, summary->checksum);
+  for (ix = 0; ix < GCOV_COUNTERS_SUMMABLE; ix++)
+    {
+      const struct gcov_ctr_summary *csum = &summary->ctrs[ix];
+
+      put_unsigned (buf, csum->num);
+      put_unsigned (buf, csum->runs);
+      put_counter (buf, csum->sum_all);
+      put_counter (buf, csum->run_max);
+      put_counter (buf, csum->sum_max);
+    }
+}
+
+/* Append the data of OBJ to BUF, in gcda format without the
+   trailing zero.  */
+
+static void
+put_object (struct word_buffer *buf, const struct merge_object *obj)
+{
+  const gcov_type *values = obj->values;
+  unsigned f_ix, t_ix, p_ix;
+
+  put_unsigned (buf, GCOV_DATA_MAGIC);
+  put_unsigned (buf, GCOV_VERSION);
+  put_unsigned (buf, obj->stamp);
+
+  for (f_ix = 0; f_ix < obj->n_functions; f_ix++)
+    {
+      const struct merge_function *fn = &obj->functions[f_ix];
+
+      put_unsigned (buf, GCOV_TAG_FUNCTION);
+      put_unsigned (buf, GCOV_TAG_FUNCTION_LENGTH);
+      put_unsigned (buf, fn->ident);
+      put_unsigned (buf, fn->lineno_checksum);
+      put_unsigned (buf, fn->cfg_checksum);
+      for (t_ix = 0; t_ix < GCOV_COUNTERS; t_ix++)
+	{
+	  unsigned n_counts = fn->n_ctrs[t_ix];
+
+	  if (!((1 << t_ix) & obj->ctr_mask))
+	    continue;
+	  put_unsigned (buf, GCOV_TAG_FOR_COUNTER (t_ix));
+	  put_unsigned (buf, GCOV_TAG_COUNTER_LENGTH (n_counts));
+	  while (n_counts--)
+	    put_counter (buf, *values++);
+	}
+    }
+
+  put_summary (buf, GCOV_TAG_OBJECT_SUMMARY, &obj->object);
+  for (p_ix = 0; p_ix < obj->n_programs; p_ix++)
+    put_summary (buf, GCOV_TAG_PROGRAM_SUMMARY, &obj->programs[p_ix]);
+}
+
+/* Write BUF to FILENAME, through a temporary file that is renamed
+   over FILENAME once complete.  Return nonzero on error.  */
+
+static int
+write_word_buffer (const struct word_buffer *buf, const char *filename)
+{
+  char *tmp_filename = concat (filename, ".tmp", NULL);
+  FILE *file;
+  int error = 0;
+
+  file = fopen (tmp_filename, "wb");
+  if (!file)
+    {
+      fprintf (stderr, "%s:cannot open\n", tmp_filename);
+      free (tmp_filename);
+      return 1;
+    }
+  if (fwrite (buf->words, sizeof (gcov_unsigned_t), buf->n_words, file)
+      != buf->n_words)
+    error = 1;
+  if (fclose (file))
+    error = 1;
+  if (!error && rename (tmp_filename, filename))
+    error = 1;
+  if (error)
+    {
+      fprintf (stderr, "%s:error writing\n", filename);
+      unlink (tmp_filename);
+    }
+  free (tmp_filename);
+  return error;
+}
+
+/* htab_traverse callback appending the object in *SLOT to the word
+   buffer DATA, in spool format.  */
+
+static int
+put_spool_object (void **slot, void *data)
+{
+  struct word_buffer *buf = (struct word_buffer *) data;
+  struct merge_object *obj = (struct merge_object *) *slot;
+
+  put_unsigned (buf, GCOV_TAG_SPOOL_OBJECT);
+  put_unsigned (buf, 1 + ((strlen (obj->da_filename) + 4) >> 2));
+  put_string (buf, obj->da_filename);
+  put_object (buf, obj);
+  put_words (buf, obj->trailer, obj->n_trailer);
+  return 1;
+}
+
+/* Write all objects in TABLE to the spool file FILENAME.  Return
+   nonzero on error.  */
+
+static int
+write_spool_file (htab_t table, const char *filename)
+{
+  struct word_buffer buf = { NULL, 0, 0 };
+  int error;
+
+  put_unsigned (&buf, GCOV_SPOOL_MAGIC);
+  put_unsigned (&buf, GCOV_VERSION);
+  htab_traverse_noresize (table, put_spool_object, &buf);
+  put_unsigned (&buf, 0);
+  error = write_word_buffer (&buf, filename);
+  free (buf.words);
+  return error;
+}
+
+/* Read the gcda file FILENAME, with the module info records after its
+   summaries.  Return NULL if there is no such file or it is not a gcda
+   file.  */
+
+static struct merge_object *
+read_gcda_file (const char *filename)
+{
+  struct merge_object *obj = NULL;
+  gcov_unsigned_t tag;
+
+  if (!gcov_open (filename, 1))
+    return NULL;
+  if (gcov_magic (gcov_read_unsigned (), GCOV_DATA_MAGIC)
+      && gcov_read_unsigned () == GCOV_VERSION)
+    obj = read_object (filename, &tag);
+  if (obj)
+    {
+      struct word_buffer trailer = { NULL, 0, 0 };
+
+      obj->da_filename = xstrdup (filename);
+      read_module_infos (&trailer, &tag);
+      obj->trailer = trailer.words;
+      obj->n_trailer = trailer.n_words;
+    }
+  gcov_close ();
+  return obj;
+}
+
+/* Merge OBJ with the gcda file it names, if there is one, and write
+   the result back.  As in libgcov, data from a different compilation
+   is overwritten.  Return nonzero on error.  */
+
+static int
+write_gcda_file (struct merge_object *obj)
+{
+  struct word_buffer buf = { NULL, 0, 0 };
+  struct merge_object *old = read_gcda_file (obj->da_filename);
+  int error;
+
+  if (old && old->stamp == obj->stamp
+      && !merge_objects (obj, old, obj->da_filename) && old->n_trailer)
+    {
+      /* Keep the module info records of the old file, which hold the
+	 module group if one was computed.  */
+      free (obj->trailer);
+      obj->trailer = old->trailer;
+      obj->n_trailer = old->n_trailer;
+      old->trailer = NULL;
+    }
+  if (old)
+    merge_object_free (old);
+
+  put_object (&buf, obj);
+  put_words (&buf, obj->trailer, obj->n_trailer);
+  put_unsigned (&buf, 0);
+  error = write_word_buffer (&buf, obj->da_filename);
+  free (buf.words);
+  return error;
+}
+
+/* Run FN (SLICE, N_SLICES, DATA) for each SLICE in [0, N_SLICES),
+   in parallel worker processes when possible.  FN returns nonzero on
+   error.  If STATUS is not NULL, STATUS[SLICE] is set to nonzero if
+   SLICE failed.  Return nonzero if any slice failed.  */
+
+static int
+run_workers (int (*fn) (unsigned, unsigned, void *), unsigned n_slices,
+	     void *data, int *status)
+{
+  unsigned slice;
+  int failed, error = 0;
+
+#ifdef HAVE_WORKING_FORK
+  if (n_slices > 1)
+    {
+      pid_t *pids = XNEWVEC (pid_t, n_slices);
+
+      fflush (stdout);
+      fflush (stderr);
+      for (slice = 0; slice < n_slices; slice++)
+	{
+	  pids[slice] = fork ();
+	  if (pids[slice] == 0)
+	    _exit (fn (slice, n_slices, data) ? 1 : 0);
+	  else if (pids[slice] < 0)
+	    {
+	      failed = fn (slice, n_slices, data);
+	      if (status)
+		status[slice] = failed;
+	      error |= failed;
+	    }
+	}
+      for (slice = 0; slice < n_slices; slice++)
+	{
+	  int wstatus;
+
+	  if (pids[slice] < 0)
+	    continue;
+	  failed = (waitpid (pids[slice], &wstatus, 0) != pids[slice]
+		    || !WIFEXITED (wstatus) || WEXITSTATUS (wstatus));
+	  if (status)
+	    status[slice] = failed;
+	  error |= failed;
+	}
+      free (pids);
+      return error;
+    }
+#endif
+
+  for (slice = 0; slice < n_slices; slice++)
+    {
+      failed = fn (slice, n_slices, data);
+      if (status)
+	status[slice] = failed;
+      error |= failed;
+    }
+  return error;
+}
+
+/* Work shared by the worker processes.  */
+
+struct merge_work
+{
+  /* The spool files to merge.  */
+  char **inputs;
+  unsigned n_inputs;
+
+  /* Flags set for the spool files that could not be read, which are
+     skipped.  */
+  char *bad_inputs;
+
+  /* Partial spool file written by each worker, and the file in which
+     it records the bad inputs among its spool files.  */
+  char **partials;
+  char **rejects;
+
+  /* Merged objects, sorted by gcda name.  */
+  struct merge_object **objects;
+  unsigned n_objects;
+};
+
+/* Set *BEGIN and *END to the bounds of the spool files of SLICE out
+   of N_SLICES.  */
+
+static void
+slice_inputs (const struct merge_work *work, unsigned slice,
+	      unsigned n_slices, unsigned *begin, unsigned *end)
+{
+  *begin = (unsigned) ((unsigned long long) work->n_inputs
+		       * slice / n_slices);
+  *end = (unsigned) ((unsigned long long) work->n_inputs
+		     * (slice + 1) / n_slices);
+}
+
+/* Merge the spool files [BEGIN, END) of WORK into TABLE, flagging the
+   ones that cannot be read.  */
+
+static void
+merge_spool_files (struct merge_work *work, htab_t table, unsigned begin,
+		   unsigned end)
+{
+  unsigned ix;
+
+  for (ix = begin; ix < end; ix++)
+    work->bad_inputs[ix] = merge_spool_file (table, work->inputs[ix]);
+}
+
+/* Merge the spool files of SLICE into a partial spool file, and record
+   which of them were bad.  */
+
+static int
+merge_slice (unsigned slice, unsigned n_slices, void *data)
+{
+  struct merge_work *work = (struct merge_work *) data;
+  htab_t table = new_object_table ();
+  unsigned begin, end;
+  FILE *file;
+  int error;
+
+  slice_inputs (work, slice, n_slices, &begin, &end);
+  merge_spool_files (work, table, begin, end);
+  error = write_spool_file (table, work->partials[slice]);
+  htab_delete (table);
+
+  file = fopen (work->rejects[slice], "wb");
+  if (!file)
+    return 1;
+  if (fwrite (work->bad_inputs + begin, 1, end - begin, file) != end - begin)
+    error = 1;
+  if (fclose (file))
+    error = 1;
+  return error;
+}
+
+/* Read back the bad inputs recorded by the worker of SLICE.  Return
+   nonzero on error.  */
+
+static int
+read_rejects (struct merge_work *work, unsigned slice, unsigned n_slices)
+{
+  unsigned begin, end;
+  FILE *file;
+  int error;
+
+  slice_inputs (work, slice, n_slices, &begin, &end);
+  file = fopen (work->rejects[slice], "rb");
+  if (!file)
+    return 1;
+  error = (fread (work->bad_inputs + begin, 1, end - begin, file)
+	   != end - begin);
+  fclose (file);
+  return error;
+}
+
+/* Write the gcda files of the objects in SLICE.  */
+
+static int
+write_slice (unsigned slice, unsigned n_slices, void *data)
+{
+  struct merge_work *work = (struct merge_work *) data;
+  unsigned ix;
+  int error = 0;
+
+  for (ix = slice; ix < work->n_objects; ix += n_slices)
+    error |= write_gcda_file (work->objects[ix]);
+  return error;
+}
+
+/* htab_traverse callback collecting the objects into the array at
+   DATA.  */
+
+static int
+collect_object (void **slot, void *data)
+{
+  struct merge_object ***next = (struct merge_object ***) data;
+
+  *(*next)++ = (struct merge_object *) *slot;
+  return 1;
+}
+
+/* qsort comparison of two objects by gcda name.  */
+
+static int
+compare_objects (const void *p1, const void *p2)
+{
+  return strcmp ((*(struct merge_object *const *) p1)->da_filename,
+		 (*(struct merge_object *const *) p2)->da_filename);
+}
+
+/* LIPO module grouping.  This is the computation that
+   __gcov_compute_module_groups in dyn-ipa.c does when a training run
+   exits, done once on the merged counters of the gcda files instead.
+   The call graph and the grouping are shared with dyn-ipa.c, so it
+   reads the same GCOV_DYN_* environment variables.  */
+
+#include "dyn-ipa-cgraph.c"
+
+/* Offsets in a module info record.  */
+#define MOD_INFO_IDENT 2
+#define MOD_INFO_IS_PRIMARY 3
+#define MOD_INFO_IS_EXPORTED 4
+#define MOD_INFO_STRINGS 11
+
+/* Add the edges of the functions of the module with index M_IX from
+   its direct and indirect call counters, keeping at most MAX_EDGES
+   per function.  */
+
+static void
+add_module_edges (unsigned m_ix, unsigned max_edges)
+{
+  const struct merge_object *obj = the_dyn_call_graph.sup_modules[m_ix].obj;
+  const gcov_type *values = obj->values;
+  unsigned f_ix, t_ix;
+
+  for (f_ix = 0; f_ix < obj->n_functions; f_ix++)
+    {
+      const struct merge_function *fn = &obj->functions[f_ix];
+      struct dyn_cgraph_node *caller = get_module_fn_cgraph_node (m_ix, f_ix);
+      const gcov_type *dc_values = NULL, *icall_values = NULL;
+      unsigned n_dc, n_icall;
+
+      for (t_ix = 0; t_ix < GCOV_COUNTERS; t_ix++)
+	{
+	  if (t_ix == GCOV_COUNTER_DIRECT_CALL)
+	    dc_values = values;
+	  else if (t_ix == GCOV_COUNTER_ICALL_TOPNV)
+	    icall_values = values;
+	  values += fn->n_ctrs[t_ix];
+	}
+
+      /* Ignore a partial entry at the end of a damaged file.  */
+      n_dc = fn->n_ctrs[GCOV_COUNTER_DIRECT_CALL];
+      n_dc -= n_dc % 2;
+      n_icall = fn->n_ctrs[GCOV_COUNTER_ICALL_TOPNV];
+      n_icall -= n_icall % GCOV_ICALL_TOPN_NCOUNTS;
+
+      caller->first_callee = the_dyn_call_graph.num_edges;
+      gcov_build_callgraph_dc_fn (caller, dc_values, n_dc);
+      gcov_build_callgraph_ic_fn (caller, icall_values, n_icall);
+      gcov_prune_callees (caller, max_edges);
+    }
+}
+
+/* Append the module info record MOD_INFO to BUF, with its primary and
+   exported flags set to IS_PRIMARY and IS_EXPORTED.  */
+
+static void
+put_mod_info (struct word_buffer *buf, const gcov_unsigned_t *mod_info,
+	      int is_primary, int is_exported)
+{
+  size_t start = buf->n_words;
+
+  put_words (buf, mod_info, 2 + mod_info[1]);
+  buf->words[start + MOD_INFO_IS_PRIMARY] = is_primary;
+  buf->words[start + MOD_INFO_IS_EXPORTED] = is_exported;
+}
+
+/* Return string IX of the module info record MOD_INFO: 0 for the gcda
+   name without suffix, 1 for the source name.  */
+
+static const char *
+mod_info_string (const gcov_unsigned_t *mod_info, unsigned ix)
+{
+  const gcov_unsigned_t *string = mod_info + MOD_INFO_STRINGS;
+
+  while (ix--)
+    string += 1 + *string;
+  return (const char *) (string + 1);
+}
+
+/* Rewrite the gcda file of the module with index M_IX with its module
+   group, and write the imports file next to it.  Return nonzero on
+   error.  */
+
+static int
+write_group (unsigned m_ix)
+{
+  struct dyn_module_info *modules = the_dyn_call_graph.sup_modules;
+  struct word_buffer buf = { NULL, 0, 0 };
+  const struct dyn_imp_mod **imports;
+  const char *suffix;
+  char *imports_filename;
+  unsigned ix, n_imports = 0;
+  FILE *file;
+  int error;
+
+  imports = gcov_get_sorted_imported_modules (m_ix, &n_imports);
+
+  put_object (&buf, modules[m_ix].obj);
+  put_mod_info (&buf, modules[m_ix].mod_info, 1, modules[m_ix].is_exported);
+  for (ix = 0; ix < n_imports; ix++)
+    put_mod_info (&buf, modules[imports[ix]->mod_id].mod_info, 0,
+		  modules[imports[ix]->mod_id].is_exported);
+  put_unsigned (&buf, 0);
+  error = write_word_buffer (&buf, modules[m_ix].obj->da_filename);
+  free (buf.words);
+
+  suffix = getenv ("GCOV_IMPORTS_SUFFIX");
+  if (!suffix || !*suffix)
+    suffix = ".imports";
+  imports_filename = concat (modules[m_ix].obj->da_filename, suffix, NULL);
+  file = fopen (imports_filename, "w");
+  if (file)
+    {
+      for (ix = 0; ix < n_imports; ix++)
+	{
+	  const gcov_unsigned_t *mod_info
+	    = modules[imports[ix]->mod_id].mod_info;
+
+	  fprintf (file, "%s\n%s%s\n", mod_info_string (mod_info, 1),
+		   mod_info_string (mod_info, 0), GCOV_DATA_SUFFIX);
+	}
+      if (fclose (file))
+	error = 1;
+    }
+  if (!file || error)
+    {
+      fprintf (stderr, "%s:error writing\n", imports_filename);
+      error = 1;
+    }
+  free (imports_filename);
+  free (imports);
+  return error;
+}
+
+/* Write the module groups of the modules in SLICE.  */
+
+static int
+write_group_slice (unsigned slice, unsigned n_slices,
+		   void *data ATTRIBUTE_UNUSED)
+{
+  unsigned ix;
+  int error = 0;
+
+  for (ix = slice; ix < the_dyn_call_graph.num_modules; ix += n_slices)
+    if (the_dyn_call_graph.sup_modules[ix].obj)
+      error |= write_group (ix);
+  return error;
+}
+
+/* Return the module info record for the module itself in the trailer
+   of OBJ, or NULL.  */
+
+static const gcov_unsigned_t *
+find_primary_mod_info (const struct merge_object *obj)
+{
+  size_t ix = 0;
+
+  while (ix + 2 <= obj->n_trailer)
+    {
+      const gcov_unsigned_t *record = &obj->trailer[ix];
+
+      ix += 2 + record[1];
+      if (ix > obj->n_trailer || record[1] < MOD_INFO_STRINGS)
+	break;
+      if (record[0] == GCOV_TAG_MODULE_INFO && record[MOD_INFO_IS_PRIMARY])
+	return record;
+    }
+  return NULL;
+}
+
+/* Compute the module groups of the N gcda files NAMES, which are
+   sorted, and write them into the files.  Files without module info
+   are not LIPO modules and are left alone.  Return nonzero on
+   error.  */
+
+static int
+group_modules (char **names, unsigned n)
+{
+  struct merge_object **objects = XCNEWVEC (struct merge_object *, n);
+  struct dyn_module_info *modules = NULL;
+  unsigned n_modules = 0, n_nodes = 0;
+  unsigned max_edges = gcov_get_max_out_edges ();
+  unsigned ix, m_ix, f_ix;
+  int error = 0;
+
+  memset (&the_dyn_call_graph, 0, sizeof (the_dyn_call_graph));
+
+  /* Read the files and index them by module ident.  */
+  for (ix = 0; ix < n; ix++)
+    {
+      const gcov_unsigned_t *mod_info;
+      unsigned ident;
+
+      if (ix && !strcmp (names[ix], names[ix - 1]))
+	continue;
+      objects[ix] = read_gcda_file (names[ix]);
+      if (!objects[ix])
+	{
+	  fprintf (stderr, "%s:cannot read\n", names[ix]);
+	  error = 1;
+	  continue;
+	}
+      mod_info = find_primary_mod_info (objects[ix]);
+      if (!mod_info)
+	continue;
+      ident = mod_info[MOD_INFO_IDENT];
+      if (ident > n_modules)
+	{
+	  modules = XRESIZEVEC (struct dyn_module_info, modules, ident);
+	  memset (&modules[n_modules], 0,
+		  (ident - n_modules) * sizeof (struct dyn_module_info));
+	  n_modules = ident;
+	}
+      if (!ident || modules[ident - 1].obj)
+	{
+	  fprintf (stderr, "%s:module ident %u already seen, ignored\n",
+		   names[ix], ident);
+	  continue;
+	}
+      modules[ident - 1].obj = objects[ix];
+      modules[ident - 1].mod_info = mod_info;
+    }
+  the_dyn_call_graph.sup_modules = modules;
+  the_dyn_call_graph.num_modules = n_modules;
+
+  /* Lay out the nodes of each module at a base index.  A missing
+     module gets one node without a function, so that calls into it
+     find no node.  */
+  for (m_ix = 0; m_ix < n_modules; m_ix++)
+    {
+      for (f_ix = 0; f_ix < get_module_num_functions (m_ix); f_ix++)
+	modules[m_ix].max_func_ident
+	  = MAX (modules[m_ix].max_func_ident,
+		 modules[m_ix].obj->functions[f_ix].ident);
+      modules[m_ix].node_base = n_nodes;
+      n_nodes += modules[m_ix].max_func_ident + 1;
+    }
+  the_dyn_call_graph.nodes = XCNEWVEC (struct dyn_cgraph_node, n_nodes);
+  the_dyn_call_graph.num_nodes = n_nodes;
+  for (m_ix = 0; m_ix < n_modules; m_ix++)
+    for (f_ix = 0; f_ix < get_module_num_functions (m_ix); f_ix++)
+      {
+	gcov_unsigned_t ident = modules[m_ix].obj->functions[f_ix].ident;
+
+	get_module_fn_cgraph_node (m_ix, f_ix)->guid
+	  = GEN_FUNC_GLOBAL_ID (m_ix + 1, ident);
+      }
+
+  for (m_ix = 0; m_ix < n_modules; m_ix++)
+    if (modules[m_ix].obj)
+      add_module_edges (m_ix, max_edges);
+  gcov_compute_module_groups (gcov_compute_cutoff_count ());
+
+  error |= run_workers (write_group_slice,
+			MIN (n_jobs, MAX (n_modules, 1)), NULL, NULL);
+
+  for (ix = 0; ix < n_nodes; ix++)
+    if (the_dyn_call_graph.nodes[ix].imported_modules)
+      pointer_set_destroy (the_dyn_call_graph.nodes[ix].imported_modules);
+  for (m_ix = 0; m_ix < n_modules; m_ix++)
+    if (modules[m_ix].imported_modules)
+      pointer_set_destroy (modules[m_ix].imported_modules);
+  for (ix = 0; ix < n; ix++)
+    if (objects[ix])
+      merge_object_free (objects[ix]);
+  free (objects);
+  free (modules);
+  free (the_dyn_call_graph.nodes);
+  free (the_dyn_call_graph.edges);
+  return error;
+}
+
+/* qsort comparison of two strings.  */
+
+static int
+compare_names (const void *p1, const void *p2)
+{
+  return strcmp (*(char *const *) p1, *(char *const *) p2);
+}
+
+/* Merge the spool files of WORK into the gcda files.  Spool files that
+   cannot be read are reported and skipped, and kept even with -r.  If
+   NAMES is not NULL, the names of the gcda files are added to the
+   array *NAMES, which holds *N_NAMES names.  Return nonzero on
+   error.  */
+
+static int
+merge_inputs (struct merge_work *work, char ***names, unsigned *n_names)
+{
+  struct merge_object **next;
+  htab_t table;
+  unsigned ix, n_slices;
+  int error = 0;
+
+  table = new_object_table ();
+  work->bad_inputs = XCNEWVEC (char, work->n_inputs);
+  n_slices = MIN (n_jobs, work->n_inputs);
+  if (n_slices > 1)
+    {
+      int *status = XNEWVEC (int, n_slices);
+
+      /* Merge slices of the inputs in parallel, then combine the
+	 partial results.  The inputs of a worker that failed are
+	 merged here instead.  */
+      work->partials = XNEWVEC (char *, n_slices);
+      work->rejects = XNEWVEC (char *, n_slices);
+      for (ix = 0; ix < n_slices; ix++)
+	{
+	  work->partials[ix] = make_temp_file (GCOV_SPOOL_SUFFIX);
+	  work->rejects[ix] = make_temp_file (NULL);
+	}
+      run_workers (merge_slice, n_slices, work, status);
+      for (ix = 0; ix < n_slices; ix++)
+	{
+	  if (status[ix]
+	      || read_rejects (work, ix, n_slices)
+	      || merge_spool_file (table, work->partials[ix]))
+	    {
+	      unsigned begin, end;
+
+	      fprintf (stderr, "%s:worker failed, merging its inputs again\n",
+		       work->partials[ix]);
+	      slice_inputs (work, ix, n_slices, &begin, &end);
+	      merge_spool_files (work, table, begin, end);
+	    }
+	  unlink (work->partials[ix]);
+	  unlink (work->rejects[ix]);
+	  free (work->partials[ix]);
+	  free (work->rejects[ix]);
+	}
+      free (work->partials);
+      free (work->rejects);
+      free (status);
+    }
+  else
+    merge_spool_files (work, table, 0, work->n_inputs);
+
+  work->n_objects = htab_elements (table);
+  work->objects = XNEWVEC (struct merge_object *, work->n_objects);
+  next = work->objects;
+  htab_traverse_noresize (table, collect_object, &next);
+  qsort (work->objects, work->n_objects, sizeof (struct merge_object *),
+	 compare_objects);
+  error |= run_workers (write_slice, MIN (n_jobs, MAX (work->n_objects, 1)),
+			work, NULL);
+  if (names)
+    {
+      *names = XRESIZEVEC (char *, *names, *n_names + work->n_objects);
+      for (ix = 0; ix < work->n_objects; ix++)
+	(*names)[(*n_names)++] = xstrdup (work->objects[ix]->da_filename);
+    }
+  free (work->objects);
+  htab_delete (table);
+
+  if (!error && flag_remove_inputs)
+    for (ix = 0; ix < work->n_inputs; ix++)
+      if (!work->bad_inputs[ix])
+	unlink (work->inputs[ix]);
+  free (work->bad_inputs);
+
+  return error;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct merge_work work;
+  char **group_names;
+  unsigned ix, n_group_names = 0;
+  size_t suffix_len = strlen (GCOV_DATA_SUFFIX);
+  int opt, error = 0;
+
+  /* Unlock the stdio streams.  */
+  unlock_std_streams ();
+
+  expandargv (&argc, &argv);
+
+  while ((opt = getopt_long (argc, argv, "hvj:rl", options, NULL)) != -1)
+    {
+      switch (opt)
+	{
+	case 'h':
+	  print_usage ();
+	  return 0;
+	case 'v':
+	  print_version ();
+	  return 0;
+	case 'j':
+	  {
+	    int jobs = atoi (optarg);
+
+	    n_jobs = jobs > 0 ? jobs : 1;
+	  }
+	  break;
+	case 'r':
+	  flag_remove_inputs = 1;
+	  break;
+	case 'l':
+	  flag_lipo = 1;
+	  break;
+	default:
+	  fprintf (stderr, "unknown flag `%c'\n", opt);
+	}
+    }
+
+  /* With -l, gcda files may be given to have their module groups
+     computed without merging anything into them.  */
+  memset (&work, 0, sizeof (work));
+  work.inputs = XNEWVEC (char *, argc - optind);
+  group_names = XNEWVEC (char *, argc - optind);
+  for (ix = optind; ix < (unsigned) argc; ix++)
+    {
+      size_t len = strlen (argv[ix]);
+
+      if (flag_lipo && len > suffix_len
+	  && !strcmp (argv[ix] + len - suffix_len, GCOV_DATA_SUFFIX))
+	group_names[n_group_names++] = xstrdup (argv[ix]);
+      else
+	work.inputs[work.n_inputs++] = argv[ix];
+    }
+  if (!work.n_inputs && !n_group_names)
+    {
+      print_usage ();
+      return 1;
+    }
+
+  if (work.n_inputs)
+    error |= merge_inputs (&work, flag_lipo ? &group_names : NULL,
+			   &n_group_names);
+
+  if (!error && n_group_names)
+    {
+      qsort (group_names, n_group_names, sizeof (char *), compare_names);
+      error |= group_modules (group_names, n_group_names);
+    }
+
+  for (ix = 0; ix < n_group_names; ix++)
+    free (group_names[ix]);
+  free (group_names);
+  free (work.inputs);
+  return error;
+}
+
+static void
+print_usage (void)
+{
+  printf ("Usage: gcov-merge [OPTION] ... spoolfiles\n");
+  printf ("       gcov-merge -l [OPTION] ... [spoolfiles] [gcdafiles]\n");
+  printf ("Merge gcov spool files into the coverage files they name\n");
+  printf ("  -h, --help           Print this help\n");
+  printf ("  -v, --version        Print version number\n");
+  printf ("  -j, --jobs N         Merge in N parallel processes\n");
+  printf ("  -r, --remove         Remove the spool files once merged\n");
+  printf ("  -l, --lipo           Compute the LIPO module groups of the merged\n"
+	  "                       and the given coverage files\n");
+  printf ("Spool files are written by programs run with GCOV_SPOOL_DIR set.\n");
+  printf ("Use @FILE to read a long list of spool files from FILE.\n");
+}
+
+static void
+print_version (void)
+{
+  printf ("gcov-merge %s%s\n", pkgversion_string, version_string);
+  printf ("Copyright (C) 2011 Free Software Foundation, Inc.\n");
+  printf ("This is free software; see the source for copying conditions.\n"
+  	  "There is NO warranty; not even for MERCHANTABILITY or \n"
+	  "FITNESS FOR A PARTICULAR PURPOSE.\n\n");
+}
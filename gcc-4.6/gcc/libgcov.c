@@ -209,6 +209,9 @@ static char *gi_filename, *gi_filename_up;
 static int gcov_open_by_filename (char * gi_filename);
 static int gcov_exit_init (void);
 static void gcov_dump_one_gcov (struct gcov_info *gi_ptr);
+#ifndef __GCOV_KERNEL__
+static int gcov_spool_dump (void);
+#endif
 
 /* Make sure path component of the given FILENAME exists, create
    missing directories. FILENAME must be writable.
@@ -439,31 +442,6 @@ pmu_profile_stop (void)
                 gi_filename);
 }
 
-/* Sort N entries in VALUE_ARRAY in descending order.
-   Each entry in VALUE_ARRAY has two values. The sorting
-   is based on the second value.  */
-
-GCOV_LINKAGE  void
-gcov_sort_n_vals (gcov_type *value_array, int n)
-{
-  int j, k;
-  for (j = 2; j < n; j += 2)
-    {
-      gcov_type cur_ent[2];
-      cur_ent[0] = value_array[j];
-      cur_ent[1] = value_array[j + 1];
-      k = j - 2;
-      while (k >= 0 && value_array[k + 1] < cur_ent[1])
-        {
-          value_array[k + 2] = value_array[k];
-          value_array[k + 3] = value_array[k+1];
-          k -= 2;
-        }
-      value_array[k + 2] = cur_ent[0];
-      value_array[k + 3] = cur_ent[1];
-    }
-}
-
 /* Sort the profile counters for all indirect call sites. Counters
    for each call site are allocated in array COUNTERS.  */
 
@@ -525,12 +503,20 @@ gcov_write_import_file (char *gi_filename, struct gcov_info *gi_ptr)
     }
 }
 
+/* Write the module info of each LIPO module into its gcda file, with
+   the module group computed from the dynamic call graph.  When
+   GCOV_DYN_CGRAPH_OFFLINE is set only the module itself is written,
+   and the groups are computed later from the gcda files by
+   gcov-merge -l, rather than at the exit of every training run.  */
+
 static void
 gcov_dump_module_info (void)
 {
   struct gcov_info *gi_ptr;
+  int offline = getenv ("GCOV_DYN_CGRAPH_OFFLINE") != 0;
 
-  __gcov_compute_module_groups ();
+  if (!offline)
+    __gcov_compute_module_groups ();
 
   /* Now write out module group info.  */
   for (gi_ptr = __gcov_list; gi_ptr; gi_ptr = gi_ptr->next)
@@ -554,7 +540,8 @@ gcov_dump_module_info (void)
          gcov_error (error  < 0 ?  "profiling:%s:Overflow writing\n" :
                                    "profiling:%s:Error writing\n",
                                    gi_filename);
-    gcov_write_import_file (gi_filename, gi_ptr);
+    if (!offline)
+      gcov_write_import_file (gi_filename, gi_ptr);
   }
   __gcov_finalize_dyn_callgraph ();
 }
@@ -577,6 +564,15 @@ gcov_exit (void)
 
   dump_module_info = gcov_exit_init ();
 
+  /* In spool mode the gcda files are only updated by gcov-merge.
+     Module groups depend on the merged profile, so they are not
+     computed here either, but by gcov-merge -l.  */
+  if (gcov_spool_dump ())
+    {
+      free (gi_filename);
+      return;
+    }
+
   for (gi_ptr = __gcov_list; gi_ptr; gi_ptr = gi_ptr->next)
     gcov_dump_one_gcov (gi_ptr);
 
@@ -1044,17 +1040,17 @@ gcov_gcda_file_size (struct gcov_info *gi_ptr)
   return size*4;
 }
 
-/* Write profile data (including summary and module grouping information,
-   if available, to file.  */
+/* Write the header and the execution counts of every function in
+   GI_PTR to the current file.  FI_STRIDE is the size of one
+   gcov_fn_info entry.  */
 
 static void
-gcov_write_gcda_file (struct gcov_info *gi_ptr,
-                      unsigned fi_stride)
+gcov_write_gcda_counters (struct gcov_info *gi_ptr,
+                          unsigned fi_stride)
 {
       const struct gcov_fn_info *fi_ptr;
       gcov_type *values[GCOV_COUNTERS];
       unsigned t_ix, c_ix, f_ix, n_counts;
-      int error = 0;
 
       /* Write out the data.  */
       gcov_write_tag_length (GCOV_DATA_MAGIC, GCOV_VERSION);
@@ -1094,6 +1090,18 @@ gcov_write_gcda_file (struct gcov_info *gi_ptr,
 	      c_ix++;
 	    }
         }
+}
+
+/* Write profile data (including summary and module grouping information,
+   if available, to file.  */
+
+static void
+gcov_write_gcda_file (struct gcov_info *gi_ptr,
+                      unsigned fi_stride)
+{
+      int error = 0;
+
+      gcov_write_gcda_counters (gi_ptr, fi_stride);
 
       /* Object file summary.  */
       gcov_write_summary (GCOV_TAG_OBJECT_SUMMARY, &object);
@@ -1188,285 +1196,147 @@ gcov_dump_one_gcov (struct gcov_info *gi_ptr)
   gcov_write_gcda_file (gi_ptr, fi_stride);
 }
 
-#endif /* L_gcov */
-
-#ifdef L_gcov_merge_add
-/* The profile merging function that just adds the counters.  It is given
-   an array COUNTERS of N_COUNTERS old counters and it reads the same number
-   of counters from the gcov file.  */
-void
-__gcov_merge_add (gcov_type *counters, unsigned n_counters)
-{
-  for (; n_counters; counters++, n_counters--)
-    *counters += gcov_read_counter ();
-}
-#endif /* L_gcov_merge_add */
-
-#ifdef L_gcov_merge_ior
-/* The profile merging function that just adds the counters.  It is given
-   an array COUNTERS of N_COUNTERS old counters and it reads the same number
-   of counters from the gcov file.  */
-void
-__gcov_merge_ior (gcov_type *counters, unsigned n_counters)
-{
-  for (; n_counters; counters++, n_counters--)
-    *counters |= gcov_read_counter ();
-}
-#endif
-
-#ifdef L_gcov_merge_reusedist
-
-/* Return the weighted arithmetic mean of two values.  */
+#ifndef __GCOV_KERNEL__
+/* Initialize SUM to the summary of a single run whose totals are in
+   THIS_RUN, for the counters active in INFO.  */
 
-static gcov_type
-__gcov_weighted_mean2 (gcov_type value1, gcov_type count1,
-                       gcov_type value2, gcov_type count2)
+static void
+gcov_single_run_summary (const struct gcov_info *info,
+                         struct gcov_summary *sum,
+                         const struct gcov_summary *this_run)
 {
-  if (count1 + count2 == 0)
-    return 0;
-  else
-    return (value1 * count1 + value2 * count2) / (count1 + count2);
-}
+  unsigned t_ix;
 
-void
-__gcov_merge_reusedist (gcov_type *counters, unsigned n_counters)
-{
-  unsigned i;
+  memset (sum, 0, sizeof (*sum));
+  for (t_ix = 0; t_ix < GCOV_COUNTERS_SUMMABLE; t_ix++)
+    {
+      const struct gcov_ctr_summary *cs_run = &this_run->ctrs[t_ix];
+      struct gcov_ctr_summary *cs_sum = &sum->ctrs[t_ix];
 
-  gcc_assert(!(n_counters % 4));
+      if (!gcov_counter_active (info, t_ix))
+        continue;
 
-  for (i = 0; i < n_counters; i += 4)
-    {
-      /* Decode current values.  */
-      gcov_type c_mean_dist = counters[i];
-      gcov_type c_mean_size = counters[i+1];
-      gcov_type c_count = counters[i+2];
-      gcov_type c_dist_x_size = counters[i+3];
-
-      /* Read and decode values in file.  */
-      gcov_type f_mean_dist = __gcov_read_counter ();
-      gcov_type f_mean_size = __gcov_read_counter ();
-      gcov_type f_count = __gcov_read_counter ();
-      gcov_type f_dist_x_size = __gcov_read_counter ();
-
-      /* Compute aggregates.  */
-      gcov_type a_mean_dist = __gcov_weighted_mean2 (
-          f_mean_dist, f_count, c_mean_dist, c_count);
-      gcov_type a_mean_size = __gcov_weighted_mean2 (
-          f_mean_size, f_count, c_mean_size, c_count);
-      gcov_type a_count = f_count + c_count;
-      gcov_type a_dist_x_size = f_dist_x_size + c_dist_x_size;
-
-      /* Encode back into counters.  */
-      counters[i] = a_mean_dist;
-      counters[i+1] = a_mean_size;
-      counters[i+2] = a_count;
-      counters[i+3] = a_dist_x_size;
+      cs_sum->num = cs_run->num;
+      cs_sum->runs = 1;
+      cs_sum->sum_all = cs_run->sum_all;
+      cs_sum->run_max = cs_run->run_max;
+      cs_sum->sum_max = cs_run->run_max;
     }
 }
 
-#endif
-
-#ifdef L_gcov_merge_dc
-
-/* Returns 1 if the function global id GID is not valid.  */
+/* Write the counters of all objects to a new spool file in the
+   directory named by GCOV_SPOOL_DIR instead of merging them into the
+   gcda files.  Every dump gets a file of its own, so nothing is locked
+   or read back; gcov-merge combines the spool files later.  The file
+   is written under a temporary name and renamed once complete, so a
+   merge running concurrently never sees a partial dump.
+   Return 1 if the data was spooled, and 0 if spool mode is off or the
+   spool file could not be written, in which case the caller updates
+   the gcda files as usual.  */
 
 static int
-__gcov_is_gid_insane (gcov_type gid)
+gcov_spool_dump (void)
 {
-  if (EXTRACT_MODULE_ID_FROM_GLOBAL_ID (gid) == 0
-      || EXTRACT_FUNC_ID_FROM_GLOBAL_ID (gid) == 0)
-    return 1;
-  return 0;
-}
-
-/* The profile merging function used for merging direct call counts
-   This function is given array COUNTERS of N_COUNTERS old counters and it
-   reads the same number of counters from the gcov file.  */
+#ifdef TARGET_POSIX_IO
+  static unsigned spool_seq;
+  const char *spool_dir = getenv ("GCOV_SPOOL_DIR");
+  struct gcov_info *gi_ptr;
+  char *spool_filename, *tmp_filename;
+  size_t length;
+  int fd, error;
 
-void
-__gcov_merge_dc (gcov_type *counters, unsigned n_counters)
-{
-  unsigned i;
+  if (!spool_dir || !*spool_dir)
+    return 0;
 
-  gcc_assert (!(n_counters % 2));
-  for (i = 0; i < n_counters; i += 2)
+  /* Room for "/PID-TIME-SEQ", the suffix and ".tmp".  */
+  length = strlen (spool_dir) + 3 * 21 + sizeof (GCOV_SPOOL_SUFFIX) + 5;
+  spool_filename = (char *) alloca (length);
+  tmp_filename = (char *) alloca (length);
+  while (1)
     {
-      gcov_type global_id = gcov_read_counter ();
-      gcov_type call_count = gcov_read_counter ();
-
-      /* Note that global id counter may never have been set if no calls were
-	 made from this call-site.  */
-      if (counters[i] && global_id)
-        {
-          /* TODO race condition requires us do the following correction.  */
-          if (__gcov_is_gid_insane (counters[i]))
-            counters[i] = global_id;
-          else if (__gcov_is_gid_insane (global_id))
-            global_id = counters[i];
-
-          gcc_assert (counters[i] == global_id);
-        }
-      else if (global_id)
-	counters[i] = global_id;
-
-      counters[i + 1] += call_count;
-
-      /* Reset. */
-      if (__gcov_is_gid_insane (counters[i]))
-        counters[i] = counters[i + 1] = 0;
-
-      /* Assert that the invariant (global_id == 0) <==> (call_count == 0)
-	 holds true after merging.  */
-      if (counters[i] == 0)
-        counters[i+1] = 0;
-      if (counters[i + 1] == 0)
-        counters[i] = 0;
+      sprintf (spool_filename, "%s/%ld-%ld-%u%s", spool_dir,
+               (long) getpid (), (long) time (0), spool_seq++,
+               GCOV_SPOOL_SUFFIX);
+      sprintf (tmp_filename, "%s.tmp", spool_filename);
+      if (access (spool_filename, F_OK) == 0)
+        continue;
+      fd = open (tmp_filename, O_WRONLY | O_CREAT | O_EXCL, 0666);
+      if (fd >= 0 || errno != EEXIST)
+        break;
     }
-}
-#endif
-
-#ifdef L_gcov_merge_icall_topn
-/* The profile merging function used for merging indirect call counts
-   This function is given array COUNTERS of N_COUNTERS old counters and it
-   reads the same number of counters from the gcov file.  */
-
-void
-__gcov_merge_icall_topn (gcov_type *counters, unsigned n_counters)
-{
-  unsigned i, j, k, m;
+  if (fd < 0)
+    {
+      gcov_error ("profiling:%s:Cannot create spool file\n", tmp_filename);
+      return 0;
+    }
+  close (fd);
 
-  gcc_assert (!(n_counters % GCOV_ICALL_TOPN_NCOUNTS));
-  for (i = 0; i < n_counters; i += GCOV_ICALL_TOPN_NCOUNTS)
+  if (!gcov_open (tmp_filename))
     {
-      gcov_type *value_array = &counters[i + 1];
-      unsigned tmp_size = 2 * (GCOV_ICALL_TOPN_NCOUNTS - 1);
-      gcov_type *tmp_array 
-          = (gcov_type *) alloca (tmp_size * sizeof (gcov_type));
+      gcov_error ("profiling:%s:Cannot open\n", tmp_filename);
+      unlink (tmp_filename);
+      return 0;
+    }
 
-      for (j = 0; j < tmp_size; j++)
-        tmp_array[j] = 0;
+  gcov_rewrite ();
+  gcov_write_tag_length (GCOV_SPOOL_MAGIC, GCOV_VERSION);
+  for (gi_ptr = __gcov_list; gi_ptr; gi_ptr = gi_ptr->next)
+    {
+      unsigned fi_stride;
 
-      for (j = 0; j < GCOV_ICALL_TOPN_NCOUNTS - 1; j += 2)
-        {
-          tmp_array[j] = value_array[j];
-          tmp_array[j + 1] = value_array [j + 1];
-        }
+      memset (&this_object, 0, sizeof (this_object));
+      gcov_object_summary (gi_ptr, &this_object);
+      gcov_single_run_summary (gi_ptr, &object, &this_object);
+      gcov_single_run_summary (gi_ptr, &program, &this_program);
+      program.checksum = gcov_crc32;
 
-      /* Skip the number_of_eviction entry.  */
-      gcov_read_counter ();
-      for (k = 0; k < GCOV_ICALL_TOPN_NCOUNTS - 1; k += 2)
-        {
-          int found = 0;
-          gcov_type global_id = gcov_read_counter ();
-          gcov_type call_count = gcov_read_counter ();
-          for (m = 0; m < j; m += 2)
-            {
-              if (tmp_array[m] == global_id)
-                {
-                  found = 1;
-                  tmp_array[m + 1] += call_count;
-                  break;
-                }
-            }
-          if (!found)
-            {
-              tmp_array[j] = global_id;
-              tmp_array[j + 1] = call_count;
-              j += 2;
-            }
-        }
-      /* Now sort the temp array */
-      gcov_sort_n_vals (tmp_array, j);
+      fi_stride = gcov_compute_fi_stride (gcov_counter_array (gi_ptr, 0, 1));
 
-      /* Now copy back the top half of the temp array */
-      for (k = 0; k < GCOV_ICALL_TOPN_NCOUNTS - 1; k += 2)
-        {
-          value_array[k] = tmp_array[k];
-          value_array[k + 1] = tmp_array[k + 1];
-        }
-    }
-}
-#endif
+      GCOV_GET_FILENAME (prefix_length, gcov_prefix_strip, gi_ptr->filename,
+                         gi_filename_up);
+      gcov_write_tag_length (GCOV_TAG_SPOOL_OBJECT,
+                             gcov_string_length (gi_filename));
+      gcov_write_string (gi_filename);
 
+      gcov_write_gcda_counters (gi_ptr, fi_stride);
+      gcov_write_summary (GCOV_TAG_OBJECT_SUMMARY, &object);
+      gcov_write_summary (GCOV_TAG_PROGRAM_SUMMARY, &program);
 
-#ifdef L_gcov_merge_single
-/* The profile merging function for choosing the most common value.
-   It is given an array COUNTERS of N_COUNTERS old counters and it
-   reads the same number of counters from the gcov file.  The counters
-   are split into 3-tuples where the members of the tuple have
-   meanings:
-
-   -- the stored candidate on the most common value of the measured entity
-   -- counter
-   -- total number of evaluations of the value  */
-void
-__gcov_merge_single (gcov_type *counters, unsigned n_counters)
-{
-  unsigned i, n_measures;
-  gcov_type value, counter, all;
+      /* No module groups are computed here, so this is just the
+         module itself, for gcov-merge -l.  */
+      if (gi_ptr->mod_info->is_primary)
+        gcov_write_module_infos (gi_ptr);
+    }
+  gcov_write_unsigned (0);
 
-  gcc_assert (!(n_counters % 3));
-  n_measures = n_counters / 3;
-  for (i = 0; i < n_measures; i++, counters += 3)
+  if ((error = gcov_close ()))
     {
-      value = gcov_read_counter ();
-      counter = gcov_read_counter ();
-      all = gcov_read_counter ();
-
-      if (counters[0] == value)
-	counters[1] += counter;
-      else if (counter > counters[1])
-	{
-	  counters[0] = value;
-	  counters[1] = counter - counters[1];
-	}
-      else
-	counters[1] -= counter;
-      counters[2] += all;
+      gcov_error (error  < 0 ?  "profiling:%s:Overflow writing\n" :
+                  "profiling:%s:Error writing\n", tmp_filename);
+      unlink (tmp_filename);
+      return 0;
     }
-}
-#endif /* L_gcov_merge_single */
-
-#ifdef L_gcov_merge_delta
-/* The profile merging function for choosing the most common
-   difference between two consecutive evaluations of the value.  It is
-   given an array COUNTERS of N_COUNTERS old counters and it reads the
-   same number of counters from the gcov file.  The counters are split
-   into 4-tuples where the members of the tuple have meanings:
-
-   -- the last value of the measured entity
-   -- the stored candidate on the most common difference
-   -- counter
-   -- total number of evaluations of the value  */
-void
-__gcov_merge_delta (gcov_type *counters, unsigned n_counters)
-{
-  unsigned i, n_measures;
-  gcov_type value, counter, all;
-
-  gcc_assert (!(n_counters % 4));
-  n_measures = n_counters / 4;
-  for (i = 0; i < n_measures; i++, counters += 4)
+  if (rename (tmp_filename, spool_filename))
     {
-      /* last = */ gcov_read_counter ();
-      value = gcov_read_counter ();
-      counter = gcov_read_counter ();
-      all = gcov_read_counter ();
-
-      if (counters[1] == value)
-	counters[2] += counter;
-      else if (counter > counters[2])
-	{
-	  counters[1] = value;
-	  counters[2] = counter - counters[2];
-	}
-      else
-	counters[2] -= counter;
-      counters[3] += all;
+      gcov_error ("profiling:%s:Cannot rename spool file\n", tmp_filename);
+      unlink (tmp_filename);
+      return 0;
     }
+  return 1;
+#else
+  return 0;
+#endif
 }
-#endif /* L_gcov_merge_delta */
+#endif /* __GCOV_KERNEL__ */
+
+#endif /* L_gcov */
+
+#include "libgcov-merge.c"
+
+/* The _atomic variants of the value profilers below are used with
+   -fprofile-update=atomic.  They live in separate objects, so that
+   programs not using them do not depend on the __sync builtins of the
+   gcov type.  */
 
 #ifdef L_gcov_interval_profiler
 /* If VALUE is in interval <START, START + STEPS - 1>, then increases the
@@ -1488,6 +1358,23 @@ __gcov_interval_profiler (gcov_type *counters, gcov_type value,
 }
 #endif
 
+#ifdef L_gcov_interval_profiler_atomic
+/* Thread-safe variant of __gcov_interval_profiler.  */
+
+void
+__gcov_interval_profiler_atomic (gcov_type *counters, gcov_type value,
+				 int start, unsigned steps)
+{
+  gcov_type delta = value - start;
+  if (delta < 0)
+    __sync_fetch_and_add (&counters[steps + 1], 1);
+  else if (delta >= steps)
+    __sync_fetch_and_add (&counters[steps], 1);
+  else
+    __sync_fetch_and_add (&counters[delta], 1);
+}
+#endif
+
 #ifdef L_gcov_pow2_profiler
 /* If VALUE is a power of two, COUNTERS[1] is incremented.  Otherwise
    COUNTERS[0] is incremented.  */
@@ -1502,6 +1389,19 @@ __gcov_pow2_profiler (gcov_type *counters, gcov_type value)
 }
 #endif
 
+#ifdef L_gcov_pow2_profiler_atomic
+/* Thread-safe variant of __gcov_pow2_profiler.  */
+
+void
+__gcov_pow2_profiler_atomic (gcov_type *counters, gcov_type value)
+{
+  if (value & (value - 1))
+    __sync_fetch_and_add (&counters[0], 1);
+  else
+    __sync_fetch_and_add (&counters[1], 1);
+}
+#endif
+
 /* Tries to determine the most common value among its inputs.  Checks if the
    value stored in COUNTERS[0] matches VALUE.  If this is the case, COUNTERS[1]
    is incremented.  If this is not the case and COUNTERS[1] is not zero,
@@ -1510,24 +1410,42 @@ __gcov_pow2_profiler (gcov_type *counters, gcov_type value)
    function is called more than 50% of the time with one value, this value
    will be in COUNTERS[0] in the end.
 
-   In any case, COUNTERS[2] is incremented.  */
+   In any case, COUNTERS[2] is incremented.
+
+   If USE_ATOMIC is nonzero, the counters are updated atomically.  The
+   value and its counter are not updated as a pair, so the most common
+   value may be slightly off under contention, but COUNTERS[2] is
+   exact.  */
 
 static inline void
-__gcov_one_value_profiler_body (gcov_type *counters, gcov_type value)
+__gcov_one_value_profiler_body (gcov_type *counters, gcov_type value,
+				int use_atomic)
 {
   if (value == counters[0])
-    counters[1]++;
+    {
+      if (use_atomic)
+	__sync_fetch_and_add (&counters[1], 1);
+      else
+	counters[1]++;
+    }
   else if (counters[1] == 0)
     {
       counters[1] = 1;
       counters[0] = value;
     }
+  else if (use_atomic)
+    __sync_fetch_and_sub (&counters[1], 1);
   else
     counters[1]--;
-  counters[2]++;
+
+  if (use_atomic)
+    __sync_fetch_and_add (&counters[2], 1);
+  else
+    counters[2]++;
 }
 
-#ifdef L_gcov_indirect_call_topn_profiler
+#if defined(L_gcov_indirect_call_topn_profiler) \
+    || defined(L_gcov_indirect_call_topn_profiler_atomic)
 /* Tries to keep track the most frequent N values in the counters where
    N is specified by parameter TOPN_VAL. To track top N values, 2*N counter
    entries are used.
@@ -1537,11 +1455,14 @@ __gcov_one_value_profiler_body (gcov_type *counters, gcov_type value)
                   cleared.
    counter[1] through counter[2*N] records the top 2*N values collected so far.
    Each value is represented by two entries: count[2*i+1] is the ith value, and
-   count[2*i+2] is the number of times the value is seen.  */
+   count[2*i+2] is the number of times the value is seen.
+
+   If USE_ATOMIC is nonzero, counts of values already tracked are
+   incremented atomically.  */
 
 static void
-__gcov_topn_value_profiler_body (gcov_type *counters, gcov_type value,
-                                 gcov_unsigned_t topn_val)
+__gcov_topn_value_profiler_update (gcov_type *counters, gcov_type value,
+                                   gcov_unsigned_t topn_val, int use_atomic)
 {
    unsigned i, found = 0, have_zero_count = 0;
 
@@ -1557,7 +1478,10 @@ __gcov_topn_value_profiler_body (gcov_type *counters, gcov_type value,
        entry = &value_array[i];
        if ( entry[0] == value)
          {
-           entry[1]++ ;
+           if (use_atomic)
+             __sync_fetch_and_add (&entry[1], 1);
+           else
+             entry[1]++ ;
            found = 1;
            break;
          }
@@ -1627,17 +1551,63 @@ __gcov_topn_value_profiler_body (gcov_type *counters, gcov_type value,
          }
      }
 }
+
+/* Serializes the replacement of tracked values by the thread-safe
+   top N profiler.  */
+static int __gcov_topn_lock;
+
+/* Record VALUE in the top N value COUNTERS, see
+   __gcov_topn_value_profiler_update.  If USE_ATOMIC is nonzero, values
+   already tracked are counted without locking, while the rarer
+   replacement of tracked values is done under __gcov_topn_lock.  */
+
+static void
+__gcov_topn_value_profiler_body (gcov_type *counters, gcov_type value,
+                                 gcov_unsigned_t topn_val, int use_atomic)
+{
+  unsigned i;
+
+  if (!use_atomic)
+    {
+      __gcov_topn_value_profiler_update (counters, value, topn_val, 0);
+      return;
+    }
+
+  for (i = 0; i < (topn_val << 2); i += 2)
+    if (counters[i + 1] == value && counters[i + 2] != 0)
+      {
+        __sync_fetch_and_add (&counters[i + 2], 1);
+        return;
+      }
+
+  while (__sync_lock_test_and_set (&__gcov_topn_lock, 1))
+    continue;
+  /* Scan again under the lock; another thread may have added VALUE.  */
+  __gcov_topn_value_profiler_update (counters, value, topn_val, 1);
+  __sync_lock_release (&__gcov_topn_lock);
+}
 #endif
 
 #ifdef L_gcov_one_value_profiler
 void
 __gcov_one_value_profiler (gcov_type *counters, gcov_type value)
 {
-  __gcov_one_value_profiler_body (counters, value);
+  __gcov_one_value_profiler_body (counters, value, 0);
 }
 #endif
 
-#ifdef L_gcov_indirect_call_profiler
+#ifdef L_gcov_one_value_profiler_atomic
+/* Thread-safe variant of __gcov_one_value_profiler.  */
+
+void
+__gcov_one_value_profiler_atomic (gcov_type *counters, gcov_type value)
+{
+  __gcov_one_value_profiler_body (counters, value, 1);
+}
+#endif
+
+#if defined(L_gcov_indirect_call_profiler) \
+    || defined(L_gcov_indirect_call_profiler_atomic)
 
 /* By default, the C++ compiler will use function addresses in the
    vtable entries.  Setting TARGET_VTABLE_USES_DESCRIPTORS to nonzero
@@ -1656,6 +1626,7 @@ __gcov_one_value_profiler (gcov_type *counters, gcov_type value)
 #define VTABLE_USES_DESCRIPTORS 0
 #endif
 
+#ifdef L_gcov_indirect_call_profiler
 /* Tries to determine the most common value among its inputs. */
 void
 __gcov_indirect_call_profiler (gcov_type* counter, gcov_type value,
@@ -1667,12 +1638,27 @@ __gcov_indirect_call_profiler (gcov_type* counter, gcov_type value,
   if (cur_func == callee_func
       || (VTABLE_USES_DESCRIPTORS && callee_func
 	  && *(void **) cur_func == *(void **) callee_func))
-    __gcov_one_value_profiler_body (counter, value);
+    __gcov_one_value_profiler_body (counter, value, 0);
 }
 #endif
 
+#ifdef L_gcov_indirect_call_profiler_atomic
+/* Thread-safe variant of __gcov_indirect_call_profiler.  */
+void
+__gcov_indirect_call_profiler_atomic (gcov_type* counter, gcov_type value,
+				      void* cur_func, void* callee_func)
+{
+  if (cur_func == callee_func
+      || (VTABLE_USES_DESCRIPTORS && callee_func
+	  && *(void **) cur_func == *(void **) callee_func))
+    __gcov_one_value_profiler_body (counter, value, 1);
+}
+#endif
+#endif
 
-#ifdef L_gcov_indirect_call_topn_profiler
+
+#if defined(L_gcov_indirect_call_topn_profiler) \
+    || defined(L_gcov_indirect_call_topn_profiler_atomic)
 extern THREAD_PREFIX gcov_type *__gcov_indirect_call_topn_counters ATTRIBUTE_HIDDEN;
 extern THREAD_PREFIX void *__gcov_indirect_call_topn_callee ATTRIBUTE_HIDDEN;
 #ifdef TARGET_VTABLE_USES_DESCRIPTORS
@@ -1680,10 +1666,16 @@ extern THREAD_PREFIX void *__gcov_indirect_call_topn_callee ATTRIBUTE_HIDDEN;
 #else
 #define VTABLE_USES_DESCRIPTORS 0
 #endif
-void
-__gcov_indirect_call_topn_profiler (void *cur_func,
-                                    void *cur_module_gcov_info,
-                                    gcov_unsigned_t cur_func_id)
+
+/* Record the call of CUR_FUNC, function CUR_FUNC_ID of the module
+   CUR_MODULE_GCOV_INFO, in the top N indirect call counters if it is
+   the callee set up by the caller.  */
+
+static inline void
+__gcov_indirect_call_topn_profiler_body (void *cur_func,
+                                         void *cur_module_gcov_info,
+                                         gcov_unsigned_t cur_func_id,
+                                         int use_atomic)
 {
   void *callee_func = __gcov_indirect_call_topn_callee;
   gcov_type *counter = __gcov_indirect_call_topn_counters;
@@ -1697,11 +1689,35 @@ __gcov_indirect_call_topn_profiler (void *cur_func,
       gcov_type global_id 
           = ((struct gcov_info *) cur_module_gcov_info)->mod_info->ident;
       global_id = GEN_FUNC_GLOBAL_ID (global_id, cur_func_id);
-      __gcov_topn_value_profiler_body (counter, global_id, GCOV_ICALL_TOPN_VAL);
+      __gcov_topn_value_profiler_body (counter, global_id, GCOV_ICALL_TOPN_VAL,
+                                       use_atomic);
       __gcov_indirect_call_topn_callee = 0;
     }
 }
+#endif
 
+#ifdef L_gcov_indirect_call_topn_profiler
+void
+__gcov_indirect_call_topn_profiler (void *cur_func,
+                                    void *cur_module_gcov_info,
+                                    gcov_unsigned_t cur_func_id)
+{
+  __gcov_indirect_call_topn_profiler_body (cur_func, cur_module_gcov_info,
+                                           cur_func_id, 0);
+}
+#endif
+
+#ifdef L_gcov_indirect_call_topn_profiler_atomic
+/* Thread-safe variant of __gcov_indirect_call_topn_profiler.  */
+
+void
+__gcov_indirect_call_topn_profiler_atomic (void *cur_func,
+                                           void *cur_module_gcov_info,
+                                           gcov_unsigned_t cur_func_id)
+{
+  __gcov_indirect_call_topn_profiler_body (cur_func, cur_module_gcov_info,
+                                           cur_func_id, 1);
+}
 #endif
 
 #ifdef L_gcov_direct_call_profiler
@@ -1725,6 +1741,27 @@ __gcov_direct_call_profiler (void *cur_func,
 }
 #endif
 
+#ifdef L_gcov_direct_call_profiler_atomic
+extern THREAD_PREFIX gcov_type *__gcov_direct_call_counters ATTRIBUTE_HIDDEN;
+extern THREAD_PREFIX void *__gcov_direct_call_callee ATTRIBUTE_HIDDEN;
+/* Thread-safe variant of __gcov_direct_call_profiler.  */
+void
+__gcov_direct_call_profiler_atomic (void *cur_func,
+				    void *cur_module_gcov_info,
+				    gcov_unsigned_t cur_func_id)
+{
+  if (cur_func == __gcov_direct_call_callee)
+    {
+      gcov_type global_id 
+          = ((struct gcov_info *) cur_module_gcov_info)->mod_info->ident;
+      global_id = GEN_FUNC_GLOBAL_ID (global_id, cur_func_id);
+      __gcov_direct_call_counters[0] = global_id;
+      __sync_fetch_and_add (&__gcov_direct_call_counters[1], 1);
+      __gcov_direct_call_callee = 0;
+    }
+}
+#endif
+
 
 #ifdef L_gcov_average_profiler
 /* Increase corresponding COUNTER by VALUE.  FIXME: Perhaps we want
@@ -1738,6 +1775,17 @@ __gcov_average_profiler (gcov_type *counters, gcov_type value)
 }
 #endif
 
+#ifdef L_gcov_average_profiler_atomic
+/* Thread-safe variant of __gcov_average_profiler.  */
+
+void
+__gcov_average_profiler_atomic (gcov_type *counters, gcov_type value)
+{
+  __sync_fetch_and_add (&counters[0], value);
+  __sync_fetch_and_add (&counters[1], 1);
+}
+#endif
+
 #ifdef L_gcov_ior_profiler
 /* Increase corresponding COUNTER by VALUE.  FIXME: Perhaps we want
    to saturate up.  */
@@ -1749,6 +1797,16 @@ __gcov_ior_profiler (gcov_type *counters, gcov_type value)
 }
 #endif
 
+#ifdef L_gcov_ior_profiler_atomic
+/* Thread-safe variant of __gcov_ior_profiler.  */
+
+void
+__gcov_ior_profiler_atomic (gcov_type *counters, gcov_type value)
+{
+  __sync_fetch_and_or (counters, value);
+}
+#endif
+
 #ifdef L_gcov_fork
 /* A wrapper for the fork function.  Flushes the accumulated profiling data, so
    that they are not counted twice.  */
@@ -34,6 +34,8 @@ along with GCC; see the file COPYING3.  If not see
 #include "target.h"
 #include "output.h"
 #include "regs.h"
+#include "expr.h"
+#include "optabs.h"
 #include "function.h"
 #include "basic-block.h"
 #include "diagnostic-core.h"
@@ -57,6 +59,9 @@ along with GCC; see the file COPYING3.  If not see
 /* Number of statements inserted for each edge counter increment.  */
 #define EDGE_COUNTER_STMT_COUNT 3
 
+/* Likewise with -fprofile-update=atomic.  */
+#define EDGE_COUNTER_ATOMIC_STMT_COUNT 1
+
 static GTY(()) tree gcov_type_node;
 static GTY(()) tree gcov_type_tmp_var;
 static GTY(()) tree tree_interval_profiler_fn;
@@ -67,6 +72,7 @@ static GTY(()) tree tree_indirect_call_topn_profiler_fn;
 static GTY(()) tree tree_direct_call_profiler_fn;
 static GTY(()) tree tree_average_profiler_fn;
 static GTY(()) tree tree_ior_profiler_fn;
+static GTY(()) tree gcov_atomic_add_fn;
 
 
 static GTY(()) tree ic_void_ptr_var;
@@ -269,11 +275,14 @@ add_sampling_to_edge_counters (void)
         if (is_instrumentation_to_be_sampled (stmt))
           {
             gimple stmt_end;
-            int i;
+            int i, stmt_count;
             /* The code for edge counter increment has EDGE_COUNTER_STMT_COUNT
                gimple statements. Advance that many statements to find the
                last statement.  */
-            for (i = 0; i < EDGE_COUNTER_STMT_COUNT - 1; i++)
+            stmt_count = (flag_profile_update == PROFILE_UPDATE_ATOMIC
+                          ? EDGE_COUNTER_ATOMIC_STMT_COUNT
+                          : EDGE_COUNTER_STMT_COUNT);
+            for (i = 0; i < stmt_count - 1; i++)
               gsi_next (&gsi);
             stmt_end = gsi_stmt (gsi);
             gcc_assert (stmt_end);
@@ -336,6 +345,34 @@ gimple_init_instrumentation_sampling (void)
     }
 }
 
+/* Return true if counters of gcov type can be updated atomically on
+   the target without resorting to library calls.  */
+
+static bool
+profile_update_atomic_supported_p (void)
+{
+  enum machine_mode mode = mode_for_size (GCOV_TYPE_SIZE, MODE_INT, 0);
+
+  if (!built_in_decls[GCOV_TYPE_SIZE > 32
+                      ? BUILT_IN_FETCH_AND_ADD_8 : BUILT_IN_FETCH_AND_ADD_4])
+    return false;
+  return (direct_optab_handler (sync_add_optab, mode) != CODE_FOR_nothing
+          || (direct_optab_handler (sync_compare_and_swap_optab, mode)
+              != CODE_FOR_nothing));
+}
+
+/* Build the decl of the libgcov value profiler NAME with type TYPE.
+   With -fprofile-update=atomic, the thread-safe variant NAME_atomic
+   is used instead.  */
+
+static tree
+build_profiler_fn_decl (const char *name, tree type)
+{
+  if (flag_profile_update == PROFILE_UPDATE_ATOMIC)
+    name = ACONCAT ((name, "_atomic", NULL));
+  return build_fn_decl (name, type);
+}
+
 void
 gimple_init_edge_profiler (void)
 {
@@ -361,6 +398,21 @@ gimple_init_edge_profiler (void)
       DECL_EXTERNAL (gcov_info_decl) = 1;
       TREE_ADDRESSABLE (gcov_info_decl) = 1;
 
+      if (flag_profile_update == PROFILE_UPDATE_ATOMIC)
+        {
+          if (profile_update_atomic_supported_p ())
+            gcov_atomic_add_fn
+              = built_in_decls[GCOV_TYPE_SIZE > 32
+                               ? BUILT_IN_FETCH_AND_ADD_8
+                               : BUILT_IN_FETCH_AND_ADD_4];
+          else
+            {
+              warning (0, "target does not support atomic profile update, "
+                       "single mode is selected");
+              flag_profile_update = PROFILE_UPDATE_SINGLE;
+            }
+        }
+
       /* void (*) (gcov_type *, gcov_type, int, unsigned)  */
       interval_profiler_fn_type
 	      = build_function_type_list (void_type_node,
@@ -368,8 +420,8 @@ gimple_init_edge_profiler (void)
 					  integer_type_node,
 					  unsigned_type_node, NULL_TREE);
       tree_interval_profiler_fn
-	      = build_fn_decl ("__gcov_interval_profiler",
-				     interval_profiler_fn_type);
+	      = build_profiler_fn_decl ("__gcov_interval_profiler",
+					interval_profiler_fn_type);
       TREE_NOTHROW (tree_interval_profiler_fn) = 1;
       DECL_ATTRIBUTES (tree_interval_profiler_fn)
 	= tree_cons (get_identifier ("leaf"), NULL,
@@ -380,8 +432,8 @@ gimple_init_edge_profiler (void)
 	      = build_function_type_list (void_type_node,
 					  gcov_type_ptr, gcov_type_node,
 					  NULL_TREE);
-      tree_pow2_profiler_fn = build_fn_decl ("__gcov_pow2_profiler",
-						   pow2_profiler_fn_type);
+      tree_pow2_profiler_fn = build_profiler_fn_decl ("__gcov_pow2_profiler",
+						      pow2_profiler_fn_type);
       TREE_NOTHROW (tree_pow2_profiler_fn) = 1;
       DECL_ATTRIBUTES (tree_pow2_profiler_fn)
 	= tree_cons (get_identifier ("leaf"), NULL,
@@ -393,8 +445,8 @@ gimple_init_edge_profiler (void)
 					  gcov_type_ptr, gcov_type_node,
 					  NULL_TREE);
       tree_one_value_profiler_fn
-	      = build_fn_decl ("__gcov_one_value_profiler",
-				     one_value_profiler_fn_type);
+	      = build_profiler_fn_decl ("__gcov_one_value_profiler",
+					one_value_profiler_fn_type);
       TREE_NOTHROW (tree_one_value_profiler_fn) = 1;
       DECL_ATTRIBUTES (tree_one_value_profiler_fn)
 	= tree_cons (get_identifier ("leaf"), NULL,
@@ -409,8 +461,8 @@ gimple_init_edge_profiler (void)
                                       ptr_void,
                                       ptr_void, NULL_TREE);
       tree_indirect_call_profiler_fn
-	      = build_fn_decl ("__gcov_indirect_call_profiler",
-				     ic_profiler_fn_type);
+	      = build_profiler_fn_decl ("__gcov_indirect_call_profiler",
+					ic_profiler_fn_type);
       TREE_NOTHROW (tree_indirect_call_profiler_fn) = 1;
       DECL_ATTRIBUTES (tree_indirect_call_profiler_fn)
 	= tree_cons (get_identifier ("leaf"), NULL,
@@ -421,8 +473,8 @@ gimple_init_edge_profiler (void)
 	= build_function_type_list (void_type_node, ptr_void, ptr_void,
 				    get_gcov_unsigned_t (), NULL_TREE);
       tree_indirect_call_topn_profiler_fn
-	      = build_fn_decl ("__gcov_indirect_call_topn_profiler",
-                               ic_topn_profiler_fn_type);
+	      = build_profiler_fn_decl ("__gcov_indirect_call_topn_profiler",
+					ic_topn_profiler_fn_type);
       TREE_NOTHROW (tree_indirect_call_topn_profiler_fn) = 1;
       DECL_ATTRIBUTES (tree_indirect_call_topn_profiler_fn)
 	= tree_cons (get_identifier ("leaf"), NULL,
@@ -433,8 +485,8 @@ gimple_init_edge_profiler (void)
 	= build_function_type_list (void_type_node, ptr_void, ptr_void,
 				    get_gcov_unsigned_t (), NULL_TREE);
       tree_direct_call_profiler_fn
-	= build_fn_decl ("__gcov_direct_call_profiler",
-			 dc_profiler_fn_type);
+	= build_profiler_fn_decl ("__gcov_direct_call_profiler",
+				  dc_profiler_fn_type);
       TREE_NOTHROW (tree_direct_call_profiler_fn) = 1;
       DECL_ATTRIBUTES (tree_direct_call_profiler_fn)
 	= tree_cons (get_identifier ("leaf"), NULL,
@@ -445,15 +497,15 @@ gimple_init_edge_profiler (void)
 	      = build_function_type_list (void_type_node,
 					  gcov_type_ptr, gcov_type_node, NULL_TREE);
       tree_average_profiler_fn
-	      = build_fn_decl ("__gcov_average_profiler",
-				     average_profiler_fn_type);
+	      = build_profiler_fn_decl ("__gcov_average_profiler",
+					average_profiler_fn_type);
       TREE_NOTHROW (tree_average_profiler_fn) = 1;
       DECL_ATTRIBUTES (tree_average_profiler_fn)
 	= tree_cons (get_identifier ("leaf"), NULL,
 		     DECL_ATTRIBUTES (tree_average_profiler_fn));
       tree_ior_profiler_fn
-	      = build_fn_decl ("__gcov_ior_profiler",
-				     average_profiler_fn_type);
+	      = build_profiler_fn_decl ("__gcov_ior_profiler",
+					average_profiler_fn_type);
       TREE_NOTHROW (tree_ior_profiler_fn) = 1;
       DECL_ATTRIBUTES (tree_ior_profiler_fn)
 	= tree_cons (get_identifier ("leaf"), NULL,
@@ -472,7 +524,10 @@ gimple_init_edge_profiler (void)
 
 /* Output instructions as GIMPLE trees to increment the edge
    execution count, and insert them on E.  We rely on
-   gsi_insert_on_edge to preserve the order.  */
+   gsi_insert_on_edge to preserve the order.  With
+   -fprofile-update=atomic the counter is incremented with a single
+   __sync_fetch_and_add, so that concurrent threads do not lose
+   updates.  */
 
 void
 gimple_gen_edge_profiler (int edgeno, edge e)
@@ -480,6 +535,18 @@ gimple_gen_edge_profiler (int edgeno, edge e)
   tree ref, one;
   gimple stmt1, stmt2, stmt3;
 
+  if (flag_profile_update == PROFILE_UPDATE_ATOMIC)
+    {
+      tree addr = tree_coverage_counter_addr (GCOV_COUNTER_ARCS, edgeno);
+
+      one = build_int_cst (gcov_type_node, 1);
+      stmt1 = gimple_build_call (gcov_atomic_add_fn, 2, addr, one);
+      if (flag_profile_generate_sampling)
+        pointer_set_insert (instrumentation_to_be_sampled, stmt1);
+      gsi_insert_on_edge (e, stmt1);
+      return;
+    }
+
   /* We share one temporary variable declaration per function.  This
      gets re-set in tree_profiling.  */
   if (gcov_type_tmp_var == NULL_TREE)
@@ -2649,6 +2649,237 @@ maybe_lto_object_file (const char *prog_name)
   return false;
 }
 
+/* Return true if NAME is the symbol that marks an LTO object.  */
+
+static bool
+is_lto_marker (const char *name)
+{
+  if (name[0] == '_' && name[1] == '_' && name[2] == '_')
+    name++;
+  return strcmp (name, "__gnu_lto_v1") == 0;
+}
+
+/* Add the symbol NAME of PROG_NAME to the constructor, destructor and
+   frame table lists as FILTER and WHICH_PASS say.  */
+
+static void
+scan_symbol (const char *prog_name, const char *name, scanpass which_pass,
+	     scanfilter filter)
+{
+#ifdef USE_INITFINI_ARRAY
+  /* The objects register their constructors and destructors in
+     .init_array and .fini_array, or in .ctors and .dtors, which the
+     linker and crtstuff run; collecting them as well would run them
+     twice.  Frame tables are still collected.  */
+  filter &= ~(SCAN_CTOR | SCAN_DTOR);
+#endif
+
+  switch (is_ctor_dtor (name))
+    {
+    case SYM_CTOR:
+      if (! (filter & SCAN_CTOR))
+	break;
+      if (which_pass != PASS_LIB)
+	add_to_list (&constructors, name);
+      break;
+
+    case SYM_DTOR:
+      if (! (filter & SCAN_DTOR))
+	break;
+      if (which_pass != PASS_LIB)
+	add_to_list (&destructors, name);
+      break;
+
+    case SYM_INIT:
+      if (! (filter & SCAN_INIT))
+	break;
+      if (which_pass != PASS_LIB)
+	fatal_error ("init function found in object %s", prog_name);
+#ifndef LD_INIT_SWITCH
+      add_to_list (&constructors, name);
+#endif
+      break;
+
+    case SYM_FINI:
+      if (! (filter & SCAN_FINI))
+	break;
+      if (which_pass != PASS_LIB)
+	fatal_error ("fini function found in object %s", prog_name);
+#ifndef LD_FINI_SWITCH
+      add_to_list (&destructors, name);
+#endif
+      break;
+
+    case SYM_DWEH:
+      if (! (filter & SCAN_DWEH))
+	break;
+      if (which_pass != PASS_LIB)
+	add_to_list (&frame_tables, name);
+      break;
+
+    default:			/* not a constructor or destructor */
+      break;
+    }
+}
+
+/* Fetch the SIZE byte integer at P in an ELF file, which is big-endian
+   if BIG_ENDIAN.  */
+
+static unsigned HOST_WIDE_INT
+elf_get (const unsigned char *p, int size, bool big_endian)
+{
+  unsigned HOST_WIDE_INT val = 0;
+  int i;
+
+  for (i = 0; i < size; i++)
+    val |= ((unsigned HOST_WIDE_INT) p[big_endian ? i : size - 1 - i]
+	    << (8 * (size - 1 - i)));
+  return val;
+}
+
+/* Read SIZE bytes at OFFSET in F into a new buffer.  Return NULL if
+   the file is too short.  */
+
+static unsigned char *
+elf_read (FILE *f, unsigned HOST_WIDE_INT offset,
+	  unsigned HOST_WIDE_INT size)
+{
+  unsigned char *buf;
+
+  if ((long) offset < 0 || (size_t) size != size
+      || fseek (f, (long) offset, SEEK_SET) != 0)
+    return NULL;
+  buf = XNEWVEC (unsigned char, size + 1);
+  if (fread (buf, 1, size, f) != size)
+    {
+      free (buf);
+      return NULL;
+    }
+  return buf;
+}
+
+/* Scan the symbol table of PROG_NAME as scan_prog_file does, if it is
+   an ELF file, by reading it directly rather than running nm.  This
+   saves a process for each of the objects of an LTO link.  Return
+   false if PROG_NAME is not an ELF file we can read, in which case
+   nothing has been scanned.  */
+
+static bool
+scan_elf_file (const char *prog_name, scanpass which_pass,
+	       scanfilter filter)
+{
+  unsigned char ehdr[64];
+  unsigned char *shdrs;
+  unsigned HOST_WIDE_INT shoff;
+  unsigned int shentsize, shnum, symsize, i;
+  bool is64, big_endian, ok;
+  FILE *f;
+
+  f = fopen (prog_name, "rb");
+  if (f == NULL)
+    return false;
+  if (fread (ehdr, 1, sizeof ehdr, f) < 52
+      || memcmp (ehdr, "\177ELF", 4) != 0
+      || (ehdr[4] != 1 && ehdr[4] != 2)
+      || (ehdr[5] != 1 && ehdr[5] != 2))
+    {
+      fclose (f);
+      return false;
+    }
+
+  /* The offsets below are those of the fields of Elf32_Ehdr, Elf32_Shdr
+     and Elf32_Sym, or of their 64-bit equivalents.  */
+  is64 = ehdr[4] == 2;
+  big_endian = ehdr[5] == 2;
+  shoff = elf_get (ehdr + (is64 ? 40 : 32), is64 ? 8 : 4, big_endian);
+  shentsize = elf_get (ehdr + (is64 ? 58 : 46), 2, big_endian);
+  shnum = elf_get (ehdr + (is64 ? 60 : 48), 2, big_endian);
+  symsize = is64 ? 24 : 16;
+
+  /* Leave files with more sections than the header can count, and
+     anything unexpected, to nm.  */
+  if (shnum == 0 || shentsize < (is64 ? 64U : 40U))
+    {
+      fclose (f);
+      return false;
+    }
+  shdrs = elf_read (f, shoff, (unsigned HOST_WIDE_INT) shnum * shentsize);
+  ok = shdrs != NULL;
+
+  if (debug && ok)
+    fprintf (stderr, "\nsymbols of %s:\n", prog_name);
+
+  for (i = 0; ok && i < shnum; i++)
+    {
+      const unsigned char *sh = shdrs + i * shentsize;
+      const unsigned char *strsh;
+      unsigned HOST_WIDE_INT symoff, symcount, stroff, strsize, k;
+      unsigned int link;
+      unsigned char *syms, *strtab;
+
+      /* SHT_SYMTAB.  */
+      if (elf_get (sh + 4, 4, big_endian) != 2)
+	continue;
+
+      symoff = elf_get (sh + (is64 ? 24 : 16), is64 ? 8 : 4, big_endian);
+      symcount = (elf_get (sh + (is64 ? 32 : 20), is64 ? 8 : 4, big_endian)
+		  / symsize);
+      link = elf_get (sh + (is64 ? 40 : 24), 4, big_endian);
+      if (link >= shnum)
+	{
+	  ok = false;
+	  break;
+	}
+      strsh = shdrs + link * shentsize;
+      stroff = elf_get (strsh + (is64 ? 24 : 16), is64 ? 8 : 4, big_endian);
+      strsize = elf_get (strsh + (is64 ? 32 : 20), is64 ? 8 : 4, big_endian);
+
+      syms = elf_read (f, symoff, symcount * symsize);
+      strtab = elf_read (f, stroff, strsize);
+      if (syms == NULL || strtab == NULL)
+	{
+	  free (syms);
+	  free (strtab);
+	  ok = false;
+	  break;
+	}
+      strtab[strsize] = '\0';
+
+      for (k = 0; k < symcount; k++)
+	{
+	  const unsigned char *sym = syms + k * symsize;
+	  unsigned HOST_WIDE_INT name = elf_get (sym, 4, big_endian);
+	  unsigned int shndx = elf_get (sym + (is64 ? 6 : 14), 2, big_endian);
+
+	  /* nm does not list undefined symbols as candidates either.  */
+	  if (shndx == 0 || name >= strsize || strtab[name] == '\0')
+	    continue;
+
+	  if (debug)
+	    fprintf (stderr, "\t%s\n", strtab + name);
+
+	  if (which_pass == PASS_LTOINFO)
+	    {
+	      if (is_lto_marker ((const char *) strtab + name))
+		{
+		  add_lto_object (&lto_objects, prog_name);
+		  break;
+		}
+	    }
+	  else
+	    scan_symbol (prog_name, (const char *) strtab + name,
+			 which_pass, filter);
+	}
+
+      free (syms);
+      free (strtab);
+    }
+
+  free (shdrs);
+  fclose (f);
+  return ok;
+}
+
 /* Generic version to scan the name list of the loaded program for
    the symbols g++ uses for static constructors and destructors.  */
 
@@ -2679,6 +2910,9 @@ scan_prog_file (const char *prog_name, scanpass which_pass,
   if (which_pass == PASS_LTOINFO && !maybe_lto_object_file (prog_name))
     return;
 
+  if (scan_elf_file (prog_name, which_pass, filter))
+    return;
+
   /* If we do not have an `nm', complain.  */
   if (nm_file_name == 0)
     fatal_error ("cannot find 'nm'");
@@ -2792,52 +3026,7 @@ scan_prog_file (const char *prog_name, scanpass which_pass,
 
 
       *end = '\0';
-      switch (is_ctor_dtor (name))
-	{
-	case SYM_CTOR:
-	  if (! (filter & SCAN_CTOR))
-	    break;
-	  if (which_pass != PASS_LIB)
-	    add_to_list (&constructors, name);
-	  break;
-
-	case SYM_DTOR:
-	  if (! (filter & SCAN_DTOR))
-	    break;
-	  if (which_pass != PASS_LIB)
-	    add_to_list (&destructors, name);
-	  break;
-
-	case SYM_INIT:
-	  if (! (filter & SCAN_INIT))
-	    break;
-	  if (which_pass != PASS_LIB)
-	    fatal_error ("init function found in object %s", prog_name);
-#ifndef LD_INIT_SWITCH
-	  add_to_list (&constructors, name);
-#endif
-	  break;
-
-	case SYM_FINI:
-	  if (! (filter & SCAN_FINI))
-	    break;
-	  if (which_pass != PASS_LIB)
-	    fatal_error ("fini function found in object %s", prog_name);
-#ifndef LD_FINI_SWITCH
-	  add_to_list (&destructors, name);
-#endif
-	  break;
-
-	case SYM_DWEH:
-	  if (! (filter & SCAN_DWEH))
-	    break;
-	  if (which_pass != PASS_LIB)
-	    add_to_list (&frame_tables, name);
-	  break;
-
-	default:		/* not a constructor or destructor */
-	  continue;
-	}
+      scan_symbol (prog_name, name, which_pass, filter);
     }
 
   if (debug)
@@ -0,0 +1,687 @@
+/* Compile server for the compiler proper.
+   Copyright (C) 2012 Free Software Foundation, Inc.
+
+This file is part of GCC.
+
+GCC is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation; either version 3, or (at your option) any later
+version.
+
+GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with GCC; see the file COPYING3.  If not see
+<http://www.gnu.org/licenses/>.  */
+
+/* A compiler started as "cc1 -fcompile-server=SOCKET" initializes
+   itself as far as that does not depend on the options, then listens
+   on the Unix socket SOCKET.  A driver run with GCC_COMPILE_SERVER set
+   to SOCKET sends it the compiler commands it would otherwise run.  For
+   each command the server forks from its initialized state, so the
+   command skips exec, dynamic linking and the option independent part
+   of start-up, and shares that state copy-on-write with the server.
+
+   The forked process gets the standard input, output and error, the
+   working directory, the umask and the environment of the driver, and
+   it parses the options of the command as a newly started compiler
+   would, so the output is the same as without the server.  The server
+   runs commands with its own privileges, so it only accepts commands
+   from processes of its own user, and SOCKET should be in a directory
+   only that user can access.  If the driver goes away while its
+   command runs, the server kills the command.
+
+   The driver connects to SOCKET and sends one byte with its standard
+   descriptors attached, then the arguments, the working directory, the
+   umask and the environment.  A string is its length followed by its
+   bytes, a vector is its length followed by its strings, and numbers
+   are unsigned ints in host byte order.  The server replies with
+   COMPILE_SERVER_RAN followed by the wait status of the command, or
+   with COMPILE_SERVER_REFUSED if the command is for another program.  */
+
+/* A compiler started as "cc1 -fbatch=FILE" forks from the same point
+   for each line of FILE in turn, and runs it as a command line of its
+   own, so that a build system can compile many translation units with
+   one compiler process.  Each line is split into arguments as in an
+   @file.  The exit status is that of failure if any command failed.  */
+
+#include "config.h"
+#include "system.h"
+#include "coretypes.h"
+#include "diagnostic-core.h"
+#include "compile-server.h"
+
+#ifdef HAVE_WORKING_FORK
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#endif
+
+#if defined (HAVE_WORKING_FORK) && defined (SCM_RIGHTS)
+
+extern char **environ;
+
+#define COMPILE_SERVER_REFUSED 0
+#define COMPILE_SERVER_RAN 1
+
+/* Limits on the size of a command.  */
+#define COMPILE_SERVER_MAX_STRING (1 << 20)
+#define COMPILE_SERVER_MAX_VECTOR (1 << 16)
+
+/* Do not get SIGPIPE when the other side has gone away.  */
+#ifdef MSG_NOSIGNAL
+#define COMPILE_SERVER_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define COMPILE_SERVER_SEND_FLAGS 0
+#endif
+
+/* How to find out the user of the process at the other end of a
+   connection.  Without a way, the server cannot tell who sends it
+   commands, and refuses to start.  */
+#if defined (SO_PEERCRED)
+#define COMPILE_SERVER_PEER_UID 1
+#elif defined (LOCAL_PEERCRED)
+#define COMPILE_SERVER_PEER_UID 2
+#else
+#define COMPILE_SERVER_PEER_UID 0
+#endif
+
+/* The file of the compiler the server runs commands for, and its name.  */
+static struct stat server_program;
+static const char *server_program_name;
+
+/* Write the SIZE bytes at BUF to the socket FD.  Return false on
+   failure.  */
+
+static bool
+write_all (int fd, const void *buf, size_t size)
+{
+  const char *p = (const char *) buf;
+
+  while (size > 0)
+    {
+      ssize_t n = send (fd, p, size, COMPILE_SERVER_SEND_FLAGS);
+
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n <= 0)
+	return false;
+      p += n;
+      size -= n;
+    }
+
+  return true;
+}
+
+/* Read SIZE bytes from the socket FD to BUF.  Return false on failure
+   or end of file.  */
+
+static bool
+read_all (int fd, void *buf, size_t size)
+{
+  char *p = (char *) buf;
+
+  while (size > 0)
+    {
+      ssize_t n = read (fd, p, size);
+
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n <= 0)
+	return false;
+      p += n;
+      size -= n;
+    }
+
+  return true;
+}
+
+/* Write VAL to FD.  */
+
+static bool
+write_unsigned (int fd, unsigned int val)
+{
+  return write_all (fd, &val, sizeof val);
+}
+
+/* Read an unsigned int from FD to *VAL.  */
+
+static bool
+read_unsigned (int fd, unsigned int *val)
+{
+  return read_all (fd, val, sizeof *val);
+}
+
+/* Write the string STR to FD.  */
+
+static bool
+write_string (int fd, const char *str)
+{
+  unsigned int len = strlen (str);
+
+  return write_unsigned (fd, len) && write_all (fd, str, len);
+}
+
+/* Read a string from FD to *STR, allocated with malloc.  The process
+   reading exits on failure, so nothing is freed then.  */
+
+static bool
+read_string (int fd, char **str)
+{
+  unsigned int len;
+
+  if (!read_unsigned (fd, &len) || len > COMPILE_SERVER_MAX_STRING)
+    return false;
+
+  *str = XNEWVEC (char, len + 1);
+  (*str)[len] = '\0';
+  return read_all (fd, *str, len);
+}
+
+/* Write the NULL terminated vector VEC to FD.  */
+
+static bool
+write_vector (int fd, const char *const *vec)
+{
+  unsigned int i, n;
+
+  for (n = 0; vec[n]; n++)
+    ;
+
+  if (!write_unsigned (fd, n))
+    return false;
+  for (i = 0; i < n; i++)
+    if (!write_string (fd, vec[i]))
+      return false;
+
+  return true;
+}
+
+/* Read a vector from FD to *VEC, allocated with malloc and NULL
+   terminated, and store its length in *N.  */
+
+static bool
+read_vector (int fd, char ***vec, unsigned int *n)
+{
+  unsigned int i;
+
+  if (!read_unsigned (fd, n) || *n > COMPILE_SERVER_MAX_VECTOR)
+    return false;
+
+  *vec = XNEWVEC (char *, *n + 1);
+  for (i = 0; i < *n; i++)
+    if (!read_string (fd, &(*vec)[i]))
+      return false;
+  (*vec)[*n] = NULL;
+
+  return true;
+}
+
+/* Control message buffer for the three standard descriptors.  */
+
+union std_fds_control
+{
+  struct cmsghdr align;
+  char buf[CMSG_SPACE (3 * sizeof (int))];
+};
+
+/* Send one byte to FD with the standard input, output and error
+   attached.  */
+
+static bool
+send_std_fds (int fd)
+{
+  static const int std_fds[3] = { 0, 1, 2 };
+  union std_fds_control control;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  char byte = 0;
+  ssize_t n;
+
+  memset (&msg, 0, sizeof msg);
+  iov.iov_base = &byte;
+  iov.iov_len = 1;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof control.buf;
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof std_fds);
+  memcpy (CMSG_DATA (cmsg), std_fds, sizeof std_fds);
+
+  while ((n = sendmsg (fd, &msg, COMPILE_SERVER_SEND_FLAGS)) < 0
+	 && errno == EINTR)
+    ;
+
+  return n == 1;
+}
+
+/* Receive the byte sent by send_std_fds from FD, and store the
+   descriptors attached to it in FDS.  */
+
+static bool
+receive_std_fds (int fd, int fds[3])
+{
+  union std_fds_control control;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  char byte;
+  ssize_t n;
+
+  memset (&msg, 0, sizeof msg);
+  iov.iov_base = &byte;
+  iov.iov_len = 1;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof control.buf;
+
+  while ((n = recvmsg (fd, &msg, 0)) < 0 && errno == EINTR)
+    ;
+  if (n != 1)
+    return false;
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  if (cmsg == NULL
+      || cmsg->cmsg_level != SOL_SOCKET
+      || cmsg->cmsg_type != SCM_RIGHTS
+      || cmsg->cmsg_len != CMSG_LEN (3 * sizeof (int)))
+    return false;
+
+  memcpy (fds, CMSG_DATA (cmsg), 3 * sizeof (int));
+  return true;
+}
+
+/* Set up ADDR for the socket NAME.  Return false if NAME is too long.  */
+
+static bool
+make_address (const char *name, struct sockaddr_un *addr)
+{
+  if (strlen (name) >= sizeof addr->sun_path)
+    return false;
+
+  memset (addr, 0, sizeof *addr);
+  addr->sun_family = AF_UNIX;
+  strcpy (addr->sun_path, name);
+  return true;
+}
+
+/* Run the command ARGV on the compile server listening on the socket
+   NAME, and store its wait status in *STATUS.  Return false if there
+   is no such server or it cannot run ARGV.  A command whose status is
+   lost because the server went away is reported as not run, so the
+   caller runs it again itself.  */
+
+bool
+compile_server_run (const char *name, const char *const *argv, int *status)
+{
+  struct sockaddr_un addr;
+  const char *cwd;
+  unsigned int reply, wait_status;
+  mode_t mask;
+  bool ok;
+  int fd;
+
+  if (!make_address (name, &addr))
+    return false;
+
+  cwd = getpwd ();
+  if (cwd == NULL)
+    return false;
+
+  fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return false;
+  if (connect (fd, (struct sockaddr *) &addr, sizeof addr) < 0)
+    {
+      close (fd);
+      return false;
+    }
+
+  mask = umask (0);
+  umask (mask);
+
+  ok = (send_std_fds (fd)
+	&& write_vector (fd, argv)
+	&& write_string (fd, cwd)
+	&& write_unsigned (fd, mask)
+	&& write_vector (fd, CONST_CAST2 (const char *const *, char **,
+					  environ))
+	&& read_unsigned (fd, &reply)
+	&& reply == COMPILE_SERVER_RAN
+	&& read_unsigned (fd, &wait_status));
+  close (fd);
+
+  if (ok)
+    *status = (int) wait_status;
+  return ok;
+}
+
+/* Return true if the process at the other end of the connection CONN
+   runs as the same user as the server.  */
+
+static bool
+peer_is_own_user (int conn)
+{
+#if COMPILE_SERVER_PEER_UID == 1
+  struct ucred cred;
+  socklen_t len = sizeof cred;
+
+  return (getsockopt (conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0
+	  && len == sizeof cred
+	  && cred.uid == geteuid ());
+#elif COMPILE_SERVER_PEER_UID == 2
+  uid_t uid;
+  gid_t gid;
+
+  return getpeereid (conn, &uid, &gid) == 0 && uid == geteuid ();
+#else
+  return false;
+#endif
+}
+
+/* Wait for the process PID, which runs the command sent on the
+   connection CONN, and return its wait status.  The driver sends
+   nothing more once it has sent the command, so CONN becoming readable
+   means that the driver has gone away; PID is then killed, so that it
+   does not go on writing the outputs of a cancelled compilation.
+   DONE is the read end of a pipe whose write end only PID holds, so
+   that it becomes readable when PID exits.  */
+
+static int
+wait_for_command (int conn, int done, pid_t pid)
+{
+  struct pollfd fds[2];
+  bool killed = false;
+  int status;
+
+  fds[0].fd = done;
+  fds[0].events = POLLIN;
+  fds[1].fd = conn;
+  fds[1].events = POLLIN;
+  while (!killed)
+    {
+      if (poll (fds, 2, -1) < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  break;
+	}
+      if (fds[0].revents)
+	break;
+      if (fds[1].revents)
+	{
+	  kill (pid, SIGKILL);
+	  killed = true;
+	}
+    }
+
+  while (waitpid (pid, &status, 0) < 0)
+    if (errno != EINTR)
+      _exit (FATAL_EXIT_CODE);
+  return status;
+}
+
+/* Handle the command sent on the connection CONN, in a process of its
+   own.  Only returns in the process forked to run the command, with
+   *ARGCP and *ARGVP set to its arguments.  */
+
+static void
+handle_command (int conn, int *argcp, char ***argvp)
+{
+  char **argv, **env, *cwd;
+  unsigned int argc, envc, mask;
+  struct stat st;
+  int fds[3], done[2], status, i;
+  bool run;
+  pid_t pid;
+
+  if (!peer_is_own_user (conn))
+    {
+      write_unsigned (conn, COMPILE_SERVER_REFUSED);
+      _exit (SUCCESS_EXIT_CODE);
+    }
+
+  if (!receive_std_fds (conn, fds))
+    _exit (FATAL_EXIT_CODE);
+  if (!read_vector (conn, &argv, &argc)
+      || argc == 0
+      || !read_string (conn, &cwd)
+      || !read_unsigned (conn, &mask)
+      || !read_vector (conn, &env, &envc))
+    _exit (FATAL_EXIT_CODE);
+
+  /* Only run commands for the server's compiler, under the name it
+     was started with, so that diagnostics name the same program.  */
+  run = (chdir (cwd) == 0
+	 && stat (argv[0], &st) == 0
+	 && st.st_dev == server_program.st_dev
+	 && st.st_ino == server_program.st_ino
+	 && strcmp (lbasename (argv[0]),
+		    lbasename (server_program_name)) == 0
+	 && pipe (done) == 0);
+  pid = run ? fork () : -1;
+  if (pid < 0)
+    {
+      write_unsigned (conn, COMPILE_SERVER_REFUSED);
+      _exit (SUCCESS_EXIT_CODE);
+    }
+
+  if (pid == 0)
+    {
+      close (conn);
+      close (done[0]);
+      /* Keep the write end of the pipe clear of the standard
+	 descriptors.  */
+      if (done[1] < 3)
+	done[1] = fcntl (done[1], F_DUPFD, 3);
+      for (i = 0; i < 3; i++)
+	dup2 (fds[i], i);
+      for (i = 0; i < 3; i++)
+	if (fds[i] >= 3)
+	  close (fds[i]);
+      umask (mask);
+      environ = env;
+      *argcp = argc;
+      *argvp = argv;
+      return;
+    }
+
+  close (done[1]);
+  for (i = 0; i < 3; i++)
+    close (fds[i]);
+  status = wait_for_command (conn, done[0], pid);
+
+  write_unsigned (conn, COMPILE_SERVER_RAN);
+  write_unsigned (conn, (unsigned int) status);
+  _exit (SUCCESS_EXIT_CODE);
+}
+
+/* Serve commands on the socket NAME for the compiler PROGRAM.  Only
+   returns in a process forked for a command, with *ARGCP and *ARGVP
+   set to the arguments of the command.  */
+
+void
+compile_server_serve (const char *name, const char *program,
+		      int *argcp, char ***argvp)
+{
+  struct sockaddr_un addr;
+  struct stat st;
+  int fd;
+
+  /* PROGRAM is compared with the programs of the commands, so it must
+     not be subject to a search of PATH.  */
+  if (lbasename (program) == program)
+    fatal_error ("%s must be started by file name to serve compile commands",
+		 program);
+  if (stat (program, &server_program) != 0)
+    fatal_error ("cannot find %s: %m", program);
+  server_program_name = program;
+  if (!COMPILE_SERVER_PEER_UID)
+    fatal_error ("compile servers are not supported on this host");
+
+  if (!make_address (name, &addr))
+    fatal_error ("compile server socket name %s is too long", name);
+
+  fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    fatal_error ("cannot create compile server socket: %m");
+  /* Replace the socket of an earlier server, but nothing else.  */
+  if (lstat (name, &st) == 0 && S_ISSOCK (st.st_mode))
+    unlink (name);
+  if (bind (fd, (struct sockaddr *) &addr, sizeof addr) < 0
+      || listen (fd, SOMAXCONN) < 0)
+    fatal_error ("cannot listen on %s: %m", name);
+
+  for (;;)
+    {
+      int conn = accept (fd, NULL, NULL);
+      pid_t pid;
+
+      /* Reap the processes of finished commands.  */
+      while (waitpid (-1, NULL, WNOHANG) > 0)
+	;
+
+      if (conn < 0)
+	{
+	  if (errno == EINTR || errno == ECONNABORTED)
+	    continue;
+	  fatal_error ("cannot accept compile commands on %s: %m", name);
+	}
+
+      /* If the fork fails, closing CONN makes the driver run the
+	 command itself.  */
+      pid = fork ();
+      if (pid == 0)
+	{
+	  close (fd);
+	  handle_command (conn, argcp, argvp);
+	  return;
+	}
+      close (conn);
+    }
+}
+
+#else /* !HAVE_WORKING_FORK || !SCM_RIGHTS */
+
+bool
+compile_server_run (const char *name ATTRIBUTE_UNUSED,
+		    const char *const *argv ATTRIBUTE_UNUSED,
+		    int *status ATTRIBUTE_UNUSED)
+{
+  return false;
+}
+
+void
+compile_server_serve (const char *name ATTRIBUTE_UNUSED,
+		      const char *program ATTRIBUTE_UNUSED,
+		      int *argcp ATTRIBUTE_UNUSED,
+		      char ***argvp ATTRIBUTE_UNUSED)
+{
+  fatal_error ("compile servers are not supported on this host");
+}
+
+#endif /* HAVE_WORKING_FORK && SCM_RIGHTS */
+
+#ifdef HAVE_WORKING_FORK
+
+/* Run the command lines in the file LIST one after the other, each
+   in a process forked for it, as the compiler PROGRAM.  Only returns
+   in a forked process, with *ARGCP and *ARGVP set to the arguments of
+   its command line; the batch process itself exits when all commands
+   have run.  */
+
+void
+compile_server_batch (const char *list, const char *program,
+		      int *argcp, char ***argvp)
+{
+  FILE *f;
+  char *buf, *line, *next;
+  size_t size, len;
+  bool failed = false;
+
+  f = fopen (list, "r");
+  if (f == NULL)
+    fatal_error ("cannot open batch file %s: %m", list);
+  size = 4096;
+  len = 0;
+  buf = XNEWVEC (char, size);
+  while ((len += fread (buf + len, 1, size - len - 1, f)) == size - 1)
+    {
+      size *= 2;
+      buf = XRESIZEVEC (char, buf, size);
+    }
+  if (ferror (f))
+    fatal_error ("cannot read batch file %s: %m", list);
+  fclose (f);
+  buf[len] = '\0';
+
+  for (line = buf; *line; line = next)
+    {
+      char **args;
+      int nargs, status;
+      pid_t pid;
+
+      next = strchr (line, '\n');
+      if (next)
+	*next++ = '\0';
+      else
+	next = line + strlen (line);
+
+      args = buildargv (line);
+      if (args == NULL || args[0] == NULL)
+	{
+	  freeargv (args);
+	  continue;
+	}
+      nargs = 0;
+      while (args[nargs])
+	nargs++;
+
+      fflush (stdout);
+      fflush (stderr);
+      pid = fork ();
+      if (pid < 0)
+	fatal_error ("cannot fork: %m");
+      if (pid == 0)
+	{
+	  char **argv = XNEWVEC (char *, nargs + 2);
+
+	  argv[0] = xstrdup (program);
+	  memcpy (argv + 1, args, (nargs + 1) * sizeof (char *));
+	  *argcp = nargs + 1;
+	  *argvp = argv;
+	  return;
+	}
+
+      freeargv (args);
+      while (waitpid (pid, &status, 0) < 0)
+	if (errno != EINTR)
+	  fatal_error ("cannot wait for batch command: %m");
+      if (!WIFEXITED (status) || WEXITSTATUS (status) != SUCCESS_EXIT_CODE)
+	failed = true;
+    }
+
+  exit (failed ? FATAL_EXIT_CODE : SUCCESS_EXIT_CODE);
+}
+
+#else /* !HAVE_WORKING_FORK */
+
+void
+compile_server_batch (const char *list ATTRIBUTE_UNUSED,
+		      const char *program ATTRIBUTE_UNUSED,
+		      int *argcp ATTRIBUTE_UNUSED,
+		      char ***argvp ATTRIBUTE_UNUSED)
+{
+  fatal_error ("batch compilation is not supported on this host");
+}
+
+#endif /* HAVE_WORKING_FORK */
@@ -0,0 +1,50 @@
+/* Compile server for the compiler proper.
+   Copyright (C) 2012 Free Software Foundation, Inc.
+
+This file is part of GCC.
+
+GCC is free software; you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free
+Software Foundation; either version 3, or (at your option) any later
+version.
+
+GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License
+along with GCC; see the file COPYING3.  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#ifndef GCC_COMPILE_SERVER_H
+#define GCC_COMPILE_SERVER_H
+
+/* The option that starts a compiler as a compile server.  */
+#define COMPILE_SERVER_OPTION "-fcompile-server="
+
+/* The option that makes a compiler run a batch of command lines.  */
+#define COMPILE_BATCH_OPTION "-fbatch="
+
+/* The environment variable that tells the driver which server to use.  */
+#define COMPILE_SERVER_ENV "GCC_COMPILE_SERVER"
+
+/* Run the command ARGV on the compile server listening on the socket
+   NAME, and store its wait status in *STATUS.  Return false if there
+   is no such server or it cannot run ARGV.  */
+extern bool compile_server_run (const char *name, const char *const *argv,
+				int *status);
+
+/* Serve jobs on the socket NAME for the compiler PROGRAM.  Only returns
+   in a process forked for a job, with *ARGCP and *ARGVP set to the
+   arguments of the job.  */
+extern void compile_server_serve (const char *name, const char *program,
+				  int *argcp, char ***argvp);
+
+/* Run the command lines in the file LIST, each in a process forked
+   for it, as the compiler PROGRAM.  Only returns in a forked process,
+   with *ARGCP and *ARGVP set to the arguments of its command line.  */
+extern void compile_server_batch (const char *list, const char *program,
+				  int *argcp, char ***argvp);
+
+#endif /* ! GCC_COMPILE_SERVER_H */
@@ -530,6 +530,25 @@ coverage_compute_lineno_checksum (void)
   return chksum;
 }
 
+/* Compute the profile ID of function N, by which the indirect call
+   profiler records call targets.  The ID of a public function depends on
+   its assembler name only, so every unit of the program computes the same
+   ID for it and can resolve targets defined in other units.  The ID of a
+   local function also depends on the unit defining it.  */
+
+unsigned
+coverage_compute_profile_id (struct cgraph_node *n)
+{
+  unsigned chksum = 0;
+
+  if (!TREE_PUBLIC (n->decl))
+    chksum = coverage_checksum_string (chksum, main_input_filename);
+  chksum = coverage_checksum_string
+    (chksum, IDENTIFIER_POINTER (DECL_ASSEMBLER_NAME (n->decl)));
+
+  return chksum;
+}
+
 /* Compute cfg checksum for the current function.
    The checksum is calculated carefully so that
    source code changes that doesn't affect the control flow graph
@@ -39,6 +39,9 @@ extern unsigned coverage_compute_cfg_checksum (void);
 /* Compute the line number checksum for the current function.  */
 extern unsigned coverage_compute_lineno_checksum (void);
 
+/* Compute the profile ID of a function.  */
+extern unsigned coverage_compute_profile_id (struct cgraph_node *);
+
 /* Allocate some counters. Repeatable per function.  */
 extern int coverage_counter_alloc (unsigned /*counter*/, unsigned/*num*/);
 /* Use a counter from the most recent allocation.  */
@@ -46,6 +46,8 @@ compilation is specified by a string called a "spec".  */
 #include "params.h"
 #include "vec.h"
 #include "filenames.h"
+#include "hashtab.h"
+#include "compile-server.h"
 
 /* By default there is no special suffix for target executables.  */
 /* FIXME: when autoconf is fixed, remove the host check - dj */
@@ -146,6 +148,10 @@ static enum save_temps {
 static char *save_temps_prefix = 0;
 static size_t save_temps_length = 0;
 
+/* The socket of the compile server to run the compiler on, from the
+   environment variable GCC_COMPILE_SERVER, or NULL.  */
+static const char *compile_server_socket;
+
 /* The compiler version.  */
 
 static const char *compiler_version;
@@ -200,6 +206,7 @@ static void putenv_from_prefixes (const struct path_prefix *, const char *,
 				  bool);
 static int access_check (const char *, int);
 static char *find_a_file (const struct path_prefix *, const char *, int, bool);
+static void clear_file_lookup_cache (void);
 static void add_prefix (struct path_prefix *, const char *, const char *,
 			int, int, int);
 static void add_sysrooted_prefix (struct path_prefix *, const char *,
@@ -2345,14 +2352,80 @@ file_at_path (char *path, void *data)
   return NULL;
 }
 
-/* Search for NAME using the prefix list PREFIXES.  MODE is passed to
-   access to check permissions.  If DO_MULTI is true, search multilib
-   paths then non-multilib paths, otherwise do not search multilib paths.
-   Return 0 if not found, otherwise return its name, allocated with malloc.  */
+/* The driver looks up the same few names (cc1, as, collect2, the
+   startfiles and libraries named in the specs) for every input file,
+   and each lookup probes every directory of a prefix list.  The result
+   of each lookup, including failure, is remembered here until the
+   prefix lists or the multilib directories change.  */
+
+struct file_lookup
+{
+  const struct path_prefix *pprefix;
+  const char *name;
+  int mode;
+  bool do_multi;
+
+  /* The file found, or NULL.  */
+  char *result;
+};
+
+static htab_t file_lookup_cache;
+
+/* Hash function for file_lookup_cache.  */
+
+static hashval_t
+file_lookup_hash (const void *p)
+{
+  const struct file_lookup *lookup = (const struct file_lookup *) p;
+  hashval_t h = htab_hash_string (lookup->name);
+
+  h = iterative_hash_object (lookup->pprefix, h);
+  h = iterative_hash_object (lookup->mode, h);
+  return h + lookup->do_multi;
+}
+
+/* Equality function for file_lookup_cache.  */
+
+static int
+file_lookup_eq (const void *p1, const void *p2)
+{
+  const struct file_lookup *l1 = (const struct file_lookup *) p1;
+  const struct file_lookup *l2 = (const struct file_lookup *) p2;
+
+  return (l1->pprefix == l2->pprefix
+	  && l1->mode == l2->mode
+	  && l1->do_multi == l2->do_multi
+	  && strcmp (l1->name, l2->name) == 0);
+}
+
+/* Free an entry of file_lookup_cache.  */
+
+static void
+file_lookup_del (void *p)
+{
+  struct file_lookup *lookup = (struct file_lookup *) p;
+
+  free (CONST_CAST (char *, lookup->name));
+  free (lookup->result);
+  free (lookup);
+}
+
+/* Forget the results of earlier lookups, because a prefix list or the
+   multilib directories changed.  */
+
+static void
+clear_file_lookup_cache (void)
+{
+  if (file_lookup_cache)
+    htab_empty (file_lookup_cache);
+}
+
+/* Search for NAME using the prefix list PREFIXES, without looking at
+   file_lookup_cache.  Arguments and result are as for find_a_file.  */
 
 static char *
-find_a_file (const struct path_prefix *pprefix, const char *name, int mode,
-	     bool do_multi)
+find_a_file_1 (const struct path_prefix *pprefix, const char *name, int mode,
+	       bool do_multi)
 {
   struct file_at_path_info info;
 
@@ -2387,6 +2460,42 @@ find_a_file (const struct path_prefix *pprefix, const char *name, int mode,
 				file_at_path, &info);
 }
 
+/* Search for NAME using the prefix list PREFIXES.  MODE is passed to
+   access to check permissions.  If DO_MULTI is true, search multilib
+   paths then non-multilib paths, otherwise do not search multilib paths.
+   Return 0 if not found, otherwise return its name, allocated with malloc.  */
+
+static char *
+find_a_file (const struct path_prefix *pprefix, const char *name, int mode,
+	     bool do_multi)
+{
+  struct file_lookup key, *lookup;
+  void **slot;
+
+  if (!file_lookup_cache)
+    file_lookup_cache = htab_create (31, file_lookup_hash, file_lookup_eq,
+				     file_lookup_del);
+
+  key.pprefix = pprefix;
+  key.name = name;
+  key.mode = mode;
+  key.do_multi = do_multi;
+  slot = htab_find_slot (file_lookup_cache, &key, INSERT);
+  if (*slot)
+    {
+      lookup = (struct file_lookup *) *slot;
+      return lookup->result ? xstrdup (lookup->result) : NULL;
+    }
+
+  lookup = XNEW (struct file_lookup);
+  *lookup = key;
+  lookup->name = xstrdup (name);
+  lookup->result = find_a_file_1 (pprefix, name, mode, do_multi);
+  *slot = lookup;
+
+  return lookup->result ? xstrdup (lookup->result) : NULL;
+}
+
 /* Ranking of prefixes in the sort list. -B prefixes are put before
    all others.  */
 
@@ -2439,6 +2548,8 @@ add_prefix (struct path_prefix *pprefix, const char *prefix,
   /* Insert after PREV.  */
   pl->next = (*prev);
   (*prev) = pl;
+
+  clear_file_lookup_cache ();
 }
 
 /* Same as add_prefix, but prepending target_system_root to prefix.  */
@@ -2496,6 +2607,8 @@ execute (void)
   const char *arg;
 
   struct command *commands;	/* each command buffer with above info.  */
+  bool served;			/* whether the compile server ran it.  */
+  int served_status;
 
   gcc_assert (!processing_spec_function);
 
@@ -2652,15 +2765,30 @@ execute (void)
     }
 #endif
 
+  /* A single command may be run by the compile server, which refuses
+     it unless it is the server's compiler.  */
+
+  served = (n_commands == 1
+	    && compile_server_socket
+	    && !report_times && !report_times_to_file
+	    && compile_server_run (compile_server_socket, commands[0].argv,
+				   &served_status));
+  if (served && commands[0].argv[0] != commands[0].prog)
+    free (CONST_CAST (char *, commands[0].argv[0]));
+
   /* Run each piped subprocess.  */
 
-  pex = pex_init (PEX_USE_PIPES | ((report_times || report_times_to_file)
-				   ? PEX_RECORD_TIMES : 0),
-		  progname, temp_filename);
-  if (pex == NULL)
-    fatal_error ("pex_init failed: %m");
+  pex = NULL;
+  if (!served)
+    {
+      pex = pex_init (PEX_USE_PIPES | ((report_times || report_times_to_file)
+				       ? PEX_RECORD_TIMES : 0),
+		      progname, temp_filename);
+      if (pex == NULL)
+	fatal_error ("pex_init failed: %m");
+    }
 
-  for (i = 0; i < n_commands; i++)
+  for (i = 0; i < n_commands && !served; i++)
     {
       const char *errmsg;
       int err;
@@ -2696,17 +2824,23 @@ execute (void)
     int ret_code = 0;
 
     statuses = (int *) alloca (n_commands * sizeof (int));
-    if (!pex_get_status (pex, n_commands, statuses))
-      fatal_error ("failed to get exit status: %m");
-
-    if (report_times || report_times_to_file)
+    if (served)
+      statuses[0] = served_status;
+    else
       {
-	times = (struct pex_time *) alloca (n_commands * sizeof (struct pex_time));
-	if (!pex_get_times (pex, n_commands, times))
-	  fatal_error ("failed to get process times: %m");
-      }
+	if (!pex_get_status (pex, n_commands, statuses))
+	  fatal_error ("failed to get exit status: %m");
+
+	if (report_times || report_times_to_file)
+	  {
+	    times = (struct pex_time *) alloca (n_commands
+						* sizeof (struct pex_time));
+	    if (!pex_get_times (pex, n_commands, times))
+	      fatal_error ("failed to get process times: %m");
+	  }
 
-    pex_free (pex);
+	pex_free (pex);
+      }
 
     for (i = 0; i < n_commands; ++i)
       {
@@ -3411,6 +3545,7 @@ driver_handle_option (struct gcc_options *opts,
       break;
 
     case OPT_pipe:
+    case OPT_no_pipe:
       validated = true;
       /* These options set the variables specified in common.opt
 	 automatically, but do need to be saved for spec
@@ -3858,7 +3993,7 @@ process_command (unsigned int decoded_options_count,
       save_temps_prefix = NULL;
     }
 
-  if (save_temps_flag && use_pipes)
+  if (save_temps_flag && use_pipes > 0)
     {
       /* -save-temps overrides -pipe, so that temp files are produced */
       if (save_temps_flag)
@@ -3887,6 +4022,26 @@ process_command (unsigned int decoded_options_count,
       gcc_assert (!compare_debug_opt);
     }
 
+  compile_server_socket = getenv (COMPILE_SERVER_ENV);
+  if (compile_server_socket && !*compile_server_socket)
+    compile_server_socket = NULL;
+
+  /* Unless -pipe or -no-pipe was given, pass the assembler output of
+     the compiler to the assembler through a pipe instead of a temporary
+     file whenever that is known to work: the assembler is GNU as, which
+     reads standard input, and no temporary files are to be kept or
+     compared.  A compile server only runs the compiler on its own, so
+     do not pipe when there is one.  */
+  if (use_pipes < 0)
+    {
+#if HAVE_GNU_AS
+      use_pipes = (!save_temps_flag && !compare_debug
+		   && !compile_server_socket);
+#else
+      use_pipes = 0;
+#endif
+    }
+
   /* Set up the search paths.  We add directories that we expect to
      contain GNU Toolchain components before directories specified by
      the machine description so that we will find GNU components (like
@@ -6255,6 +6410,7 @@ main (int argc, char **argv)
   machine_suffix = concat (spec_machine, dir_separator_str,
 			   spec_version, dir_separator_str, NULL);
   just_machine_suffix = concat (spec_machine, dir_separator_str, NULL);
+  clear_file_lookup_cache ();
 
   specs_file = find_a_file (&startfile_prefixes, "specs", R_OK, true);
   /* Read the specs file unless it is a default one.  */
@@ -7536,6 +7692,8 @@ set_multilib_dir (void)
     }
   else if (multilib_dir != NULL && multilib_os_dir == NULL)
     multilib_os_dir = multilib_dir;
+
+  clear_file_lookup_cache ();
 }
 
 /* Print out the multiple library subdirectory selection
@@ -67,10 +67,9 @@ gcc_init_libintl (void)
 
 #if defined HAVE_LANGINFO_CODESET
   locale_encoding = nl_langinfo (CODESET);
-  if (locale_encoding != NULL
-      && (!strcasecmp (locale_encoding, "utf-8")
-	  || !strcasecmp (locale_encoding, "utf8")))
-    locale_utf8 = true;
+  locale_utf8 = (locale_encoding != NULL
+		 && (!strcasecmp (locale_encoding, "utf-8")
+		     || !strcasecmp (locale_encoding, "utf8")));
 #endif
 
   if (!strcmp (open_quote, "`") && !strcmp (close_quote, "'"))
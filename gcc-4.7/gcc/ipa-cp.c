@@ -2289,8 +2289,16 @@ decide_whether_version_node (struct cgraph_node *node)
 	    continue;
 
 	  if (dump_file)
-	    fprintf (dump_file, "  Creating a specialized node of %s/%i.\n",
-		     cgraph_node_name (node), node->uid);
+	    {
+	      fprintf (dump_file, "  Creating a specialized node of %s/%i "
+		       "for value ", cgraph_node_name (node), node->uid);
+	      print_ipcp_constant_value (dump_file, val->value);
+	      fprintf (dump_file, " (time benefit: %i, size cost: %i, "
+		       "callers: %i, count: " HOST_WIDEST_INT_PRINT_DEC ").\n",
+		       val->local_time_benefit + val->prop_time_benefit,
+		       val->local_size_cost + val->prop_size_cost,
+		       caller_count, (HOST_WIDEST_INT) count_sum);
+	    }
 
 	  callers = gather_edges_for_value (val, caller_count);
 	  kv = VEC_copy (tree, heap, known_csts);
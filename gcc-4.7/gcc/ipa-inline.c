@@ -734,10 +734,12 @@ relative_time_benefit (struct inline_summary *callee_info,
    smallest badness are inlined first.  After each inlining is performed
    the costs of all caller edges of nodes affected are recomputed so the
    metrics may accurately depend on values such as number of inlinable callers
-   of the function or function body size.  */
+   of the function or function body size.
+
+   Only to be called via edge_badness.  */
 
 static int
-edge_badness (struct cgraph_edge *edge, bool dump)
+do_edge_badness (struct cgraph_edge *edge, bool dump)
 {
   gcov_type badness;
   int growth, time_growth;
@@ -890,6 +892,34 @@ edge_badness (struct cgraph_edge *edge, bool dump)
     return badness;
 }
 
+/* Return badness of EDGE, using the cached value when it is known.
+   The badness depends on the edge growth estimates, the callee's time
+   and the profile of EDGE, so the cache is reset whenever one of those
+   changes.  When DUMP is set, always recompute and dump the metrics.  */
+
+static int
+edge_badness (struct cgraph_edge *edge, bool dump)
+{
+  struct edge_growth_cache_entry *entry;
+  int badness;
+
+  if (!edge_growth_cache)
+    return do_edge_badness (edge, dump);
+
+  if ((int)VEC_length (edge_growth_cache_entry, edge_growth_cache)
+      <= edge->uid)
+    VEC_safe_grow_cleared (edge_growth_cache_entry, heap, edge_growth_cache,
+			   cgraph_edge_max_uid);
+  entry = VEC_index (edge_growth_cache_entry, edge_growth_cache, edge->uid);
+  if (entry->badness_known && !dump)
+    return entry->badness;
+
+  badness = do_edge_badness (edge, dump);
+  entry->badness = badness;
+  entry->badness_known = true;
+  return badness;
+}
+
 /* Recompute badness of EDGE and update its key in HEAP if needed.  */
 static inline void
 update_edge_key (fibheap_t heap, struct cgraph_edge *edge)
@@ -991,6 +1021,23 @@ reset_edge_caches (struct cgraph_node *node)
       }
 }
 
+/* Recompute HEAP node of EDGE, or remove EDGE from HEAP when it is no
+   longer an inline candidate.  */
+
+static void
+update_edge_candidate (fibheap_t heap, struct cgraph_edge *edge)
+{
+  if (can_inline_edge_p (edge, false)
+      && want_inline_small_function_p (edge, false))
+    update_edge_key (heap, edge);
+  else if (edge->aux)
+    {
+      report_inline_failed_reason (edge);
+      fibheap_delete_node (heap, (fibnode_t) edge->aux);
+      edge->aux = NULL;
+    }
+}
+
 /* Recompute HEAP nodes for each of caller of NODE.
    UPDATED_NODES track nodes we already visited, to avoid redundant work.
    When CHECK_INLINABLITY_FOR is set, re-check for specified edge that
@@ -1024,17 +1071,7 @@ update_caller_keys (fibheap_t heap, struct cgraph_node *node,
       {
         if (!check_inlinablity_for
 	    || check_inlinablity_for == edge)
-	  {
-	    if (can_inline_edge_p (edge, false)
-		&& want_inline_small_function_p (edge, false))
-	      update_edge_key (heap, edge);
-	    else if (edge->aux)
-	      {
-		report_inline_failed_reason (edge);
-		fibheap_delete_node (heap, (fibnode_t) edge->aux);
-		edge->aux = NULL;
-	      }
-	  }
+	  update_edge_candidate (heap, edge);
 	else if (edge->aux)
 	  update_edge_key (heap, edge);
       }
@@ -1068,17 +1105,7 @@ update_callee_keys (fibheap_t heap, struct cgraph_node *node,
 	    && inline_summary (callee)->inlinable
 	    && cgraph_function_body_availability (callee) >= AVAIL_AVAILABLE
 	    && !bitmap_bit_p (updated_nodes, callee->uid))
-	  {
-	    if (can_inline_edge_p (e, false)
-		&& want_inline_small_function_p (e, false))
-	      update_edge_key (heap, e);
-	    else if (e->aux)
-	      {
-		report_inline_failed_reason (e);
-		fibheap_delete_node (heap, (fibnode_t) e->aux);
-		e->aux = NULL;
-	      }
-	  }
+	  update_edge_candidate (heap, e);
 	if (e->next_callee)
 	  e = e->next_callee;
 	else
@@ -1095,12 +1122,18 @@ update_callee_keys (fibheap_t heap, struct cgraph_node *node,
       }
 }
 
-/* Recompute heap nodes for each of caller edges of each of callees.
-   Walk recursively into all inline clones.  */
+/* Recompute heap nodes for each uninlined call in NODE after NODE was
+   inlined or had calls inlined into it.  Walk recursively into all inline
+   clones.
+
+   Only the calls of NODE themselves need to be revisited.  The badness of
+   the other calls of the same callees depends on their own growth estimates,
+   the callee's time and their own profile, none of which changed, so their
+   cached keys stay valid.  This keeps the cost of an update proportional to
+   the size of NODE rather than to the number of callers of its callees.  */
 
 static void
-update_all_callee_keys (fibheap_t heap, struct cgraph_node *node,
-			bitmap updated_nodes)
+update_all_callee_keys (fibheap_t heap, struct cgraph_node *node)
 {
   struct cgraph_edge *e = node->callees;
   if (!e)
@@ -1110,14 +1143,22 @@ update_all_callee_keys (fibheap_t heap, struct cgraph_node *node,
       e = e->callee->callees;
     else
       {
+	enum availability avail;
 	struct cgraph_node *callee = cgraph_function_or_thunk_node (e->callee,
-								    NULL);
+								    &avail);
 
 	/* We inlined and thus callees might have different number of calls.
 	   Reset their caches  */
         reset_node_growth_cache (callee);
-	if (e->inline_failed)
-	  update_caller_keys (heap, callee, updated_nodes, e);
+	if (e->inline_failed
+	    && (callee->alias || inline_summary (callee)->inlinable)
+	    && avail > AVAIL_OVERWRITABLE
+	    && !callee->global.inlined_to)
+	  {
+	    /* Cloning for inlining scales the count of E.  */
+	    reset_edge_badness_cache (e);
+	    update_edge_candidate (heap, e);
+	  }
 	if (e->next_callee)
 	  e = e->next_callee;
 	else
@@ -1396,7 +1437,9 @@ inline_small_functions (void)
       struct cgraph_node *where, *callee;
       int badness = fibheap_min_key (heap);
       int current_badness;
+#ifdef ENABLE_CHECKING
       int cached_badness;
+#endif
       int growth;
 
       edge = (struct cgraph_edge *) fibheap_extract_min (heap);
@@ -1405,18 +1448,23 @@ inline_small_functions (void)
       if (!edge->inline_failed)
 	continue;
 
-      /* Be sure that caches are maintained consistent.  
-         We can not make this ENABLE_CHECKING only because it cause differnt
-         updates of the fibheap queue.  */
+      /* Be sure that caches are maintained consistent.  The badness of
+	 EDGE is normally taken from the cache; recomputing it from scratch
+	 for every extracted edge costs as much as the whole update of the
+	 heap, so do it only when checking.  */
+#ifdef ENABLE_CHECKING
       cached_badness = edge_badness (edge, false);
       reset_edge_growth_cache (edge);
+#endif
       reset_node_growth_cache (edge->callee);
 
       /* When updating the edge costs, we only decrease badness in the keys.
 	 Increases of badness are handled lazilly; when we see key with out
 	 of date value on it, we re-insert it now.  */
       current_badness = edge_badness (edge, false);
+#ifdef ENABLE_CHECKING
       gcc_assert (cached_badness == current_badness);
+#endif
       gcc_assert (current_badness >= badness);
       if (current_badness != badness)
 	{
@@ -1486,7 +1534,7 @@ inline_small_functions (void)
 	     at once. Consequently we need to update all callee keys.  */
 	  if (flag_indirect_inlining)
 	    add_new_edges_to_heap (heap, new_indirect_edges);
-          update_all_callee_keys (heap, where, updated_nodes);
+          update_all_callee_keys (heap, where);
 	}
       else
 	{
@@ -1534,7 +1582,7 @@ inline_small_functions (void)
 	     thus we need to recompute everything all the time.  Once this is
 	     solved, "|| 1" should go away.  */
 	  if (callee->global.inlined_to || 1)
-	    update_all_callee_keys (heap, callee, updated_nodes);
+	    update_all_callee_keys (heap, callee);
 	  else
 	    update_callee_keys (heap, edge->callee, updated_nodes);
 	}
@@ -149,6 +149,12 @@ extern VEC(inline_edge_summary_t,heap) *inline_edge_summary_vec;
 typedef struct edge_growth_cache_entry
 {
   int time, size;
+
+  /* Badness of the edge as computed by the inliner, valid only when
+     BADNESS_KNOWN is set.  It is derived from TIME and SIZE and thus
+     invalidated together with them.  */
+  int badness;
+  bool badness_known;
 } edge_growth_cache_entry;
 DEF_VEC_O(edge_growth_cache_entry);
 DEF_VEC_ALLOC_O(edge_growth_cache_entry,heap);
@@ -263,7 +269,17 @@ reset_edge_growth_cache (struct cgraph_edge *edge)
 {
   if ((int)VEC_length (edge_growth_cache_entry, edge_growth_cache) > edge->uid)
     {
-      struct edge_growth_cache_entry zero = {0, 0};
+      struct edge_growth_cache_entry zero = {0, 0, 0, false};
       VEC_replace (edge_growth_cache_entry, edge_growth_cache, edge->uid, &zero);
     }
 }
+
+/* Reset cached badness for EDGE, keeping its growth estimates.  */
+
+static inline void
+reset_edge_badness_cache (struct cgraph_edge *edge)
+{
+  if ((int)VEC_length (edge_growth_cache_entry, edge_growth_cache) > edge->uid)
+    VEC_index (edge_growth_cache_entry, edge_growth_cache,
+	       edge->uid)->badness_known = false;
+}
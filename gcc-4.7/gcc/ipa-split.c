@@ -73,7 +73,13 @@ along with GCC; see the file COPYING3.  If not see
    5) Support splitting of nested functions.
    6) Support non-SSA arguments.  
    7) There is nothing preventing us from producing multiple parts of single function
-      when needed or splitting also the parts.  */
+      when needed or splitting also the parts.
+
+   With profile feedback, regions that are never executed are split too,
+   even from functions that are not partial inlining candidates, and up to
+   PARAM_MAX_SPLIT_REGIONS of them per function.  Their parts are placed in
+   the unlikely executed text section, so that the hot code of the function
+   is packed densely and its body becomes smaller for the inliner.  */
 
 #include "config.h"
 #include "system.h"
@@ -135,6 +141,10 @@ struct split_point best_split_point;
 
 static bitmap forbidden_dominators;
 
+/* True when only regions that are never executed may be split.  */
+
+static bool cold_regions_only;
+
 static tree find_retval (basic_block return_bb);
 
 /* Callback for walk_stmt_load_store_addr_ops.  If T is non-SSA automatic
@@ -184,6 +194,16 @@ dump_split_point (FILE * file, struct split_point *current)
   dump_bitmap (file, current->ssa_names_to_pass);
 }
 
+/* Return true if profile feedback shows the region split at CURRENT to be
+   never executed.  */
+
+static bool
+cold_split_point_p (struct split_point *current)
+{
+  return (profile_status == PROFILE_READ
+	  && probably_never_executed_bb_p (current->entry_bb));
+}
+
 /* Look for all BBs in header that might lead to the split part and verify
    that they are not defining any non-SSA var used by the split part.
    Parameters are the same as for consider_split.  */
@@ -370,10 +390,18 @@ consider_split (struct split_point *current, bitmap non_ssa_vars,
   unsigned int i;
   int incoming_freq = 0;
   tree retval;
+  bool cold = cold_split_point_p (current);
 
   if (dump_file && (dump_flags & TDF_DETAILS))
     dump_split_point (dump_file, current);
 
+  if (cold_regions_only && !cold)
+    {
+      if (dump_file && (dump_flags & TDF_DETAILS))
+	fprintf (dump_file, "  Refused: region is executed\n");
+      return;
+    }
+
   FOR_EACH_EDGE (e, ei, current->entry_bb->preds)
     if (!bitmap_bit_p (current->split_bbs, e->src->index))
       incoming_freq += EDGE_FREQUENCY (e);
@@ -460,7 +488,10 @@ consider_split (struct split_point *current, bitmap non_ssa_vars,
 		 "  Refused: split size is smaller than call overhead\n");
       return;
     }
-  if (current->header_size + call_overhead
+  /* Never executed regions are worth splitting even when the header does
+     not become an inline candidate.  */
+  if (!cold
+      && current->header_size + call_overhead
       >= (unsigned int)(DECL_DECLARED_INLINE_P (current_function_decl)
 			? MAX_INLINE_INSNS_SINGLE
 			: MAX_INLINE_INSNS_AUTO))
@@ -1059,10 +1090,12 @@ split_function (struct split_point *split_point)
   gimple last_stmt = NULL;
   unsigned int i;
   tree arg;
+  bool cold = cold_split_point_p (split_point);
 
   if (dump_file)
     {
-      fprintf (dump_file, "\n\nSplitting function at:\n");
+      fprintf (dump_file, "\n\nSplitting %sfunction at:\n",
+	       cold ? "never executed region of " : "");
       dump_split_point (dump_file, split_point);
     }
 
@@ -1211,6 +1244,9 @@ split_function (struct split_point *split_point)
   cgraph_node_remove_callees (cur_node);
   if (!split_part_return_p)
     TREE_THIS_VOLATILE (node->decl) = 1;
+  /* Place never executed parts in the unlikely executed section.  */
+  if (cold)
+    node->frequency = NODE_FREQUENCY_UNLIKELY_EXECUTED;
   if (dump_file)
     dump_function_to_file (node->decl, dump_file, dump_flags);
 
@@ -1392,17 +1428,86 @@ split_function (struct split_point *split_point)
   compute_inline_parameters (node, true);
 }
 
+/* Give up splitting the current function for REASON, unless profile
+   feedback is available; then only never executed regions are split.
+   Return true when giving up.  */
+
+static bool
+refuse_split (const char *reason)
+{
+  if (profile_status == PROFILE_READ)
+    {
+      if (dump_file)
+	fprintf (dump_file, "Splitting only never executed regions: %s.\n",
+		 reason);
+      cold_regions_only = true;
+      return false;
+    }
+  if (dump_file)
+    fprintf (dump_file, "Not splitting: %s.\n", reason);
+  return true;
+}
+
+/* Compute size and time of the basic blocks of the current function into
+   BB_INFO_VEC, and return the totals in OVERALL_TIME and OVERALL_SIZE.
+   Also record the blocks that may not dominate a split point.  */
+
+static void
+compute_bb_info (int *overall_time, int *overall_size)
+{
+  gimple_stmt_iterator bsi;
+  basic_block bb;
+
+  *overall_time = 0;
+  *overall_size = 0;
+  VEC_truncate (bb_info, bb_info_vec, 0);
+  VEC_safe_grow_cleared (bb_info, heap, bb_info_vec, last_basic_block + 1);
+  FOR_EACH_BB (bb)
+    {
+      int time = 0;
+      int size = 0;
+      int freq = compute_call_stmt_bb_frequency (current_function_decl, bb);
+
+      if (dump_file && (dump_flags & TDF_DETAILS))
+	fprintf (dump_file, "Basic block %i\n", bb->index);
+
+      for (bsi = gsi_start_bb (bb); !gsi_end_p (bsi); gsi_next (&bsi))
+	{
+	  int this_time, this_size;
+	  gimple stmt = gsi_stmt (bsi);
+
+	  this_size = estimate_num_insns (stmt, &eni_size_weights);
+	  this_time = estimate_num_insns (stmt, &eni_time_weights) * freq;
+	  size += this_size;
+	  time += this_time;
+	  check_forbidden_calls (stmt);
+
+	  if (dump_file && (dump_flags & TDF_DETAILS))
+	    {
+	      fprintf (dump_file, "  freq:%6i size:%3i time:%3i ",
+		       freq, this_size, this_time);
+	      print_gimple_stmt (dump_file, stmt, 0, 0);
+	    }
+	}
+      *overall_time += time;
+      *overall_size += size;
+      VEC_index (bb_info, bb_info_vec, bb->index)->time = time;
+      VEC_index (bb_info, bb_info_vec, bb->index)->size = size;
+    }
+}
+
 /* Execute function splitting pass.  */
 
 static unsigned int
 execute_split_functions (void)
 {
-  gimple_stmt_iterator bsi;
-  basic_block bb;
-  int overall_time = 0, overall_size = 0;
+  int overall_time, overall_size;
   int todo = 0;
+  int nsplits;
   struct cgraph_node *node = cgraph_get_node (current_function_decl);
 
+  cold_regions_only = false;
+
   if (flags_from_decl_or_type (current_function_decl)
       & (ECF_NORETURN|ECF_MALLOC))
     {
@@ -1457,70 +1562,50 @@ execute_split_functions (void)
      then inlining would still benefit.  */
   if ((!node->callers || !node->callers->next_caller)
       && !node->address_taken
-      && (!flag_lto || !node->local.externally_visible))
-    {
-      if (dump_file)
-	fprintf (dump_file, "Not splitting: not called directly "
-		 "or called once.\n");
-      return 0;
-    }
+      && (!flag_lto || !node->local.externally_visible)
+      && refuse_split ("not called directly or called once"))
+    return 0;
 
   /* FIXME: We can actually split if splitting reduces call overhead.  */
   if (!flag_inline_small_functions
-      && !DECL_DECLARED_INLINE_P (current_function_decl))
-    {
-      if (dump_file)
-	fprintf (dump_file, "Not splitting: not autoinlining and function"
-		 " is not inline.\n");
-      return 0;
-    }
+      && !DECL_DECLARED_INLINE_P (current_function_decl)
+      && refuse_split ("not autoinlining and function is not inline"))
+    return 0;
 
   /* Initialize bitmap to track forbidden calls.  */
   forbidden_dominators = BITMAP_ALLOC (NULL);
   calculate_dominance_info (CDI_DOMINATORS);
 
-  /* Compute local info about basic blocks and determine function size/time.  */
-  VEC_safe_grow_cleared (bb_info, heap, bb_info_vec, last_basic_block + 1);
-  memset (&best_split_point, 0, sizeof (best_split_point));
-  FOR_EACH_BB (bb)
+  /* Split the best region.  With profile feedback, keep splitting
+     never executed regions out of what is left of the function.  */
+  for (nsplits = 0; nsplits < PARAM_VALUE (PARAM_MAX_SPLIT_REGIONS); nsplits++)
     {
-      int time = 0;
-      int size = 0;
-      int freq = compute_call_stmt_bb_frequency (current_function_decl, bb);
-
-      if (dump_file && (dump_flags & TDF_DETAILS))
-	fprintf (dump_file, "Basic block %i\n", bb->index);
-
-      for (bsi = gsi_start_bb (bb); !gsi_end_p (bsi); gsi_next (&bsi))
+      if (nsplits)
 	{
-	  int this_time, this_size;
-	  gimple stmt = gsi_stmt (bsi);
+	  /* Bring the body back to a consistent state before looking at it
+	     again.  */
+	  cleanup_tree_cfg ();
+	  update_ssa (TODO_update_ssa);
+	  calculate_dominance_info (CDI_DOMINATORS);
+	  bitmap_clear (forbidden_dominators);
+	}
 
-	  this_size = estimate_num_insns (stmt, &eni_size_weights);
-	  this_time = estimate_num_insns (stmt, &eni_time_weights) * freq;
-	  size += this_size;
-	  time += this_time;
-	  check_forbidden_calls (stmt);
+      /* Compute local info about basic blocks and determine function
+	 size/time.  */
+      compute_bb_info (&overall_time, &overall_size);
+      memset (&best_split_point, 0, sizeof (best_split_point));
+      find_split_points (overall_time, overall_size);
+      if (!best_split_point.split_bbs)
+	break;
 
-	  if (dump_file && (dump_flags & TDF_DETAILS))
-	    {
-	      fprintf (dump_file, "  freq:%6i size:%3i time:%3i ",
-		       freq, this_size, this_time);
-	      print_gimple_stmt (dump_file, stmt, 0, 0);
-	    }
-	}
-      overall_time += time;
-      overall_size += size;
-      VEC_index (bb_info, bb_info_vec, bb->index)->time = time;
-      VEC_index (bb_info, bb_info_vec, bb->index)->size = size;
-    }
-  find_split_points (overall_time, overall_size);
-  if (best_split_point.split_bbs)
-    {
       split_function (&best_split_point);
       BITMAP_FREE (best_split_point.ssa_names_to_pass);
       BITMAP_FREE (best_split_point.split_bbs);
       todo = TODO_update_ssa | TODO_cleanup_cfg;
+
+      if (profile_status != PROFILE_READ)
+	break;
+      cold_regions_only = true;
     }
   BITMAP_FREE (forbidden_dominators);
   VEC_free (bb_info, heap, bb_info_vec);
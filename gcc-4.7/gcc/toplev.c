@@ -78,6 +78,7 @@ along with GCC; see the file COPYING3.  If not see
 #include "gimple.h"
 #include "tree-ssa-alias.h"
 #include "plugin.h"
+#include "compile-server.h"
 
 #if defined (DWARF2_UNWIND_INFO) || defined (DWARF2_DEBUGGING_INFO)
 #include "dwarf2out.h"
@@ -1976,6 +1977,27 @@ toplev_main (int argc, char **argv)
      repeated when options are added for particular functions.  */
   init_options_once ();
 
+  /* As a compile server, continue from here in a process forked for
+     each command, with the command's arguments and environment.  In
+     batch mode, do the same for each command line of the batch.  */
+  if (argc == 2
+      && !strncmp (argv[1], COMPILE_SERVER_OPTION,
+		   strlen (COMPILE_SERVER_OPTION)))
+    {
+      compile_server_serve (argv[1] + strlen (COMPILE_SERVER_OPTION),
+			    argv[0], &argc, &argv);
+      expandargv (&argc, &argv);
+      gcc_init_libintl ();
+    }
+  else if (argc == 2
+	   && !strncmp (argv[1], COMPILE_BATCH_OPTION,
+			strlen (COMPILE_BATCH_OPTION)))
+    {
+      compile_server_batch (argv[1] + strlen (COMPILE_BATCH_OPTION),
+			    argv[0], &argc, &argv);
+      expandargv (&argc, &argv);
+    }
+
   /* Initialize global options structures; this must be repeated for
      each structure used for parsing options.  */
   init_options_struct (&global_options, &global_options_set);
@@ -1999,6 +2021,11 @@ toplev_main (int argc, char **argv)
 
   handle_common_deferred_options ();
 
+  if (compile_server_name)
+    error ("%qs must be the only option", "-fcompile-server=");
+  if (batch_file_name)
+    error ("%qs must be the only option", "-fbatch=");
+
   init_local_tick ();
 
   initialize_plugins ();
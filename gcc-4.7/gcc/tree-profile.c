@@ -63,10 +63,27 @@ static GTY(()) tree ptr_void;
 
 /* Do initialization work for the edge profiler.  */
 
+/* Make the indirect call profiler variable DECL one variable shared by
+   all units of the program, as libgcov would define it: the caller
+   stores the callee and the counters in one unit, and the profiler
+   called on entry to the callee, which may be in another unit, reads
+   them.  */
+
+static void
+init_ic_make_shared_var (tree decl)
+{
+  SET_DECL_ASSEMBLER_NAME (decl, DECL_NAME (decl));
+  make_decl_one_only (decl, DECL_ASSEMBLER_NAME (decl));
+#ifdef HAVE_GAS_HIDDEN
+  DECL_VISIBILITY (decl) = VISIBILITY_HIDDEN;
+  DECL_VISIBILITY_SPECIFIED (decl) = 1;
+#endif
+}
+
 /* Add code:
-   static gcov*	__gcov_indirect_call_counters; // pointer to actual counter
-   static void*	__gcov_indirect_call_callee; // actual callee address
-*/
+   gcov*	__gcov_indirect_call_counters; // pointer to actual counter
+   void*	__gcov_indirect_call_callee; // actual callee address
+   shared by all units.  */
 static void
 init_ic_make_global_vars (void)
 {
@@ -79,9 +96,9 @@ init_ic_make_global_vars (void)
 		  get_identifier ("__gcov_indirect_call_callee"),
 		  ptr_void);
   TREE_STATIC (ic_void_ptr_var) = 1;
-  TREE_PUBLIC (ic_void_ptr_var) = 0;
   DECL_ARTIFICIAL (ic_void_ptr_var) = 1;
   DECL_INITIAL (ic_void_ptr_var) = NULL;
+  init_ic_make_shared_var (ic_void_ptr_var);
   if (targetm.have_tls)
     DECL_TLS_MODEL (ic_void_ptr_var) =
       decl_default_tls_model (ic_void_ptr_var);
@@ -95,9 +112,9 @@ init_ic_make_global_vars (void)
 		  get_identifier ("__gcov_indirect_call_counters"),
 		  gcov_type_ptr);
   TREE_STATIC (ic_gcov_type_ptr_var) = 1;
-  TREE_PUBLIC (ic_gcov_type_ptr_var) = 0;
   DECL_ARTIFICIAL (ic_gcov_type_ptr_var) = 1;
   DECL_INITIAL (ic_gcov_type_ptr_var) = NULL;
+  init_ic_make_shared_var (ic_gcov_type_ptr_var);
   if (targetm.have_tls)
     DECL_TLS_MODEL (ic_gcov_type_ptr_var) =
       decl_default_tls_model (ic_gcov_type_ptr_var);
@@ -390,7 +407,8 @@ gimple_gen_ic_func_profiler (void)
 				      true, NULL_TREE, true,
 				      GSI_SAME_STMT);
   add_referenced_var (ic_void_ptr_var);
-  tree_uid = build_int_cst (gcov_type_node, current_function_funcdef_no);
+  tree_uid = build_int_cst (gcov_type_node,
+			   coverage_compute_profile_id (c_node));
   stmt1 = gimple_build_call (tree_indirect_call_profiler_fn, 4,
 			     counter_ptr, tree_uid, cur_func, ptr_var);
   gsi_insert_before (&gsi, stmt1, GSI_SAME_STMT);
@@ -47,6 +47,7 @@ along with GCC; see the file COPYING3.  If not see
 #include "tree-pass.h"
 #include "pointer-set.h"
 #include "profile.h"
+#include "tree-inline.h"
 
 /* In this file value profile based optimizations are placed.  Currently the
    following optimizations are implemented (for more detailed descriptions
@@ -64,7 +65,16 @@ along with GCC; see the file COPYING3.  If not see
    3) Indirect/virtual call specialization. If we can determine most
       common function callee in indirect/virtual call. We can use this
       information to improve code effectiveness (especially info for
-      inliner).
+      inliner).  Call targets are recorded by profile ID (see
+      coverage_compute_profile_id), so with -flto a call can also be
+      promoted to a function defined in another unit and inlined at link
+      time.
+
+   4) Call argument specialization.  If an integer argument of a direct call
+      usually has the same value, the call is duplicated under a test for
+      that value, so that the duplicate passes a constant.  IPA-CP then sees
+      the constant at the hot copy of the call and may clone the callee for
+      it (-fipa-cp-value-profile).
 
    Every such optimization should add its requirements for profiled values to
    insn_values_to_profile function.  This function is called from branch_prob
@@ -87,6 +97,7 @@ static bool gimple_mod_pow2_value_transform (gimple_stmt_iterator *);
 static bool gimple_mod_subtract_transform (gimple_stmt_iterator *);
 static bool gimple_stringops_transform (gimple_stmt_iterator *);
 static bool gimple_ic_transform (gimple);
+static bool gimple_call_arg_transform (gimple_stmt_iterator *);
 
 /* Allocate histogram value.  */
 
@@ -526,7 +537,8 @@ gimple_value_profile_transformations (void)
 		  || gimple_divmod_fixed_value_transform (&gsi)
 		  || gimple_mod_pow2_value_transform (&gsi)
 		  || gimple_stringops_transform (&gsi)
-		  || gimple_ic_transform (stmt)))
+		  || gimple_ic_transform (stmt)
+		  || gimple_call_arg_transform (&gsi)))
 	    {
 	      stmt = gsi_stmt (gsi);
 	      changed = true;
@@ -1060,24 +1072,86 @@ gimple_mod_subtract_transform (gimple_stmt_iterator *si)
   return true;
 }
 
-static VEC(cgraph_node_ptr, heap) *cgraph_node_map = NULL;
+/* Entry of the map from profile IDs to cgraph nodes.  NODE is NULL when
+   several functions share the ID.  */
+
+struct node_map_entry
+{
+  unsigned int profile_id;
+  struct cgraph_node *node;
+};
+
+static htab_t cgraph_node_map;
+
+/* Hash function for the node map.  */
+
+static hashval_t
+node_map_hash (const void *x)
+{
+  return ((const struct node_map_entry *) x)->profile_id;
+}
 
-/* Initialize map from FUNCDEF_NO to CGRAPH_NODE.  */
+/* Equality function for the node map.  */
+
+static int
+node_map_eq (const void *x, const void *y)
+{
+  return (((const struct node_map_entry *) x)->profile_id
+	  == ((const struct node_map_entry *) y)->profile_id);
+}
+
+/* Return true if N may become the target of a call promoted from an
+   indirect call.  Besides the functions defined in this unit, public
+   functions defined elsewhere qualify when producing code for link time
+   optimization; the inliner can then bring them in across units.  */
+
+static bool
+ic_target_candidate_p (struct cgraph_node *n)
+{
+  tree decl = n->decl;
+
+  if (n->global.inlined_to || n->clone_of)
+    return false;
+  if (DECL_STRUCT_FUNCTION (decl))
+    return true;
+  return (flag_lto
+	  && TREE_PUBLIC (decl)
+	  && DECL_EXTERNAL (decl)
+	  && !DECL_COMDAT (decl)
+	  && !DECL_DECLARED_INLINE_P (decl)
+	  && !DECL_BUILT_IN (decl));
+}
+
+/* Initialize map from profile ID to CGRAPH_NODE.  */
 
 void
 init_node_map (void)
 {
   struct cgraph_node *n;
 
-  if (get_last_funcdef_no ())
-    VEC_safe_grow_cleared (cgraph_node_ptr, heap,
-                           cgraph_node_map, get_last_funcdef_no ());
+  cgraph_node_map = htab_create (cgraph_n_nodes, node_map_hash, node_map_eq,
+				 free);
 
   for (n = cgraph_nodes; n; n = n->next)
     {
-      if (DECL_STRUCT_FUNCTION (n->decl))
-        VEC_replace (cgraph_node_ptr, cgraph_node_map,
-                     DECL_STRUCT_FUNCTION (n->decl)->funcdef_no, n);
+      struct node_map_entry key, *entry;
+      void **slot;
+
+      if (!ic_target_candidate_p (n))
+	continue;
+      key.profile_id = coverage_compute_profile_id (n);
+      slot = htab_find_slot_with_hash (cgraph_node_map, &key,
+				       key.profile_id, INSERT);
+      entry = (struct node_map_entry *) *slot;
+      if (!entry)
+	{
+	  entry = XNEW (struct node_map_entry);
+	  entry->profile_id = key.profile_id;
+	  entry->node = n;
+	  *slot = entry;
+	}
+      else if (entry->node && entry->node->decl != n->decl)
+	entry->node = NULL;
     }
 }
 
@@ -1086,30 +1160,30 @@ init_node_map (void)
 void
 del_node_map (void)
 {
-   VEC_free (cgraph_node_ptr, heap, cgraph_node_map);
-   cgraph_node_map = NULL;
+  htab_delete (cgraph_node_map);
+  cgraph_node_map = NULL;
 }
 
-/* Return cgraph node for function with pid */
+/* Return cgraph node for function with profile ID PROFILE_ID, or NULL if
+   there is no such function in this unit or the ID is ambiguous.  */
 
 static inline struct cgraph_node*
-find_func_by_funcdef_no (int func_id)
+find_func_by_profile_id (unsigned int profile_id)
 {
-  int max_id = get_last_funcdef_no ();
-  if (func_id >= max_id || VEC_index (cgraph_node_ptr,
-                                      cgraph_node_map,
-                                      func_id) == NULL)
-    {
-      if (flag_profile_correction)
-        inform (DECL_SOURCE_LOCATION (current_function_decl),
-                "Inconsistent profile: indirect call target (%d) does not exist", func_id);
-      else
-        error ("Inconsistent profile: indirect call target (%d) does not exist", func_id);
+  struct node_map_entry key, *entry;
 
+  key.profile_id = profile_id;
+  entry = (struct node_map_entry *) htab_find_with_hash (cgraph_node_map,
+							 &key, profile_id);
+  if (!entry || !entry->node)
+    {
+      if (dump_file)
+	fprintf (dump_file, "Indirect call target %u is %s\n", profile_id,
+		 entry ? "ambiguous" : "not known in this unit");
       return NULL;
     }
 
-  return VEC_index (cgraph_node_ptr, cgraph_node_map, func_id);
+  return entry->node;
 }
 
 /* Perform sanity check on the indirect call target. Due to race conditions,
@@ -1326,7 +1400,7 @@ gimple_ic_transform (gimple stmt)
     prob = (count * REG_BR_PROB_BASE + all / 2) / all;
   else
     prob = 0;
-  direct_call = find_func_by_funcdef_no ((int)val);
+  direct_call = find_func_by_profile_id ((unsigned int) val);
 
   if (direct_call == NULL)
     return false;
@@ -1576,6 +1650,247 @@ gimple_stringops_transform (gimple_stmt_iterator *gsi)
   return true;
 }
 
+/* The most arguments of one call that are profiled for call argument
+   specialization.  */
+#define MAX_PROFILED_CALL_ARGS 4
+
+/* Return true if the arguments of the direct call CALL shall be profiled
+   for call argument specialization: IPA-CP can clone the callee for a
+   value, which needs its body.  */
+
+static bool
+interesting_call_args_to_profile_p (gimple call)
+{
+  struct cgraph_node *node;
+  tree fndecl;
+
+  if (!flag_ipa_cp_value_profile
+      || gimple_code (call) != GIMPLE_CALL
+      || gimple_call_internal_p (call))
+    return false;
+  fndecl = gimple_call_fndecl (call);
+  if (!fndecl || DECL_BUILT_IN (fndecl))
+    return false;
+  node = cgraph_get_node (fndecl);
+  return (node
+	  && cgraph_function_body_availability (node) >= AVAIL_AVAILABLE
+	  && tree_versionable_function_p (fndecl));
+}
+
+/* Convert   vcall_stmt (..., arg, ...)
+   into
+   if (arg == value)
+     icall_stmt (..., value, ...);
+   else
+     vcall_stmt (..., arg, ...);
+   where ARG is argument ARGNO of VCALL_STMT.  PROB is the probability of
+   taking the first branch, equivalent to COUNT/ALL within roundoff error.
+   Return ICALL_STMT.  */
+
+static gimple
+gimple_call_arg_fixed_value (gimple vcall_stmt, unsigned argno, tree value,
+			     int prob, gcov_type count, gcov_type all)
+{
+  gimple tmp_stmt, cond_stmt, icall_stmt;
+  tree tmp0, tmp1, tmpv, optype;
+  basic_block cond_bb, icall_bb, vcall_bb, join_bb = NULL;
+  edge e_ci, e_cv, e_iv, e_ij = NULL, e_vj;
+  gimple_stmt_iterator gsi;
+  int lp_nr;
+
+  cond_bb = gimple_bb (vcall_stmt);
+  gsi = gsi_for_stmt (vcall_stmt);
+
+  optype = TREE_TYPE (gimple_call_arg (vcall_stmt, argno));
+  tmpv = create_tmp_reg (optype, "PROF");
+  tmp0 = make_ssa_name (tmpv, NULL);
+  tmp1 = make_ssa_name (tmpv, NULL);
+  tmp_stmt = gimple_build_assign (tmp0, value);
+  SSA_NAME_DEF_STMT (tmp0) = tmp_stmt;
+  gsi_insert_before (&gsi, tmp_stmt, GSI_SAME_STMT);
+
+  tmp_stmt = gimple_build_assign (tmp1, gimple_call_arg (vcall_stmt, argno));
+  SSA_NAME_DEF_STMT (tmp1) = tmp_stmt;
+  gsi_insert_before (&gsi, tmp_stmt, GSI_SAME_STMT);
+
+  cond_stmt = gimple_build_cond (EQ_EXPR, tmp1, tmp0, NULL_TREE, NULL_TREE);
+  gsi_insert_before (&gsi, cond_stmt, GSI_SAME_STMT);
+
+  gimple_set_vdef (vcall_stmt, NULL_TREE);
+  gimple_set_vuse (vcall_stmt, NULL_TREE);
+  update_stmt (vcall_stmt);
+  icall_stmt = gimple_copy (vcall_stmt);
+  gimple_call_set_arg (icall_stmt, argno, value);
+  gsi_insert_before (&gsi, icall_stmt, GSI_SAME_STMT);
+
+  /* Fix CFG. */
+  /* Edge e_ci connects cond_bb to icall_bb, etc; note the first letters. */
+  e_ci = split_block (cond_bb, cond_stmt);
+  icall_bb = e_ci->dest;
+  icall_bb->count = count;
+
+  e_iv = split_block (icall_bb, icall_stmt);
+  vcall_bb = e_iv->dest;
+  vcall_bb->count = all - count;
+
+  /* Do not disturb existing EH edges from the original call.  */
+  if (!stmt_ends_bb_p (vcall_stmt))
+    e_vj = split_block (vcall_bb, vcall_stmt);
+  else
+    {
+      e_vj = find_fallthru_edge (vcall_bb->succs);
+      /* The call might be noreturn.  */
+      if (e_vj != NULL)
+	{
+	  e_vj->probability = REG_BR_PROB_BASE;
+	  e_vj->count = all - count;
+	  e_vj = single_pred_edge (split_edge (e_vj));
+	}
+    }
+  if (e_vj != NULL)
+    {
+      join_bb = e_vj->dest;
+      join_bb->count = all;
+    }
+
+  e_ci->flags = (e_ci->flags & ~EDGE_FALLTHRU) | EDGE_TRUE_VALUE;
+  e_ci->probability = prob;
+  e_ci->count = count;
+
+  e_cv = make_edge (cond_bb, vcall_bb, EDGE_FALSE_VALUE);
+  e_cv->probability = REG_BR_PROB_BASE - prob;
+  e_cv->count = all - count;
+
+  remove_edge (e_iv);
+
+  if (e_vj != NULL)
+    {
+      e_ij = make_edge (icall_bb, join_bb, EDGE_FALLTHRU);
+      e_ij->probability = REG_BR_PROB_BASE;
+      e_ij->count = count;
+
+      e_vj->probability = REG_BR_PROB_BASE;
+      e_vj->count = all - count;
+    }
+
+  /* Insert PHI node for the call result if necessary.  */
+  if (gimple_call_lhs (vcall_stmt)
+      && TREE_CODE (gimple_call_lhs (vcall_stmt)) == SSA_NAME
+      && join_bb)
+    {
+      tree result = gimple_call_lhs (vcall_stmt);
+      gimple phi = create_phi_node (result, join_bb);
+      SSA_NAME_DEF_STMT (result) = phi;
+      gimple_call_set_lhs (vcall_stmt,
+			   make_ssa_name (SSA_NAME_VAR (result), vcall_stmt));
+      add_phi_arg (phi, gimple_call_lhs (vcall_stmt), e_vj, UNKNOWN_LOCATION);
+      gimple_call_set_lhs (icall_stmt,
+			   make_ssa_name (SSA_NAME_VAR (result), icall_stmt));
+      add_phi_arg (phi, gimple_call_lhs (icall_stmt), e_ij, UNKNOWN_LOCATION);
+    }
+
+  /* Build an EH edge for the new call if necessary.  */
+  lp_nr = lookup_stmt_eh_lp (vcall_stmt);
+  if (lp_nr != 0
+      && stmt_could_throw_p (icall_stmt))
+    {
+      edge e_eh, e;
+      edge_iterator ei;
+      gimple_stmt_iterator psi;
+
+      add_stmt_to_eh_lp (icall_stmt, lp_nr);
+      FOR_EACH_EDGE (e_eh, ei, vcall_bb->succs)
+	if (e_eh->flags & EDGE_EH)
+	  break;
+      e = make_edge (icall_bb, e_eh->dest, EDGE_EH);
+      for (psi = gsi_start_phis (e_eh->dest);
+	   !gsi_end_p (psi); gsi_next (&psi))
+	{
+	  gimple phi = gsi_stmt (psi);
+	  SET_USE (PHI_ARG_DEF_PTR_FROM_EDGE (phi, e),
+		   PHI_ARG_DEF_FROM_EDGE (phi, e_eh));
+	}
+    }
+
+  return icall_stmt;
+}
+
+/* For a direct call with profiled arguments, find the argument that most
+   often has a single value, and if it has that value at least 80% of the
+   time, specialize the call for it.  All argument histograms of the call
+   are consumed.  */
+
+static bool
+gimple_call_arg_transform (gimple_stmt_iterator *si)
+{
+  gimple stmt = gsi_stmt (*si);
+  histogram_value hist, next;
+  gcov_type val = 0, count = 0, all = 0;
+  gcov_type prob;
+  unsigned argno = 0, i;
+  bool found = false;
+  tree arg, tree_val;
+  gimple modify;
+
+  if (!interesting_call_args_to_profile_p (stmt))
+    return false;
+
+  for (hist = gimple_histogram_value (cfun, stmt); hist; hist = next)
+    {
+      next = hist->hvalue.next;
+      if (hist->type != HIST_TYPE_SINGLE_VALUE)
+	continue;
+      for (i = 0; i < gimple_call_num_args (stmt); i++)
+	if (gimple_call_arg (stmt, i) == hist->hvalue.value)
+	  break;
+      /* We require that the value is constant at least 80% of time.  */
+      if (i < gimple_call_num_args (stmt)
+	  && (6 * hist->hvalue.counters[1] / 5) >= hist->hvalue.counters[2]
+	  && (!found || hist->hvalue.counters[1] > count))
+	{
+	  found = true;
+	  argno = i;
+	  val = hist->hvalue.counters[0];
+	  count = hist->hvalue.counters[1];
+	  all = hist->hvalue.counters[2];
+	}
+      gimple_remove_histogram_value (cfun, stmt, hist);
+    }
+
+  if (!found || optimize_bb_for_size_p (gimple_bb (stmt)))
+    return false;
+  if (check_counter (stmt, "value", &count, &all, gimple_bb (stmt)->count))
+    return false;
+  if (all > 0)
+    prob = (count * REG_BR_PROB_BASE + all / 2) / all;
+  else
+    prob = 0;
+
+  arg = gimple_call_arg (stmt, argno);
+  tree_val = build_int_cst_wide (get_gcov_type (),
+				 (unsigned HOST_WIDE_INT) val,
+				 val >> (HOST_BITS_PER_WIDE_INT - 1) >> 1);
+  if (!int_fits_type_p (tree_val, TREE_TYPE (arg)))
+    return false;
+  tree_val = fold_convert (TREE_TYPE (arg), tree_val);
+
+  modify = gimple_call_arg_fixed_value (stmt, argno, tree_val, prob,
+					count, all);
+
+  if (dump_file)
+    {
+      fprintf (dump_file, "Single value %i call argument %u transformation on ",
+	       (int)val, argno);
+      print_gimple_stmt (dump_file, stmt, 0, TDF_SLIM);
+      fprintf (dump_file, " to ");
+      print_gimple_stmt (dump_file, modify, 0, TDF_SLIM);
+      fprintf (dump_file, "hist->count "HOST_WIDEST_INT_PRINT_DEC
+	       " hist->all "HOST_WIDEST_INT_PRINT_DEC"\n", count, all);
+    }
+
+  return true;
+}
+
 void
 stringop_block_profile (gimple stmt, unsigned int *expected_align,
 			HOST_WIDE_INT *expected_size)
@@ -1745,6 +2060,36 @@ gimple_stringops_values_to_profile (gimple stmt, histogram_values *values)
 						 stmt, dest));
 }
 
+/* Find integer arguments of the call STMT for that we want to measure
+   histograms for call argument specialization, at most
+   MAX_PROFILED_CALL_ARGS of them.  */
+
+static void
+gimple_call_args_values_to_profile (gimple stmt, histogram_values *values)
+{
+  unsigned i, n = 0;
+
+  if (!interesting_call_args_to_profile_p (stmt))
+    return;
+
+  for (i = 0;
+       i < gimple_call_num_args (stmt) && n < MAX_PROFILED_CALL_ARGS;
+       i++)
+    {
+      tree arg = gimple_call_arg (stmt, i);
+
+      if (TREE_CODE (arg) == SSA_NAME
+	  && INTEGRAL_TYPE_P (TREE_TYPE (arg)))
+	{
+	  VEC_safe_push (histogram_value, heap, *values,
+			 gimple_alloc_histogram_value (cfun,
+						       HIST_TYPE_SINGLE_VALUE,
+						       stmt, arg));
+	  n++;
+	}
+    }
+}
+
 /* Find values inside STMT for that we want to measure histograms and adds
    them to list VALUES.  */
 
@@ -1756,6 +2101,7 @@ gimple_values_to_profile (gimple stmt, histogram_values *values)
       gimple_divmod_values_to_profile (stmt, values);
       gimple_stringops_values_to_profile (stmt, values);
       gimple_indirect_call_to_profile (stmt, values);
+      gimple_call_args_values_to_profile (stmt, values);
     }
 }
 